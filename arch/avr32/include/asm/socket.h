@@ -62,4 +62,8 @@
 
 #define SO_RXQ_OVFL             40
 
+#define SO_ZEROCOPY             41
+
+#define SO_BUSY_POLL            42
+
 #endif /* __ASM_AVR32_SOCKET_H */
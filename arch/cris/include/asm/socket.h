@@ -64,6 +64,10 @@
 
 #define SO_RXQ_OVFL             40
 
+#define SO_ZEROCOPY             41
+
+#define SO_BUSY_POLL            42
+
 #endif /* _ASM_SOCKET_H */
 
 
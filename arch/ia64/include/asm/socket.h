@@ -71,4 +71,8 @@
 
 #define SO_RXQ_OVFL             40
 
+#define SO_ZEROCOPY             41
+
+#define SO_BUSY_POLL            42
+
 #endif /* _ASM_IA64_SOCKET_H */
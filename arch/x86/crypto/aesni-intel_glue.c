@@ -15,10 +15,13 @@
 #include <linux/types.h>
 #include <linux/crypto.h>
 #include <linux/err.h>
+#include <linux/slab.h>
 #include <crypto/algapi.h>
 #include <crypto/aes.h>
 #include <crypto/cryptd.h>
 #include <crypto/ctr.h>
+#include <crypto/scatterwalk.h>
+#include <crypto/internal/aead.h>
 #include <asm/i387.h>
 #include <asm/aes.h>
 
@@ -730,6 +733,389 @@ static struct crypto_alg ablk_xts_alg = {
 };
 #endif
 
+asmlinkage void aesni_gcm_ghash(u8 *hash, const u8 *hash_subkey,
+				const u8 *src, unsigned int len);
+asmlinkage void aesni_gcm_enc(struct crypto_aes_ctx *ctx, u8 *dst,
+			      const u8 *src, unsigned int len, u8 *iv,
+			      u8 *hash, const u8 *hash_subkey);
+asmlinkage void aesni_gcm_dec(struct crypto_aes_ctx *ctx, u8 *dst,
+			      const u8 *src, unsigned int len, u8 *iv,
+			      u8 *hash, const u8 *hash_subkey);
+
+struct aesni_rfc4106_ctx {
+	struct crypto_aes_ctx aes_key;
+	/* hash_key << 1 mod poly, in the layout aesni_gcm_* expect */
+	u8 hash_subkey[16] __attribute__ ((__aligned__(AESNI_ALIGN)));
+	u8 nonce[4];
+};
+
+struct async_aesni_rfc4106_ctx {
+	struct cryptd_aead *cryptd_tfm;
+};
+
+static inline struct aesni_rfc4106_ctx *
+aesni_rfc4106_ctx(struct crypto_aead *tfm)
+{
+	return (struct aesni_rfc4106_ctx *)aes_ctx(crypto_aead_ctx(tfm));
+}
+
+static int __driver_rfc4106_set_key(struct crypto_aead *aead, const u8 *key,
+				    unsigned int key_len)
+{
+	struct aesni_rfc4106_ctx *ctx = aesni_rfc4106_ctx(aead);
+	u8 h[AES_BLOCK_SIZE] = { 0 };
+	u64 hi, lo, carry;
+	int err;
+
+	if (key_len < 4) {
+		crypto_aead_set_flags(aead, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	key_len -= 4;
+	memcpy(ctx->nonce, key + key_len, sizeof(ctx->nonce));
+
+	err = aes_set_key_common(crypto_aead_tfm(aead), &ctx->aes_key,
+				 key, key_len);
+	if (err)
+		return err;
+
+	/* H = E(K, 0^128) */
+	if (!irq_fpu_usable())
+		crypto_aes_encrypt_x86(&ctx->aes_key, h, h);
+	else {
+		kernel_fpu_begin();
+		aesni_enc(&ctx->aes_key, h, h);
+		kernel_fpu_end();
+	}
+
+	/* precompute H << 1 mod poly, see clmul_ghash_setkey() */
+	hi = be64_to_cpu(*(__be64 *)h);
+	lo = be64_to_cpu(*(__be64 *)(h + 8));
+	carry = hi >> 63;
+	hi = (hi << 1) | (lo >> 63);
+	lo <<= 1;
+	if (carry) {
+		hi ^= 0xc200000000000000ULL;
+		lo ^= 1;
+	}
+	((u64 *)ctx->hash_subkey)[0] = lo;
+	((u64 *)ctx->hash_subkey)[1] = hi;
+
+	memset(h, 0, sizeof(h));
+	return 0;
+}
+
+static int __driver_rfc4106_setauthsize(struct crypto_aead *aead,
+					unsigned int authsize)
+{
+	switch (authsize) {
+	case 8:
+	case 12:
+	case 16:
+		return 0;
+	}
+	return -EINVAL;
+}
+
+/* GHASH a buffer of any length, zero padding the last block */
+static void aesni_gcm_ghash_pad(u8 *hash, const u8 *hash_subkey,
+				const u8 *src, unsigned int len)
+{
+	unsigned int full = len & AES_BLOCK_MASK;
+	u8 block[AES_BLOCK_SIZE];
+
+	aesni_gcm_ghash(hash, hash_subkey, src, full);
+	if (len != full) {
+		memset(block, 0, sizeof(block));
+		memcpy(block, src + full, len - full);
+		aesni_gcm_ghash(hash, hash_subkey, block, sizeof(block));
+	}
+}
+
+/*
+ * One pass GCM over linear buffers, called with the FPU enabled. The
+ * whole blocks go through the fused asm loop, only the trailing partial
+ * block, the AAD and the length block are handled here. dst may equal
+ * src.
+ */
+static void aesni_gcm_crypt(struct aesni_rfc4106_ctx *ctx, u8 *dst,
+			    const u8 *src, unsigned int len,
+			    const u8 *assoc, unsigned int assoclen,
+			    const u8 *iv, u8 *tag, bool enc)
+{
+	unsigned int full = len & AES_BLOCK_MASK;
+	unsigned int tail = len - full;
+	u8 j0[AES_BLOCK_SIZE], ctr[AES_BLOCK_SIZE];
+	u8 hash[AES_BLOCK_SIZE] = { 0 };
+	u8 block[AES_BLOCK_SIZE], ks[AES_BLOCK_SIZE];
+	__be64 lengths[2];
+
+	/* J0 = salt || IV || 1, the payload starts at counter 2 */
+	memcpy(j0, ctx->nonce, 4);
+	memcpy(j0 + 4, iv, 8);
+	*(__be32 *)(j0 + 12) = cpu_to_be32(1);
+	memcpy(ctr, j0, 12);
+	*(__be32 *)(ctr + 12) = cpu_to_be32(2);
+
+	aesni_gcm_ghash_pad(hash, ctx->hash_subkey, assoc, assoclen);
+
+	if (enc)
+		aesni_gcm_enc(&ctx->aes_key, dst, src, full, ctr, hash,
+			      ctx->hash_subkey);
+	else
+		aesni_gcm_dec(&ctx->aes_key, dst, src, full, ctr, hash,
+			      ctx->hash_subkey);
+
+	if (tail) {
+		aesni_enc(&ctx->aes_key, ks, ctr);
+		memset(block, 0, sizeof(block));
+		memcpy(block, src + full, tail);
+		if (!enc)
+			aesni_gcm_ghash(hash, ctx->hash_subkey, block,
+					sizeof(block));
+		crypto_xor(block, ks, tail);
+		memcpy(dst + full, block, tail);
+		if (enc) {
+			memset(block + tail, 0, sizeof(block) - tail);
+			aesni_gcm_ghash(hash, ctx->hash_subkey, block,
+					sizeof(block));
+		}
+	}
+
+	lengths[0] = cpu_to_be64((u64)assoclen * 8);
+	lengths[1] = cpu_to_be64((u64)len * 8);
+	aesni_gcm_ghash(hash, ctx->hash_subkey, (u8 *)lengths,
+			sizeof(lengths));
+
+	aesni_enc(&ctx->aes_key, tag, j0);
+	crypto_xor(tag, hash, AES_BLOCK_SIZE);
+}
+
+/* true if the first len bytes of sg can be mapped as one piece */
+static inline bool rfc4106_sg_linear(struct scatterlist *sg, unsigned int len)
+{
+	return sg_is_last(sg) && sg->length >= len &&
+	       sg->offset + len <= PAGE_SIZE;
+}
+
+static int __driver_rfc4106_crypt(struct aead_request *req, bool enc)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct aesni_rfc4106_ctx *ctx = aesni_rfc4106_ctx(tfm);
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int assoclen = req->assoclen;
+	unsigned int len = req->cryptlen;
+	struct scatter_walk src_walk, dst_walk, assoc_walk;
+	u8 *src, *dst, *assoc, *buf = NULL;
+	u8 tag[AES_BLOCK_SIZE];
+	bool in_place = req->src == req->dst;
+	int err = 0;
+
+	if (!enc) {
+		if (len < authsize)
+			return -EINVAL;
+		len -= authsize;
+	}
+
+	/*
+	 * ESP hands us the SPI/sequence number and the payload as single
+	 * entries, which can be processed where they are. Anything else is
+	 * bounced through a linear buffer.
+	 */
+	if (rfc4106_sg_linear(req->assoc, assoclen) &&
+	    rfc4106_sg_linear(req->src, len + authsize) &&
+	    (in_place ||
+	     rfc4106_sg_linear(req->dst, enc ? len + authsize : len))) {
+		scatterwalk_start(&assoc_walk, req->assoc);
+		scatterwalk_start(&src_walk, req->src);
+		assoc = scatterwalk_map(&assoc_walk, 0);
+		src = scatterwalk_map(&src_walk, 0);
+		dst = src;
+		if (!in_place) {
+			scatterwalk_start(&dst_walk, req->dst);
+			dst = scatterwalk_map(&dst_walk, 1);
+		}
+	} else {
+		buf = kmalloc(assoclen + len + authsize, GFP_ATOMIC);
+		if (!buf)
+			return -ENOMEM;
+		assoc = buf;
+		src = dst = buf + assoclen;
+		scatterwalk_map_and_copy(assoc, req->assoc, 0, assoclen, 0);
+		scatterwalk_map_and_copy(src, req->src, 0,
+					 enc ? len : len + authsize, 0);
+	}
+
+	kernel_fpu_begin();
+	aesni_gcm_crypt(ctx, dst, src, len, assoc, assoclen, req->iv, tag, enc);
+	kernel_fpu_end();
+
+	if (enc)
+		memcpy(dst + len, tag, authsize);
+	else if (memcmp(src + len, tag, authsize))
+		err = -EBADMSG;
+
+	if (!buf) {
+		if (!in_place) {
+			scatterwalk_unmap(dst, 1);
+			scatterwalk_done(&dst_walk, 1, 0);
+		}
+		scatterwalk_unmap(src, 0);
+		scatterwalk_unmap(assoc, 0);
+		scatterwalk_done(&src_walk, 0, 0);
+		scatterwalk_done(&assoc_walk, 0, 0);
+	} else {
+		scatterwalk_map_and_copy(dst, req->dst, 0,
+					 enc ? len + authsize : len, 1);
+		kfree(buf);
+	}
+
+	return err;
+}
+
+static int __driver_rfc4106_encrypt(struct aead_request *req)
+{
+	return __driver_rfc4106_crypt(req, true);
+}
+
+static int __driver_rfc4106_decrypt(struct aead_request *req)
+{
+	return __driver_rfc4106_crypt(req, false);
+}
+
+static struct crypto_alg __rfc4106_alg = {
+	.cra_name		= "__gcm-aes-aesni",
+	.cra_driver_name	= "__driver-gcm-aes-aesni",
+	.cra_priority		= 0,
+	.cra_flags		= CRYPTO_ALG_TYPE_AEAD,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct aesni_rfc4106_ctx)+AESNI_ALIGN-1,
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_aead_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(__rfc4106_alg.cra_list),
+	.cra_u = {
+		.aead = {
+			.setkey		= __driver_rfc4106_set_key,
+			.setauthsize	= __driver_rfc4106_setauthsize,
+			.encrypt	= __driver_rfc4106_encrypt,
+			.decrypt	= __driver_rfc4106_decrypt,
+			.ivsize		= 8,
+			.maxauthsize	= 16,
+		},
+	},
+};
+
+/*
+ * The cryptd AEAD instance forwards setkey and setauthsize to the child
+ * algorithm's methods with its own tfm, so configure the child directly.
+ */
+static int rfc4106_set_key(struct crypto_aead *parent, const u8 *key,
+			   unsigned int key_len)
+{
+	struct async_aesni_rfc4106_ctx *ctx = crypto_aead_ctx(parent);
+	struct crypto_aead *child = cryptd_aead_child(ctx->cryptd_tfm);
+	int err;
+
+	crypto_aead_clear_flags(child, CRYPTO_TFM_REQ_MASK);
+	crypto_aead_set_flags(child, crypto_aead_get_flags(parent)
+			      & CRYPTO_TFM_REQ_MASK);
+	err = crypto_aead_setkey(child, key, key_len);
+	crypto_aead_set_flags(parent, crypto_aead_get_flags(child)
+			      & CRYPTO_TFM_RES_MASK);
+	return err;
+}
+
+static int rfc4106_set_authsize(struct crypto_aead *parent,
+				unsigned int authsize)
+{
+	struct async_aesni_rfc4106_ctx *ctx = crypto_aead_ctx(parent);
+
+	return crypto_aead_setauthsize(cryptd_aead_child(ctx->cryptd_tfm),
+				       authsize);
+}
+
+static int rfc4106_encrypt(struct aead_request *req)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct async_aesni_rfc4106_ctx *ctx = crypto_aead_ctx(tfm);
+	struct aead_request *subreq = aead_request_ctx(req);
+
+	memcpy(subreq, req, sizeof(*req));
+	if (!irq_fpu_usable()) {
+		aead_request_set_tfm(subreq, &ctx->cryptd_tfm->base);
+		return crypto_aead_encrypt(subreq);
+	} else {
+		aead_request_set_tfm(subreq,
+				     cryptd_aead_child(ctx->cryptd_tfm));
+		return __driver_rfc4106_encrypt(subreq);
+	}
+}
+
+static int rfc4106_decrypt(struct aead_request *req)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct async_aesni_rfc4106_ctx *ctx = crypto_aead_ctx(tfm);
+	struct aead_request *subreq = aead_request_ctx(req);
+
+	memcpy(subreq, req, sizeof(*req));
+	if (!irq_fpu_usable()) {
+		aead_request_set_tfm(subreq, &ctx->cryptd_tfm->base);
+		return crypto_aead_decrypt(subreq);
+	} else {
+		aead_request_set_tfm(subreq,
+				     cryptd_aead_child(ctx->cryptd_tfm));
+		return __driver_rfc4106_decrypt(subreq);
+	}
+}
+
+static int rfc4106_init(struct crypto_tfm *tfm)
+{
+	struct async_aesni_rfc4106_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct cryptd_aead *cryptd_tfm;
+
+	cryptd_tfm = cryptd_alloc_aead("__driver-gcm-aes-aesni", 0, 0);
+	if (IS_ERR(cryptd_tfm))
+		return PTR_ERR(cryptd_tfm);
+	ctx->cryptd_tfm = cryptd_tfm;
+	tfm->crt_aead.reqsize = sizeof(struct aead_request) +
+		crypto_aead_reqsize(&cryptd_tfm->base);
+	return 0;
+}
+
+static void rfc4106_exit(struct crypto_tfm *tfm)
+{
+	struct async_aesni_rfc4106_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	cryptd_free_aead(ctx->cryptd_tfm);
+}
+
+static struct crypto_alg rfc4106_alg = {
+	.cra_name		= "rfc4106(gcm(aes))",
+	.cra_driver_name	= "rfc4106-gcm-aesni",
+	.cra_priority		= 400,
+	.cra_flags		= CRYPTO_ALG_TYPE_AEAD|CRYPTO_ALG_ASYNC,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct async_aesni_rfc4106_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_nivaead_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(rfc4106_alg.cra_list),
+	.cra_init		= rfc4106_init,
+	.cra_exit		= rfc4106_exit,
+	.cra_u = {
+		.aead = {
+			.setkey		= rfc4106_set_key,
+			.setauthsize	= rfc4106_set_authsize,
+			.encrypt	= rfc4106_encrypt,
+			.decrypt	= rfc4106_decrypt,
+			.geniv		= "seqiv",
+			.ivsize		= 8,
+			.maxauthsize	= 16,
+		},
+	},
+};
+
 static int __init aesni_init(void)
 {
 	int err;
@@ -770,10 +1156,22 @@ static int __init aesni_init(void)
 	if ((err = crypto_register_alg(&ablk_xts_alg)))
 		goto ablk_xts_err;
 #endif
+	if (cpu_has_pclmulqdq) {
+		if ((err = crypto_register_alg(&__rfc4106_alg)))
+			goto __rfc4106_err;
+		if ((err = crypto_register_alg(&rfc4106_alg)))
+			goto rfc4106_err;
+	} else
+		printk(KERN_INFO "PCLMULQDQ-NI instructions are not detected, "
+		       "rfc4106(gcm(aes)) not registered.\n");
 
 	return err;
 
+rfc4106_err:
+	crypto_unregister_alg(&__rfc4106_alg);
+__rfc4106_err:
 #ifdef HAS_XTS
+	crypto_unregister_alg(&ablk_xts_alg);
 ablk_xts_err:
 #endif
 #ifdef HAS_PCBC
@@ -809,6 +1207,10 @@ aes_err:
 
 static void __exit aesni_exit(void)
 {
+	if (cpu_has_pclmulqdq) {
+		crypto_unregister_alg(&rfc4106_alg);
+		crypto_unregister_alg(&__rfc4106_alg);
+	}
 #ifdef HAS_XTS
 	crypto_unregister_alg(&ablk_xts_alg);
 #endif
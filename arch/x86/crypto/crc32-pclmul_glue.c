@@ -0,0 +1,169 @@
+/*
+ * Cryptographic API.
+ *
+ * Glue code for the CRC32 (IEEE 802.3) PCLMULQDQ folding implementation.
+ * Buffers shorter than 64 bytes, and any call made while the FPU can't
+ * be used, are handed to crc32_le() from lib/crc32.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/internal/hash.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/kernel.h>
+#include <linux/crc32.h>
+#include <asm/cpufeature.h>
+#include <asm/i387.h>
+
+#define CHKSUM_BLOCK_SIZE	1
+#define CHKSUM_DIGEST_SIZE	4
+
+/* the folding code needs at least four 16 byte blocks */
+#define PCLMUL_MIN_LEN		64
+
+asmlinkage void crc32_pclmul_le_16(const u8 *buffer, unsigned int len,
+				   u32 crc, u8 *out);
+
+static u32 crc32_pclmul_le(u32 crc, const u8 *p, unsigned int len)
+{
+	u8 rem[16] __attribute__((aligned(16)));
+	unsigned int folded;
+
+	if (len < PCLMUL_MIN_LEN || !irq_fpu_usable())
+		return crc32_le(crc, p, len);
+
+	kernel_fpu_begin();
+	crc32_pclmul_le_16(p, len, crc, rem);
+	kernel_fpu_end();
+
+	folded = len & ~15U;
+	crc = crc32_le(0, rem, sizeof(rem));
+	return crc32_le(crc, p + folded, len - folded);
+}
+
+struct chksum_ctx {
+	u32 key;
+};
+
+struct chksum_desc_ctx {
+	u32 crc;
+};
+
+static int crc32_pclmul_init(struct shash_desc *desc)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(desc->tfm);
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = mctx->key;
+
+	return 0;
+}
+
+static int crc32_pclmul_setkey(struct crypto_shash *tfm, const u8 *key,
+			       unsigned int keylen)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(tfm);
+
+	if (keylen != sizeof(mctx->key)) {
+		crypto_shash_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	mctx->key = le32_to_cpu(*(__le32 *)key);
+	return 0;
+}
+
+static int crc32_pclmul_update(struct shash_desc *desc, const u8 *data,
+			       unsigned int len)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = crc32_pclmul_le(ctx->crc, data, len);
+	return 0;
+}
+
+static int crc32_pclmul_final(struct shash_desc *desc, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	*(__le32 *)out = cpu_to_le32p(&ctx->crc);
+	return 0;
+}
+
+static int __crc32_pclmul_finup(u32 *crcp, const u8 *data, unsigned int len,
+				u8 *out)
+{
+	*(__le32 *)out = cpu_to_le32(crc32_pclmul_le(*crcp, data, len));
+	return 0;
+}
+
+static int crc32_pclmul_finup(struct shash_desc *desc, const u8 *data,
+			      unsigned int len, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	return __crc32_pclmul_finup(&ctx->crc, data, len, out);
+}
+
+static int crc32_pclmul_digest(struct shash_desc *desc, const u8 *data,
+			       unsigned int len, u8 *out)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(desc->tfm);
+
+	return __crc32_pclmul_finup(&mctx->key, data, len, out);
+}
+
+static int crc32_pclmul_cra_init(struct crypto_tfm *tfm)
+{
+	struct chksum_ctx *mctx = crypto_tfm_ctx(tfm);
+
+	mctx->key = 0;
+	return 0;
+}
+
+static struct shash_alg alg = {
+	.setkey			=	crc32_pclmul_setkey,
+	.init			=	crc32_pclmul_init,
+	.update			=	crc32_pclmul_update,
+	.final			=	crc32_pclmul_final,
+	.finup			=	crc32_pclmul_finup,
+	.digest			=	crc32_pclmul_digest,
+	.descsize		=	sizeof(struct chksum_desc_ctx),
+	.digestsize		=	CHKSUM_DIGEST_SIZE,
+	.base			=	{
+		.cra_name		=	"crc32",
+		.cra_driver_name	=	"crc32-pclmul",
+		.cra_priority		=	200,
+		.cra_blocksize		=	CHKSUM_BLOCK_SIZE,
+		.cra_ctxsize		=	sizeof(struct chksum_ctx),
+		.cra_module		=	THIS_MODULE,
+		.cra_init		=	crc32_pclmul_cra_init,
+	}
+};
+
+static int __init crc32_pclmul_mod_init(void)
+{
+	if (!cpu_has_pclmulqdq) {
+		pr_info("PCLMULQDQ-NI instructions are not detected.\n");
+		return -ENODEV;
+	}
+	return crypto_register_shash(&alg);
+}
+
+static void __exit crc32_pclmul_mod_fini(void)
+{
+	crypto_unregister_shash(&alg);
+}
+
+module_init(crc32_pclmul_mod_init);
+module_exit(crc32_pclmul_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("CRC32 calculation, PCLMULQDQ accelerated");
+
+MODULE_ALIAS("crc32");
@@ -0,0 +1,137 @@
+/*
+ * Cryptographic API.
+ *
+ * Glue code for the T10 DIF CRC16 PCLMULQDQ folding implementation.
+ * Buffers shorter than 64 bytes, and any call made while the FPU can't
+ * be used, are handed to the generic slicing-by-8 code.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/internal/hash.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/kernel.h>
+#include <linux/crc-t10dif.h>
+#include <asm/cpufeature.h>
+#include <asm/i387.h>
+
+/* the folding code needs at least four 16 byte blocks */
+#define PCLMUL_MIN_LEN		64
+
+asmlinkage void crct10dif_pclmul_16(const u8 *buffer, unsigned int len,
+				    u16 crc, u8 *out);
+
+static u16 crct10dif_pclmul(u16 crc, const u8 *p, unsigned int len)
+{
+	u8 rem[16] __attribute__((aligned(16)));
+	unsigned int folded;
+
+	if (len < PCLMUL_MIN_LEN || !irq_fpu_usable())
+		return crc_t10dif_generic(crc, p, len);
+
+	kernel_fpu_begin();
+	crct10dif_pclmul_16(p, len, crc, rem);
+	kernel_fpu_end();
+
+	folded = len & ~15U;
+	crc = crc_t10dif_generic(0, rem, sizeof(rem));
+	return crc_t10dif_generic(crc, p + folded, len - folded);
+}
+
+struct chksum_desc_ctx {
+	__u16 crc;
+};
+
+static int chksum_init(struct shash_desc *desc)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = 0;
+
+	return 0;
+}
+
+static int chksum_update(struct shash_desc *desc, const u8 *data,
+			 unsigned int length)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = crct10dif_pclmul(ctx->crc, data, length);
+	return 0;
+}
+
+static int chksum_final(struct shash_desc *desc, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	*(__u16 *)out = ctx->crc;
+	return 0;
+}
+
+static int __chksum_finup(__u16 *crcp, const u8 *data, unsigned int len,
+			u8 *out)
+{
+	*(__u16 *)out = crct10dif_pclmul(*crcp, data, len);
+	return 0;
+}
+
+static int chksum_finup(struct shash_desc *desc, const u8 *data,
+			unsigned int len, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	return __chksum_finup(&ctx->crc, data, len, out);
+}
+
+static int chksum_digest(struct shash_desc *desc, const u8 *data,
+			 unsigned int length, u8 *out)
+{
+	__u16 crc = 0;
+
+	return __chksum_finup(&crc, data, length, out);
+}
+
+static struct shash_alg alg = {
+	.digestsize		=	CRC_T10DIF_DIGEST_SIZE,
+	.init			=	chksum_init,
+	.update			=	chksum_update,
+	.final			=	chksum_final,
+	.finup			=	chksum_finup,
+	.digest			=	chksum_digest,
+	.descsize		=	sizeof(struct chksum_desc_ctx),
+	.base			=	{
+		.cra_name		=	"crct10dif",
+		.cra_driver_name	=	"crct10dif-pclmul",
+		.cra_priority		=	200,
+		.cra_blocksize		=	CRC_T10DIF_BLOCK_SIZE,
+		.cra_module		=	THIS_MODULE,
+	}
+};
+
+static int __init crct10dif_pclmul_mod_init(void)
+{
+	if (!cpu_has_pclmulqdq) {
+		pr_info("PCLMULQDQ-NI instructions are not detected.\n");
+		return -ENODEV;
+	}
+	return crypto_register_shash(&alg);
+}
+
+static void __exit crct10dif_pclmul_mod_fini(void)
+{
+	crypto_unregister_shash(&alg);
+}
+
+module_init(crct10dif_pclmul_mod_init);
+module_exit(crct10dif_pclmul_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("T10 DIF CRC calculation, PCLMULQDQ accelerated");
+
+MODULE_ALIAS("crct10dif");
@@ -355,6 +355,13 @@ struct apic {
 	void (*icr_write)(u32 low, u32 high);
 	void (*wait_icr_idle)(void);
 	u32 (*safe_wait_icr_idle)(void);
+
+	/*
+	 * Called only by ack_APIC_irq(), so a paravirtualized guest can
+	 * replace the EOI write without taking over every other APIC
+	 * register access.  Normally the same as write().
+	 */
+	void (*eoi_write)(u32 reg, u32 v);
 };
 
 /*
@@ -383,6 +390,11 @@ static inline void apic_write(u32 reg, u32 val)
 	apic->write(reg, val);
 }
 
+static inline void apic_eoi_write(u32 reg, u32 val)
+{
+	apic->eoi_write(reg, val);
+}
+
 static inline u64 apic_icr_read(void)
 {
 	return apic->icr_read();
@@ -407,6 +419,7 @@ static inline u32 safe_apic_wait_icr_idle(void)
 
 static inline u32 apic_read(u32 reg) { return 0; }
 static inline void apic_write(u32 reg, u32 val) { }
+static inline void apic_eoi_write(u32 reg, u32 val) { }
 static inline u64 apic_icr_read(void) { return 0; }
 static inline void apic_icr_write(u32 low, u32 high) { }
 static inline void apic_wait_icr_idle(void) { }
@@ -422,7 +435,7 @@ static inline void ack_APIC_irq(void)
 	 */
 
 	/* Docs say use 0 for future compatibility */
-	apic_write(APIC_EOI, 0);
+	apic_eoi_write(APIC_EOI, 0);
 }
 
 static inline unsigned default_get_apic_id(unsigned long x)
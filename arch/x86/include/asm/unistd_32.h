@@ -350,10 +350,11 @@
 #define __NR_sched_setparam_ex		342
 #define __NR_sched_getparam_ex		343
 #define __NR_sched_wait_interval	344
+#define __NR_copy_file_range		345
 
 #ifdef __KERNEL__
 
-#define NR_syscalls 345
+#define NR_syscalls 346
 
 #define __ARCH_WANT_IPC_PARSE_VERSION
 #define __ARCH_WANT_OLD_READDIR
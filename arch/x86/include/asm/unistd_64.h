@@ -677,6 +677,8 @@ __SYSCALL(__NR_sched_setparam_ex, sys_sched_setparam_ex)
 __SYSCALL(__NR_sched_getparam_ex, sys_sched_getparam_ex)
 #define __NR_sched_wait_interval		306
 __SYSCALL(__NR_sched_wait_interval, sys_sched_wait_interval)
+#define __NR_copy_file_range			307
+__SYSCALL(__NR_copy_file_range, sys_copy_file_range)
 
 #ifndef __NO_STUBS
 #define __ARCH_WANT_OLD_READDIR
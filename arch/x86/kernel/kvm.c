@@ -27,7 +27,17 @@
 #include <linux/mm.h>
 #include <linux/highmem.h>
 #include <linux/hardirq.h>
+#include <linux/notifier.h>
+#include <linux/reboot.h>
+#include <linux/hash.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/kprobes.h>
 #include <asm/timer.h>
+#include <asm/traps.h>
+#include <asm/desc.h>
+#include <asm/tlbflush.h>
+#include <asm/apic.h>
 
 #define MMU_QUEUE_SIZE 1024
 
@@ -37,6 +47,18 @@ struct kvm_para_state {
 };
 
 static DEFINE_PER_CPU(struct kvm_para_state, para_state);
+static DEFINE_PER_CPU(struct kvm_vcpu_pv_apf_data, apf_reason) __aligned(64);
+static DEFINE_PER_CPU(unsigned long, kvm_apic_eoi) = KVM_PV_EOI_DISABLED;
+
+static int kvmapf = 1;
+
+static int parse_no_kvmapf(char *arg)
+{
+	kvmapf = 0;
+	return 0;
+}
+
+early_param("no-kvmapf", parse_no_kvmapf);
 
 static struct kvm_para_state *kvm_para_state(void)
 {
@@ -50,6 +72,201 @@ static void kvm_io_delay(void)
 {
 }
 
+#define KVM_TASK_SLEEP_HASHBITS 8
+#define KVM_TASK_SLEEP_HASHSIZE (1<<KVM_TASK_SLEEP_HASHBITS)
+
+struct kvm_task_sleep_node {
+	struct hlist_node link;
+	wait_queue_head_t wq;
+	u32 token;
+	int cpu;
+	bool halted;
+	bool dummy;
+};
+
+static struct kvm_task_sleep_head {
+	spinlock_t lock;
+	struct hlist_head list;
+} async_pf_sleepers[KVM_TASK_SLEEP_HASHSIZE];
+
+static struct kvm_task_sleep_node *_find_apf_task(struct kvm_task_sleep_head *b,
+						  u32 token)
+{
+	struct hlist_node *p;
+
+	hlist_for_each(p, &b->list) {
+		struct kvm_task_sleep_node *n =
+			hlist_entry(p, typeof(*n), link);
+		if (n->token == token)
+			return n;
+	}
+
+	return NULL;
+}
+
+/*
+ * The host is swapping the page at @token in: put the faulting task to
+ * sleep until the matching "page ready" notification arrives.  If this
+ * cpu cannot schedule (idle task, or preemption is disabled) halt
+ * instead and let the wakeup IPI kick us out of it.
+ */
+void kvm_async_pf_task_wait(u32 token)
+{
+	u32 key = hash_32(token, KVM_TASK_SLEEP_HASHBITS);
+	struct kvm_task_sleep_head *b = &async_pf_sleepers[key];
+	struct kvm_task_sleep_node n, *e;
+	DEFINE_WAIT(wait);
+	int cpu, idle;
+
+	cpu = get_cpu();
+	idle = idle_cpu(cpu);
+	put_cpu();
+
+	spin_lock(&b->lock);
+	e = _find_apf_task(b, token);
+	if (e) {
+		/* dummy entry exist -> wake up was delivered ahead of PF */
+		hlist_del(&e->link);
+		kfree(e);
+		spin_unlock(&b->lock);
+		return;
+	}
+
+	n.token = token;
+	n.cpu = smp_processor_id();
+	/* b->lock accounts for one level of preempt_count */
+	n.halted = idle || preempt_count() > 1;
+	n.dummy = false;
+	init_waitqueue_head(&n.wq);
+	hlist_add_head(&n.link, &b->list);
+	spin_unlock(&b->lock);
+
+	for (;;) {
+		if (!n.halted)
+			prepare_to_wait(&n.wq, &wait, TASK_UNINTERRUPTIBLE);
+		if (hlist_unhashed(&n.link))
+			break;
+
+		if (!n.halted) {
+			local_irq_enable();
+			schedule();
+			local_irq_disable();
+		} else {
+			/*
+			 * We cannot reschedule. So halt.
+			 */
+			native_safe_halt();
+			local_irq_disable();
+		}
+	}
+	if (!n.halted)
+		finish_wait(&n.wq, &wait);
+}
+EXPORT_SYMBOL_GPL(kvm_async_pf_task_wait);
+
+static void apf_task_wake_one(struct kvm_task_sleep_node *n)
+{
+	hlist_del_init(&n->link);
+	if (n->halted)
+		smp_send_reschedule(n->cpu);
+	else if (waitqueue_active(&n->wq))
+		wake_up(&n->wq);
+}
+
+static void apf_task_wake_all(void)
+{
+	int i;
+
+	for (i = 0; i < KVM_TASK_SLEEP_HASHSIZE; i++) {
+		struct hlist_node *p, *next;
+		struct kvm_task_sleep_head *b = &async_pf_sleepers[i];
+		spin_lock(&b->lock);
+		hlist_for_each_safe(p, next, &b->list) {
+			struct kvm_task_sleep_node *n =
+				hlist_entry(p, typeof(*n), link);
+			if (n->cpu != smp_processor_id())
+				continue;
+			if (n->dummy) {
+				hlist_del(&n->link);
+				kfree(n);
+			} else
+				apf_task_wake_one(n);
+		}
+		spin_unlock(&b->lock);
+	}
+}
+
+void kvm_async_pf_task_wake(u32 token)
+{
+	u32 key = hash_32(token, KVM_TASK_SLEEP_HASHBITS);
+	struct kvm_task_sleep_head *b = &async_pf_sleepers[key];
+	struct kvm_task_sleep_node *n;
+
+	if (token == ~0) {
+		apf_task_wake_all();
+		return;
+	}
+
+again:
+	spin_lock(&b->lock);
+	n = _find_apf_task(b, token);
+	if (!n) {
+		/*
+		 * async PF was not yet handled.
+		 * Add dummy entry for the token.
+		 */
+		n = kmalloc(sizeof(*n), GFP_ATOMIC);
+		if (!n) {
+			/*
+			 * Allocation failed! Busy wait while other cpu
+			 * handles async PF.
+			 */
+			spin_unlock(&b->lock);
+			cpu_relax();
+			goto again;
+		}
+		n->token = token;
+		n->cpu = smp_processor_id();
+		n->halted = false;
+		n->dummy = true;
+		init_waitqueue_head(&n->wq);
+		hlist_add_head(&n->link, &b->list);
+	} else
+		apf_task_wake_one(n);
+	spin_unlock(&b->lock);
+}
+EXPORT_SYMBOL_GPL(kvm_async_pf_task_wake);
+
+u32 kvm_read_and_reset_pf_reason(void)
+{
+	u32 reason = 0;
+
+	if (__get_cpu_var(apf_reason).enabled) {
+		reason = __get_cpu_var(apf_reason).reason;
+		__get_cpu_var(apf_reason).reason = 0;
+	}
+
+	return reason;
+}
+EXPORT_SYMBOL_GPL(kvm_read_and_reset_pf_reason);
+
+dotraplinkage void __kprobes
+do_async_page_fault(struct pt_regs *regs, unsigned long error_code)
+{
+	switch (kvm_read_and_reset_pf_reason()) {
+	default:
+		do_page_fault(regs, error_code);
+		break;
+	case KVM_PV_REASON_PAGE_NOT_PRESENT:
+		/* page is swapped out by the host. */
+		kvm_async_pf_task_wait((u32)read_cr2());
+		break;
+	case KVM_PV_REASON_PAGE_READY:
+		kvm_async_pf_task_wake((u32)read_cr2());
+		break;
+	}
+}
+
 static void kvm_mmu_op(void *buffer, unsigned len)
 {
 	int r;
@@ -231,10 +448,341 @@ static void __init paravirt_ops_setup(void)
 #endif
 }
 
+#ifdef CONFIG_X86_LOCAL_APIC
+static void kvm_guest_apic_eoi_write(u32 reg, u32 val)
+{
+	/*
+	 * The host only touches kvm_apic_eoi while this vcpu is stopped, so
+	 * a non-locked test and clear is atomic enough.  If the bit was set
+	 * the host performs the EOI on our behalf at the next exit.
+	 */
+	if (__test_and_clear_bit(KVM_PV_EOI_BIT, &__get_cpu_var(kvm_apic_eoi)))
+		return;
+	apic->write(APIC_EOI, 0);
+}
+#endif
+
+static void __cpuinit kvm_guest_cpu_init(void)
+{
+	if (!kvm_para_available())
+		return;
+
+	if (kvm_para_has_feature(KVM_FEATURE_ASYNC_PF) && kvmapf) {
+		u64 pa = __pa(&__get_cpu_var(apf_reason));
+
+#ifdef CONFIG_PREEMPT
+		pa |= KVM_ASYNC_PF_SEND_ALWAYS;
+#endif
+		wrmsrl(MSR_KVM_ASYNC_PF_EN, pa | KVM_ASYNC_PF_ENABLED);
+		__get_cpu_var(apf_reason).enabled = 1;
+		printk(KERN_INFO"KVM setup async PF for cpu %d\n",
+		       smp_processor_id());
+	}
+
+	if (kvm_para_has_feature(KVM_FEATURE_PV_EOI)) {
+		unsigned long pa;
+
+		BUILD_BUG_ON(__alignof__(kvm_apic_eoi) < 4);
+		__get_cpu_var(kvm_apic_eoi) = KVM_PV_EOI_DISABLED;
+		pa = __pa(&__get_cpu_var(kvm_apic_eoi)) | KVM_MSR_ENABLED;
+		wrmsrl(MSR_KVM_PV_EOI_EN, pa);
+	}
+}
+
+static void kvm_pv_disable_apf(void *unused)
+{
+	if (!__get_cpu_var(apf_reason).enabled)
+		return;
+
+	wrmsrl(MSR_KVM_ASYNC_PF_EN, 0);
+	__get_cpu_var(apf_reason).enabled = 0;
+
+	printk(KERN_INFO"Unregister pv shared memory for cpu %d\n",
+	       smp_processor_id());
+}
+
+static void kvm_pv_disable_eoi(void)
+{
+	if (kvm_para_has_feature(KVM_FEATURE_PV_EOI))
+		wrmsrl(MSR_KVM_PV_EOI_EN, 0);
+}
+
+static void kvm_pv_guest_cpu_reboot(void *unused)
+{
+	kvm_pv_disable_eoi();
+	kvm_pv_disable_apf(NULL);
+}
+
+static int kvm_pv_reboot_notify(struct notifier_block *nb,
+				unsigned long code, void *unused)
+{
+	if (code == SYS_RESTART)
+		on_each_cpu(kvm_pv_guest_cpu_reboot, NULL, 1);
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block kvm_pv_reboot_nb = {
+	.notifier_call = kvm_pv_reboot_notify,
+};
+
+#ifdef CONFIG_SMP
+static void __cpuinit kvm_guest_cpu_online(void *dummy)
+{
+	kvm_guest_cpu_init();
+}
+
+static void kvm_guest_cpu_offline(void *dummy)
+{
+	kvm_pv_disable_eoi();
+	kvm_pv_disable_apf(NULL);
+	apf_task_wake_all();
+}
+
+static int __cpuinit kvm_cpu_notify(struct notifier_block *self,
+				    unsigned long action, void *hcpu)
+{
+	int cpu = (unsigned long)hcpu;
+	switch (action) {
+	case CPU_ONLINE:
+	case CPU_DOWN_FAILED:
+	case CPU_ONLINE_FROZEN:
+		smp_call_function_single(cpu, kvm_guest_cpu_online, NULL, 0);
+		break;
+	case CPU_DOWN_PREPARE:
+	case CPU_DOWN_PREPARE_FROZEN:
+		smp_call_function_single(cpu, kvm_guest_cpu_offline, NULL, 1);
+		break;
+	default:
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __cpuinitdata kvm_cpu_notifier = {
+	.notifier_call	= kvm_cpu_notify,
+};
+#endif
+
+static void __init kvm_apf_trap_init(void)
+{
+	set_intr_gate(14, &async_page_fault);
+}
+
+#ifdef CONFIG_PARAVIRT_SPINLOCKS
+
+/*
+ * Paravirtual ticket spinlocks.  The lock word keeps the native layout
+ * from asm/spinlock.h, so locks taken before the switch stay valid and
+ * the native is_locked, is_contended and trylock operations are kept.
+ *
+ * A waiter spins for SPIN_THRESHOLD iterations as usual, then records
+ * which ticket it waits for and halts.  The unlocker kicks the vcpu
+ * waiting for the next ticket with KVM_HC_KICK_CPU, so a preempted lock
+ * holder no longer makes every waiter burn its whole time slice.
+ */
+#if (NR_CPUS < 256)
+typedef u8  __ticket_t;
+typedef u16 __ticketpair_t;
+#else
+typedef u16 __ticket_t;
+typedef u32 __ticketpair_t;
+#endif
+
+#define TICKET_LOCK_INC	((__ticketpair_t)1 << TICKET_SHIFT)
+#define SPIN_THRESHOLD	(1 << 15)
+
+struct kvm_ticketlock {
+	union {
+		__ticketpair_t head_tail;
+		struct __raw_tickets {
+			__ticket_t head, tail;
+		} tickets;
+	};
+};
+
+static inline struct kvm_ticketlock *to_kvm_ticketlock(arch_spinlock_t *lock)
+{
+	return (struct kvm_ticketlock *)&lock->slock;
+}
+
+struct kvm_lock_waiting {
+	struct kvm_ticketlock *lock;
+	__ticket_t want;
+};
+
+/* cpus halted in kvm_lock_spinning(), and what each of them waits for */
+static DEFINE_PER_CPU(struct kvm_lock_waiting, lock_waiting);
+static cpumask_t waiting_cpus;
+
+static void kvm_kick_cpu(int cpu)
+{
+	int apicid;
+
+	apicid = per_cpu(x86_cpu_to_apicid, cpu);
+	kvm_hypercall2(KVM_HC_KICK_CPU, 0, apicid);
+}
+
+static void kvm_lock_spinning(struct kvm_ticketlock *tl, __ticket_t want)
+{
+	struct kvm_lock_waiting *w;
+	unsigned long flags;
+	int cpu;
+
+	/* an NMI must not halt; keep spinning */
+	if (in_nmi())
+		return;
+
+	local_irq_save(flags);
+
+	w = &__get_cpu_var(lock_waiting);
+	cpu = smp_processor_id();
+
+	/* the unlocker must never see a new lock with a stale ticket */
+	w->want = want;
+	smp_wmb();
+	w->lock = tl;
+
+	/* set_bit is a locked operation and orders against the head read */
+	cpumask_set_cpu(cpu, &waiting_cpus);
+
+	/* the lock may have been released while we were setting up */
+	if (ACCESS_ONCE(tl->tickets.head) == want)
+		goto out;
+
+	/*
+	 * A kick that already happened makes the halt return at once.  If
+	 * interrupts were enabled, keep them enabled while halted: a handler
+	 * that spins on another lock overwrites our lock_waiting entry, and
+	 * the interrupt itself is then what sends us back to spinning.
+	 */
+	if (arch_irqs_disabled_flags(flags))
+		halt();
+	else
+		safe_halt();
+
+out:
+	cpumask_clear_cpu(cpu, &waiting_cpus);
+	w->lock = NULL;
+	local_irq_restore(flags);
+}
+
+static void kvm_unlock_kick(struct kvm_ticketlock *tl, __ticket_t next)
+{
+	int cpu;
+
+	for_each_cpu(cpu, &waiting_cpus) {
+		const struct kvm_lock_waiting *w = &per_cpu(lock_waiting, cpu);
+
+		if (ACCESS_ONCE(w->lock) == tl && ACCESS_ONCE(w->want) == next) {
+			kvm_kick_cpu(cpu);
+			break;
+		}
+	}
+}
+
+static __always_inline __ticketpair_t kvm_ticket_xadd(struct kvm_ticketlock *tl,
+						      __ticketpair_t inc)
+{
+	asm volatile(LOCK_PREFIX "xadd %0, %1"
+		     : "+r" (inc), "+m" (tl->head_tail)
+		     :
+		     : "memory", "cc");
+	return inc;
+}
+
+static void kvm_spin_lock(arch_spinlock_t *lock)
+{
+	struct kvm_ticketlock *tl = to_kvm_ticketlock(lock);
+	struct kvm_ticketlock old;
+
+	old.head_tail = kvm_ticket_xadd(tl, TICKET_LOCK_INC);
+	if (likely(old.tickets.head == old.tickets.tail))
+		goto out;
+
+	for (;;) {
+		unsigned count = SPIN_THRESHOLD;
+
+		do {
+			if (ACCESS_ONCE(tl->tickets.head) == old.tickets.tail)
+				goto out;
+			cpu_relax();
+		} while (--count);
+		kvm_lock_spinning(tl, old.tickets.tail);
+	}
+out:
+	barrier();	/* make sure nothing creeps before the lock is taken */
+}
+
+static void kvm_spin_lock_flags(arch_spinlock_t *lock, unsigned long flags)
+{
+	kvm_spin_lock(lock);
+}
+
+static void kvm_spin_unlock(arch_spinlock_t *lock)
+{
+	struct kvm_ticketlock *tl = to_kvm_ticketlock(lock);
+	__ticket_t next = tl->tickets.head + 1;
+
+	__ticket_spin_unlock(lock);
+
+	/* order the release against the waiting_cpus read, see above */
+	smp_mb();
+	if (unlikely(!cpumask_empty(&waiting_cpus)))
+		kvm_unlock_kick(tl, next);
+}
+
+/*
+ * Called from kvm_guest_init(), while the boot cpu is still the only one
+ * running and before the paravirt call sites get patched.
+ */
+static void __init kvm_spinlock_init(void)
+{
+	if (!kvm_para_has_feature(KVM_FEATURE_PV_UNHALT))
+		return;
+
+	pv_lock_ops.spin_lock = kvm_spin_lock;
+	pv_lock_ops.spin_lock_flags = kvm_spin_lock_flags;
+	pv_lock_ops.spin_unlock = kvm_spin_unlock;
+}
+#else
+static inline void kvm_spinlock_init(void)
+{
+}
+#endif	/* CONFIG_PARAVIRT_SPINLOCKS */
+
 void __init kvm_guest_init(void)
 {
+	int i;
+
 	if (!kvm_para_available())
 		return;
 
 	paravirt_ops_setup();
+	register_reboot_notifier(&kvm_pv_reboot_nb);
+	for (i = 0; i < KVM_TASK_SLEEP_HASHSIZE; i++)
+		spin_lock_init(&async_pf_sleepers[i].lock);
+	if (kvm_para_has_feature(KVM_FEATURE_ASYNC_PF))
+		x86_init.irqs.trap_init = kvm_apf_trap_init;
+	kvm_spinlock_init();
+
+#ifdef CONFIG_SMP
+	register_cpu_notifier(&kvm_cpu_notifier);
+#endif
+}
+
+/*
+ * The per-cpu areas are only set up after kvm_guest_init(), so the boot
+ * cpu registers its async PF and PV EOI areas from an early initcall;
+ * secondary cpus do it from the cpu notifier once they are online.  The
+ * apic driver is final by now, so this is also where the EOI hook goes.
+ */
+static int __init kvm_guest_boot_cpu_init(void)
+{
+#ifdef CONFIG_X86_LOCAL_APIC
+	if (kvm_para_available() && kvm_para_has_feature(KVM_FEATURE_PV_EOI))
+		apic->eoi_write = kvm_guest_apic_eoi_write;
+#endif
+	kvm_guest_cpu_init();
+	return 0;
 }
+early_initcall(kvm_guest_boot_cpu_init);
@@ -187,6 +187,18 @@ static int find_highest_vector(void *bitmap)
 		return fls(word[word_offset << 2]) - 1 + (word_offset << 5);
 }
 
+static int count_vectors(void *bitmap)
+{
+	u32 *word = bitmap;
+	int word_offset;
+	int count = 0;
+
+	for (word_offset = 0; word_offset < MAX_APIC_VECTOR >> 5; ++word_offset)
+		count += hweight32(word[word_offset << 2]);
+
+	return count;
+}
+
 static inline int apic_test_and_set_irr(int vec, struct kvm_lapic *apic)
 {
 	apic->irr_pending = true;
@@ -1175,12 +1187,107 @@ void __kvm_migrate_apic_timer(struct kvm_vcpu *vcpu)
 		hrtimer_start_expires(timer, HRTIMER_MODE_ABS);
 }
 
+/*
+ * Paravirtual EOI: while the guest bit is set, the guest may skip the EOI
+ * register write for the highest in-service vector by clearing the bit
+ * instead, and the EOI is performed on its behalf at the next exit.
+ */
+static bool pv_eoi_enabled(struct kvm_vcpu *vcpu)
+{
+	return vcpu->arch.pv_eoi.msr_val & KVM_MSR_ENABLED;
+}
+
+static gpa_t pv_eoi_gpa(struct kvm_vcpu *vcpu)
+{
+	return vcpu->arch.pv_eoi.msr_val & ~(u64)KVM_MSR_ENABLED;
+}
+
+static int pv_eoi_put_user(struct kvm_vcpu *vcpu, u8 val)
+{
+	return kvm_write_guest(vcpu->kvm, pv_eoi_gpa(vcpu), &val, sizeof(val));
+}
+
+int kvm_lapic_enable_pv_eoi(struct kvm_vcpu *vcpu, u64 data)
+{
+	gpa_t addr = data & ~(u64)KVM_MSR_ENABLED;
+
+	if (!IS_ALIGNED(addr, 4))
+		return 1;
+
+	vcpu->arch.pv_eoi.msr_val = data;
+	vcpu->arch.pv_eoi.pending = false;
+	if (!pv_eoi_enabled(vcpu))
+		return 0;
+
+	if (kvm_is_error_hva(gfn_to_hva(vcpu->kvm, addr >> PAGE_SHIFT))) {
+		vcpu->arch.pv_eoi.msr_val = 0;
+		return 1;
+	}
+	return 0;
+}
+
+static void apic_sync_pv_eoi_from_guest(struct kvm_vcpu *vcpu,
+					struct kvm_lapic *apic)
+{
+	u8 val;
+
+	if (!vcpu->arch.pv_eoi.pending)
+		return;
+	vcpu->arch.pv_eoi.pending = false;
+
+	if (kvm_read_guest(vcpu->kvm, pv_eoi_gpa(vcpu), &val, sizeof(val)) < 0)
+		return;
+
+	/*
+	 * Still set: the guest has not acked the interrupt yet.  Clear it
+	 * so the guest falls back to the EOI register; the next pass
+	 * through kvm_lapic_sync_to_vapic() arms it again if possible.
+	 */
+	if (val & KVM_PV_EOI_ENABLED) {
+		pv_eoi_put_user(vcpu, KVM_PV_EOI_DISABLED);
+		return;
+	}
+
+	apic_set_eoi(apic);
+}
+
+static void apic_sync_pv_eoi_to_guest(struct kvm_vcpu *vcpu,
+				      struct kvm_lapic *apic)
+{
+	int vector;
+
+	if (!pv_eoi_enabled(vcpu) || apic->irr_pending)
+		return;
+
+	/*
+	 * Only a single in-service vector can be acked behind our back:
+	 * with nested interrupts the guest's EOI has to lower the PPR for
+	 * the one below.  Level triggered and ioapic routed vectors need
+	 * the EOI to reach the ioapic right away, so leave those to the
+	 * register write as well.
+	 */
+	if (count_vectors(apic->regs + APIC_ISR) != 1)
+		return;
+	vector = apic_find_highest_isr(apic);
+	if (kvm_ioapic_handles_vector(vcpu->kvm, vector))
+		return;
+
+	if (pv_eoi_put_user(vcpu, KVM_PV_EOI_ENABLED) < 0)
+		return;
+	vcpu->arch.pv_eoi.pending = true;
+}
+
 void kvm_lapic_sync_from_vapic(struct kvm_vcpu *vcpu)
 {
 	u32 data;
 	void *vapic;
 
-	if (!irqchip_in_kernel(vcpu->kvm) || !vcpu->arch.apic->vapic_addr)
+	if (!irqchip_in_kernel(vcpu->kvm))
+		return;
+
+	apic_sync_pv_eoi_from_guest(vcpu, vcpu->arch.apic);
+
+	if (!vcpu->arch.apic->vapic_addr)
 		return;
 
 	vapic = kmap_atomic(vcpu->arch.apic->vapic_page, KM_USER0);
@@ -1197,10 +1304,15 @@ void kvm_lapic_sync_to_vapic(struct kvm_vcpu *vcpu)
 	struct kvm_lapic *apic;
 	void *vapic;
 
-	if (!irqchip_in_kernel(vcpu->kvm) || !vcpu->arch.apic->vapic_addr)
+	if (!irqchip_in_kernel(vcpu->kvm))
 		return;
 
 	apic = vcpu->arch.apic;
+	apic_sync_pv_eoi_to_guest(vcpu, apic);
+
+	if (!apic->vapic_addr)
+		return;
+
 	tpr = apic_get_reg(apic, APIC_TASKPRI) & 0xff;
 	max_irr = apic_find_highest_irr(apic);
 	if (max_irr < 0)
@@ -1092,6 +1092,7 @@ static void set_lguest_basic_apic_ops(void)
 {
 	apic->read = lguest_apic_read;
 	apic->write = lguest_apic_write;
+	apic->eoi_write = lguest_apic_write;
 	apic->icr_read = lguest_apic_icr_read;
 	apic->icr_write = lguest_apic_icr_write;
 	apic->wait_icr_idle = lguest_apic_wait_icr_idle;
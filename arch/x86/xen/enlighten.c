@@ -739,6 +739,7 @@ static void set_xen_basic_apic_ops(void)
 {
 	apic->read = xen_apic_read;
 	apic->write = xen_apic_write;
+	apic->eoi_write = xen_apic_write;
 	apic->icr_read = xen_apic_icr_read;
 	apic->icr_write = xen_apic_icr_write;
 	apic->wait_icr_idle = xen_apic_wait_icr_idle;
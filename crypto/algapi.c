@@ -367,6 +367,7 @@ int crypto_register_alg(struct crypto_alg *alg)
 		return PTR_ERR(larval);
 
 	crypto_wait_for_test(larval);
+	crypto_notify(CRYPTO_MSG_ALG_LOADED, alg);
 	return 0;
 }
 EXPORT_SYMBOL_GPL(crypto_register_alg);
@@ -26,6 +26,11 @@
 #include <linux/jiffies.h>
 #include <linux/timex.h>
 #include <linux/interrupt.h>
+#include <linux/kthread.h>
+#include <linux/cpu.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include "tcrypt.h"
 #include "internal.h"
 
@@ -57,7 +62,7 @@ static char *check[] = {
 	"cast6", "arc4", "michael_mic", "deflate", "crc32c", "tea", "xtea",
 	"khazad", "wp512", "wp384", "wp256", "tnepres", "xeta",  "fcrypt",
 	"camellia", "seed", "salsa20", "rmd128", "rmd160", "rmd256", "rmd320",
-	"lzo", "cts", "zlib", NULL
+	"lzo", "cts", "zlib", "crc32", "crct10dif", NULL
 };
 
 static int test_cipher_jiffies(struct blkcipher_desc *desc, int enc,
@@ -711,6 +716,538 @@ out:
 	crypto_free_ahash(tfm);
 }
 
+/*
+ * Multi-threaded throughput test.
+ *
+ * One kthread is bound to each selected CPU and keeps mt_inflight
+ * asynchronous requests outstanding on a shared tfm for sec seconds.
+ * Completions may run on any CPU (cryptd and pcrypt hand them to their
+ * own workers), so each thread's statistics are protected by a lock
+ * that is taken with interrupts disabled.
+ *
+ * Latencies are kept in a log-linear histogram with eight buckets per
+ * power of two of nanoseconds, which bounds the percentile error to
+ * 12.5%.
+ */
+#define TCRYPT_MT_MODE(m)	((m) >= 600 && (m) < 700)
+
+enum {
+	MT_SKCIPHER,
+	MT_AEAD,
+	MT_AHASH,
+};
+
+#define MT_HIST_SUB_BITS	3
+#define MT_HIST_SUB		(1 << MT_HIST_SUB_BITS)
+#define MT_HIST_BUCKETS		(40 * MT_HIST_SUB)
+#define MT_MAX_IV		64
+#define MT_AEAD_ASSOCLEN	8
+
+static unsigned int mt_threads;
+static unsigned int mt_inflight = 8;
+static unsigned int mt_blen = 4096;
+static unsigned int mt_klen;
+
+struct tcrypt_mt_thread;
+
+struct tcrypt_mt_req {
+	struct tcrypt_mt_thread *thread;
+	struct list_head list;
+	void *req;
+	u8 *buf;
+	ktime_t start;
+	struct scatterlist sg;
+	struct scatterlist asg;
+	u8 iv[MT_MAX_IV];
+	u8 assoc[MT_AEAD_ASSOCLEN];
+	u8 result[64];
+};
+
+struct tcrypt_mt_thread {
+	struct tcrypt_mt_test *test;
+	struct task_struct *task;
+	unsigned int cpu;
+	struct completion done;
+
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	struct list_head free;
+	unsigned int nfree;
+
+	u64 ops;
+	u64 bytes;
+	int err;
+	u32 hist[MT_HIST_BUCKETS];
+
+	struct tcrypt_mt_req *reqs;
+};
+
+struct tcrypt_mt_test {
+	int kind;
+	union {
+		struct crypto_ablkcipher *skcipher;
+		struct crypto_aead *aead;
+		struct crypto_ahash *ahash;
+	} tfm;
+	unsigned int blen;
+	unsigned int extra;
+	unsigned long end;
+	bool abort;
+	struct completion start;
+};
+
+static unsigned int mt_hist_index(u64 ns)
+{
+	unsigned int msb;
+
+	if (ns < MT_HIST_SUB)
+		return ns;
+
+	msb = fls64(ns) - 1;
+	return min_t(unsigned int, MT_HIST_BUCKETS - 1,
+		     (msb - MT_HIST_SUB_BITS + 1) * MT_HIST_SUB +
+		     ((ns >> (msb - MT_HIST_SUB_BITS)) & (MT_HIST_SUB - 1)));
+}
+
+static u64 mt_hist_value(unsigned int idx)
+{
+	unsigned int msb;
+
+	if (idx < MT_HIST_SUB)
+		return idx;
+
+	msb = idx / MT_HIST_SUB + MT_HIST_SUB_BITS - 1;
+	return (u64)(MT_HIST_SUB + idx % MT_HIST_SUB) <<
+	       (msb - MT_HIST_SUB_BITS);
+}
+
+/* latency in ns below which permille/1000 of the samples fall */
+static u64 mt_hist_percentile(const u32 *hist, u64 count,
+			      unsigned int permille)
+{
+	u64 want = div_u64(count * permille + 999, 1000);
+	u64 seen = 0;
+	unsigned int i;
+
+	for (i = 0; i < MT_HIST_BUCKETS; i++) {
+		seen += hist[i];
+		if (seen >= want)
+			return mt_hist_value(i);
+	}
+	return mt_hist_value(MT_HIST_BUCKETS - 1);
+}
+
+static void mt_req_done(struct tcrypt_mt_req *r, int err)
+{
+	struct tcrypt_mt_thread *t = r->thread;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), r->start));
+	unsigned long flags;
+
+	spin_lock_irqsave(&t->lock, flags);
+	if (err) {
+		if (!t->err)
+			t->err = err;
+	} else {
+		t->ops++;
+		t->bytes += t->test->blen;
+		t->hist[mt_hist_index(ns)]++;
+	}
+	list_add_tail(&r->list, &t->free);
+	t->nfree++;
+	/*
+	 * Wake up under the lock: once the last request is back the thread
+	 * may finish and the test free the statistics right away.
+	 */
+	wake_up(&t->wait);
+	spin_unlock_irqrestore(&t->lock, flags);
+}
+
+static void mt_complete(struct crypto_async_request *req, int err)
+{
+	/* a backlogged request has just been queued, wait for the result */
+	if (err == -EINPROGRESS)
+		return;
+
+	mt_req_done(req->data, err);
+}
+
+static int mt_submit(struct tcrypt_mt_req *r)
+{
+	int ret;
+
+	r->start = ktime_get();
+
+	switch (r->thread->test->kind) {
+	case MT_SKCIPHER:
+		ret = crypto_ablkcipher_encrypt(r->req);
+		break;
+	case MT_AEAD:
+		ret = crypto_aead_encrypt(r->req);
+		break;
+	default:
+		ret = crypto_ahash_digest(r->req);
+		break;
+	}
+
+	if (ret == -EINPROGRESS || ret == -EBUSY)
+		return 0;
+
+	/* completed synchronously, the callback will not be called */
+	mt_req_done(r, ret);
+	return ret;
+}
+
+static struct tcrypt_mt_req *mt_get_free(struct tcrypt_mt_thread *t)
+{
+	struct tcrypt_mt_req *r = NULL;
+
+	spin_lock_irq(&t->lock);
+	if (!list_empty(&t->free)) {
+		r = list_first_entry(&t->free, struct tcrypt_mt_req, list);
+		list_del(&r->list);
+		t->nfree--;
+	}
+	spin_unlock_irq(&t->lock);
+
+	return r;
+}
+
+static bool mt_all_free(struct tcrypt_mt_thread *t)
+{
+	bool ret;
+
+	spin_lock_irq(&t->lock);
+	ret = t->nfree == mt_inflight;
+	spin_unlock_irq(&t->lock);
+
+	return ret;
+}
+
+static int mt_thread_fn(void *data)
+{
+	struct tcrypt_mt_thread *t = data;
+	struct tcrypt_mt_test *test = t->test;
+	struct tcrypt_mt_req *r;
+
+	wait_for_completion(&test->start);
+
+	while (!test->abort && time_before(jiffies, test->end)) {
+		r = mt_get_free(t);
+		if (!r) {
+			wait_event_timeout(t->wait, t->nfree, HZ / 10);
+			continue;
+		}
+		if (mt_submit(r))
+			break;
+		cond_resched();
+	}
+
+	/* drain the requests still in flight before the buffers go away */
+	wait_event(t->wait, mt_all_free(t));
+
+	complete(&t->done);
+	return 0;
+}
+
+static void mt_free_reqs(struct tcrypt_mt_thread *t)
+{
+	struct tcrypt_mt_test *test = t->test;
+	unsigned int i;
+
+	if (!t->reqs)
+		return;
+
+	for (i = 0; i < mt_inflight; i++) {
+		struct tcrypt_mt_req *r = &t->reqs[i];
+
+		kfree(r->buf);
+		if (!r->req)
+			continue;
+		switch (test->kind) {
+		case MT_SKCIPHER:
+			ablkcipher_request_free(r->req);
+			break;
+		case MT_AEAD:
+			aead_request_free(r->req);
+			break;
+		default:
+			ahash_request_free(r->req);
+			break;
+		}
+	}
+	kfree(t->reqs);
+}
+
+static int mt_alloc_reqs(struct tcrypt_mt_thread *t)
+{
+	struct tcrypt_mt_test *test = t->test;
+	unsigned int i;
+
+	t->reqs = kcalloc(mt_inflight, sizeof(*t->reqs), GFP_KERNEL);
+	if (!t->reqs)
+		return -ENOMEM;
+
+	for (i = 0; i < mt_inflight; i++) {
+		struct tcrypt_mt_req *r = &t->reqs[i];
+
+		r->thread = t;
+		r->buf = kmalloc(test->blen + test->extra, GFP_KERNEL);
+		if (!r->buf)
+			return -ENOMEM;
+		memset(r->buf, 0xff, test->blen + test->extra);
+		memset(r->iv, 0xff, sizeof(r->iv));
+		sg_init_one(&r->sg, r->buf, test->blen + test->extra);
+
+		switch (test->kind) {
+		case MT_SKCIPHER: {
+			struct ablkcipher_request *req;
+
+			req = ablkcipher_request_alloc(test->tfm.skcipher,
+						       GFP_KERNEL);
+			if (!req)
+				return -ENOMEM;
+			ablkcipher_request_set_callback(req,
+					CRYPTO_TFM_REQ_MAY_BACKLOG,
+					mt_complete, r);
+			ablkcipher_request_set_crypt(req, &r->sg, &r->sg,
+						     test->blen, r->iv);
+			r->req = req;
+			break;
+		}
+		case MT_AEAD: {
+			struct aead_request *req;
+
+			req = aead_request_alloc(test->tfm.aead, GFP_KERNEL);
+			if (!req)
+				return -ENOMEM;
+			sg_init_one(&r->asg, r->assoc, sizeof(r->assoc));
+			aead_request_set_callback(req,
+					CRYPTO_TFM_REQ_MAY_BACKLOG,
+					mt_complete, r);
+			aead_request_set_assoc(req, &r->asg, sizeof(r->assoc));
+			aead_request_set_crypt(req, &r->sg, &r->sg,
+					       test->blen, r->iv);
+			r->req = req;
+			break;
+		}
+		default: {
+			struct ahash_request *req;
+
+			req = ahash_request_alloc(test->tfm.ahash, GFP_KERNEL);
+			if (!req)
+				return -ENOMEM;
+			ahash_request_set_callback(req,
+					CRYPTO_TFM_REQ_MAY_BACKLOG,
+					mt_complete, r);
+			ahash_request_set_crypt(req, &r->sg, r->result,
+						test->blen);
+			r->req = req;
+			break;
+		}
+		}
+
+		list_add_tail(&r->list, &t->free);
+		t->nfree++;
+	}
+
+	return 0;
+}
+
+static int mt_alloc_tfm(struct tcrypt_mt_test *test, const char *algo)
+{
+	static const u8 key[64] = {
+		[0 ... 63] = 0x5a,
+	};
+	unsigned int klen = mt_klen;
+	int ret;
+
+	switch (test->kind) {
+	case MT_SKCIPHER:
+		test->tfm.skcipher = crypto_alloc_ablkcipher(algo, 0, 0);
+		if (IS_ERR(test->tfm.skcipher))
+			return PTR_ERR(test->tfm.skcipher);
+		if (crypto_ablkcipher_ivsize(test->tfm.skcipher) > MT_MAX_IV)
+			return -EINVAL;
+		ret = crypto_ablkcipher_setkey(test->tfm.skcipher, key,
+					       klen ?: 16);
+		break;
+	case MT_AEAD:
+		test->tfm.aead = crypto_alloc_aead(algo, 0, 0);
+		if (IS_ERR(test->tfm.aead))
+			return PTR_ERR(test->tfm.aead);
+		if (crypto_aead_ivsize(test->tfm.aead) > MT_MAX_IV)
+			return -EINVAL;
+		test->extra = crypto_aead_authsize(test->tfm.aead);
+		/* AES-128 plus the four byte nonce of rfc4106/rfc4309 */
+		ret = crypto_aead_setkey(test->tfm.aead, key, klen ?: 20);
+		break;
+	default:
+		test->tfm.ahash = crypto_alloc_ahash(algo, 0, 0);
+		if (IS_ERR(test->tfm.ahash))
+			return PTR_ERR(test->tfm.ahash);
+		if (crypto_ahash_digestsize(test->tfm.ahash) >
+		    sizeof(((struct tcrypt_mt_req *)NULL)->result))
+			return -EINVAL;
+		ret = klen ? crypto_ahash_setkey(test->tfm.ahash, key, klen)
+			   : 0;
+		break;
+	}
+
+	return ret;
+}
+
+static void mt_free_tfm(struct tcrypt_mt_test *test)
+{
+	switch (test->kind) {
+	case MT_SKCIPHER:
+		if (!IS_ERR_OR_NULL(test->tfm.skcipher))
+			crypto_free_ablkcipher(test->tfm.skcipher);
+		break;
+	case MT_AEAD:
+		if (!IS_ERR_OR_NULL(test->tfm.aead))
+			crypto_free_aead(test->tfm.aead);
+		break;
+	default:
+		if (!IS_ERR_OR_NULL(test->tfm.ahash))
+			crypto_free_ahash(test->tfm.ahash);
+		break;
+	}
+}
+
+static void mt_report(struct tcrypt_mt_test *test,
+		      struct tcrypt_mt_thread *threads, unsigned int nr,
+		      unsigned int sec)
+{
+	static u32 hist[MT_HIST_BUCKETS];
+	u64 ops = 0, bytes = 0;
+	unsigned int i, j;
+
+	memset(hist, 0, sizeof(hist));
+
+	for (i = 0; i < nr; i++) {
+		struct tcrypt_mt_thread *t = &threads[i];
+
+		printk(KERN_INFO "cpu%3u: %10llu opers, %8llu KB/s, "
+		       "p50 %7llu ns, p99 %8llu ns%s\n", t->cpu,
+		       t->ops, div_u64(t->bytes, 1024 * sec),
+		       mt_hist_percentile(t->hist, t->ops, 500),
+		       mt_hist_percentile(t->hist, t->ops, 990),
+		       t->err ? " (failed)" : "");
+
+		ops += t->ops;
+		bytes += t->bytes;
+		for (j = 0; j < MT_HIST_BUCKETS; j++)
+			hist[j] += t->hist[j];
+	}
+
+	printk(KERN_INFO "total: %llu opers/sec, %llu bytes/sec\n",
+	       div_u64(ops, sec), div_u64(bytes, sec));
+	printk(KERN_INFO "latency: p50 %llu ns, p90 %llu ns, p99 %llu ns, "
+	       "p99.9 %llu ns\n",
+	       mt_hist_percentile(hist, ops, 500),
+	       mt_hist_percentile(hist, ops, 900),
+	       mt_hist_percentile(hist, ops, 990),
+	       mt_hist_percentile(hist, ops, 999));
+}
+
+static void test_mt_speed(const char *algo, int kind, unsigned int sec)
+{
+	struct tcrypt_mt_thread *threads;
+	struct tcrypt_mt_test test;
+	unsigned int nr, i, cpu;
+	int ret;
+
+	if (!sec)
+		sec = 1;
+	if (!mt_inflight)
+		mt_inflight = 1;
+
+	memset(&test, 0, sizeof(test));
+	test.kind = kind;
+	test.blen = mt_blen;
+	init_completion(&test.start);
+
+	get_online_cpus();
+
+	nr = mt_threads ?: num_online_cpus();
+
+	printk(KERN_INFO "\ntesting multi-threaded speed of %s: %u threads, "
+	       "%u requests in flight each, %u byte blocks, %u seconds\n",
+	       algo, nr, mt_inflight, mt_blen, sec);
+
+	ret = mt_alloc_tfm(&test, algo);
+	if (ret) {
+		printk(KERN_ERR "failed to set up transform for %s: %d\n",
+		       algo, ret);
+		goto out_tfm;
+	}
+
+	threads = kcalloc(nr, sizeof(*threads), GFP_KERNEL);
+	if (!threads) {
+		ret = -ENOMEM;
+		goto out_tfm;
+	}
+
+	cpu = cpumask_first(cpu_online_mask);
+	for (i = 0; i < nr; i++) {
+		struct tcrypt_mt_thread *t = &threads[i];
+
+		t->test = &test;
+		t->cpu = cpu;
+		spin_lock_init(&t->lock);
+		init_waitqueue_head(&t->wait);
+		init_completion(&t->done);
+		INIT_LIST_HEAD(&t->free);
+
+		ret = mt_alloc_reqs(t);
+		if (ret)
+			goto out_threads;
+
+		t->task = kthread_create(mt_thread_fn, t, "tcrypt_mt/%u", cpu);
+		if (IS_ERR(t->task)) {
+			ret = PTR_ERR(t->task);
+			t->task = NULL;
+			goto out_threads;
+		}
+		kthread_bind(t->task, cpu);
+		wake_up_process(t->task);
+
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+	}
+
+	test.end = jiffies + sec * HZ;
+	complete_all(&test.start);
+
+	for (i = 0; i < nr; i++)
+		wait_for_completion(&threads[i].done);
+
+	mt_report(&test, threads, nr, sec);
+
+	for (i = 0; i < nr; i++)
+		if (threads[i].err && !ret)
+			ret = threads[i].err;
+
+out_threads:
+	if (ret && !completion_done(&test.start)) {
+		test.abort = true;
+		complete_all(&test.start);
+		for (i = 0; i < nr && threads[i].task; i++)
+			wait_for_completion(&threads[i].done);
+	}
+	for (i = 0; i < nr; i++)
+		mt_free_reqs(&threads[i]);
+	kfree(threads);
+out_tfm:
+	mt_free_tfm(&test);
+	put_online_cpus();
+
+	if (ret)
+		printk(KERN_ERR "multi-threaded test of %s failed: %d\n",
+		       algo, ret);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -936,6 +1473,14 @@ static int do_test(int m)
 		ret += tcrypt_test("rfc4309(ccm(aes))");
 		break;
 
+	case 46:
+		ret += tcrypt_test("crc32");
+		break;
+
+	case 47:
+		ret += tcrypt_test("crct10dif");
+		break;
+
 	case 100:
 		ret += tcrypt_test("hmac(md5)");
 		break;
@@ -1138,6 +1683,14 @@ static int do_test(int m)
 		test_hash_speed("ghash-generic", sec, hash_speed_template_16);
 		if (mode > 300 && mode < 400) break;
 
+	case 319:
+		test_hash_speed("crc32", sec, generic_hash_speed_template);
+		if (mode > 300 && mode < 400) break;
+
+	case 320:
+		test_hash_speed("crct10dif", sec, generic_hash_speed_template);
+		if (mode > 300 && mode < 400) break;
+
 	case 399:
 		break;
 
@@ -1212,9 +1765,29 @@ static int do_test(int m)
 		test_ahash_speed("rmd320", sec, generic_hash_speed_template);
 		if (mode > 400 && mode < 500) break;
 
+	case 418:
+		test_ahash_speed("crc32", sec, generic_hash_speed_template);
+		if (mode > 400 && mode < 500) break;
+
+	case 419:
+		test_ahash_speed("crct10dif", sec, generic_hash_speed_template);
+		if (mode > 400 && mode < 500) break;
+
 	case 499:
 		break;
 
+	case 600:
+		test_mt_speed(alg ?: "cbc(aes)", MT_SKCIPHER, sec);
+		break;
+
+	case 601:
+		test_mt_speed(alg ?: "rfc4106(gcm(aes))", MT_AEAD, sec);
+		break;
+
+	case 602:
+		test_mt_speed(alg ?: "sha256", MT_AHASH, sec);
+		break;
+
 	case 1000:
 		test_available();
 		break;
@@ -1240,7 +1813,8 @@ static int __init tcrypt_mod_init(void)
 			goto err_free_tv;
 	}
 
-	if (alg)
+	/* the multi-threaded modes take the algorithm from alg= */
+	if (alg && !TCRYPT_MT_MODE(mode))
 		err = do_alg_test(alg, type, mask);
 	else
 		err = do_test(mode);
@@ -1283,6 +1857,16 @@ module_param(mode, int, 0);
 module_param(sec, uint, 0);
 MODULE_PARM_DESC(sec, "Length in seconds of speed tests "
 		      "(defaults to zero which uses CPU cycles instead)");
+module_param(mt_threads, uint, 0);
+MODULE_PARM_DESC(mt_threads, "Threads for the multi-threaded tests "
+		 "(defaults to one per online CPU)");
+module_param(mt_inflight, uint, 0);
+MODULE_PARM_DESC(mt_inflight, "Requests each thread keeps in flight");
+module_param(mt_blen, uint, 0);
+MODULE_PARM_DESC(mt_blen, "Bytes per request in the multi-threaded tests");
+module_param(mt_klen, uint, 0);
+MODULE_PARM_DESC(mt_klen, "Key length for the multi-threaded tests "
+		 "(defaults to 16, or 20 for AEADs; unkeyed for hashes)");
 
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("Quick & dirty crypto testing module");
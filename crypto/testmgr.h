@@ -443,7 +443,7 @@ static struct hash_testvec rmd320_tv_template[] = {
 /*
  * SHA1 test vectors  from from FIPS PUB 180-1
  */
-#define SHA1_TEST_VECTORS	2
+#define SHA1_TEST_VECTORS	3
 
 static struct hash_testvec sha1_tv_template[] = {
 	{
@@ -458,6 +458,14 @@ static struct hash_testvec sha1_tv_template[] = {
 			  "\x4a\xa1\xf9\x51\x29\xe5\xe5\x46\x70\xf1",
 		.np	= 2,
 		.tap	= { 28, 28 }
+	}, {
+		.plaintext = "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+			     "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"
+			     "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+			     "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+		.psize	= 224,
+		.digest	= "\x0c\x35\xf0\x42\xb1\x3b\xa2\xaa\xb1\xf6"
+			  "\xf0\x1c\x63\x80\x54\x09\x01\x7f\x41\x1a",
 	}
 };
 
@@ -465,7 +473,7 @@ static struct hash_testvec sha1_tv_template[] = {
 /*
  * SHA224 test vectors from from FIPS PUB 180-2
  */
-#define SHA224_TEST_VECTORS     2
+#define SHA224_TEST_VECTORS     3
 
 static struct hash_testvec sha224_tv_template[] = {
 	{
@@ -485,13 +493,23 @@ static struct hash_testvec sha224_tv_template[] = {
 			  "\x52\x52\x25\x25",
 		.np     = 2,
 		.tap    = { 28, 28 }
+	}, {
+		.plaintext = "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+			     "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"
+			     "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+			     "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+		.psize  = 224,
+		.digest = "\x8b\x18\xf9\x5e\xc5\x3e\x99\x3f"
+			  "\xf6\x37\xc8\xc4\xe0\x68\x75\xea"
+			  "\x7b\xed\x04\x2f\x84\x17\x41\xea"
+			  "\xcb\x26\x7c\x9f",
 	}
 };
 
 /*
  * SHA256 test vectors from from NIST
  */
-#define SHA256_TEST_VECTORS	2
+#define SHA256_TEST_VECTORS	3
 
 static struct hash_testvec sha256_tv_template[] = {
 	{
@@ -510,6 +528,16 @@ static struct hash_testvec sha256_tv_template[] = {
 			  "\xf6\xec\xed\xd4\x19\xdb\x06\xc1",
 		.np	= 2,
 		.tap	= { 28, 28 }
+	}, {
+		.plaintext = "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+			     "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"
+			     "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+			     "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+		.psize	= 224,
+		.digest	= "\xcd\xbf\x86\x7f\x78\x4a\x69\xc7"
+			  "\xd2\xe2\x52\xba\xa9\x07\x5c\x37"
+			  "\x62\x84\x3b\x1b\xeb\x52\xc0\x4d"
+			  "\x4b\xe3\x9e\x77\x77\xd9\x57\x17",
 	},
 };
 
@@ -2947,6 +2975,8 @@ static struct cipher_testvec cast6_dec_tv_template[] = {
 #define AES_CTR_3686_DEC_TEST_VECTORS 6
 #define AES_GCM_ENC_TEST_VECTORS 9
 #define AES_GCM_DEC_TEST_VECTORS 8
+#define AES_GCM_4106_ENC_TEST_VECTORS 3
+#define AES_GCM_4106_DEC_TEST_VECTORS 3
 #define AES_CCM_ENC_TEST_VECTORS 7
 #define AES_CCM_DEC_TEST_VECTORS 7
 #define AES_CCM_4309_ENC_TEST_VECTORS 7
@@ -5829,6 +5859,170 @@ static struct aead_testvec aes_gcm_dec_tv_template[] = {
 	}
 };
 
+static struct aead_testvec aes_gcm_rfc4106_enc_tv_template[] = {
+	{
+		.key	= "\x57\x82\xeb\x34\x1d\x54\x3d\xd4"
+			  "\x70\xb0\xc1\x05\xb3\x36\xe5\x36"
+			  "\x51\x7c\x92\xd3",
+		.klen	= 20,
+		.iv	= "\x8d\xae\x34\xa2\xc0\x16\xb7\xf8",
+		.assoc	= "\x52\xe1\x4e\xaa\x63\x39\xde\x80",
+		.alen	= 8,
+		.input	= "\x8d\x1b\x55\xfe\xcb\x16\x03\x7e"
+			  "\x4d\xe8\xb4\x9e\x65\x46\x71\xf2"
+			  "\xf5\xa5\x94\xb5\xbb\x4b\xad\x0e"
+			  "\x2d\xfb\xb8\x90\x35\x96\x11\xc2"
+			  "\xb1\x66\xc0\x7c\x7c\xc3\xfa\xc9"
+			  "\xac\xae\x68\x11\xf4\xd9\x03\xe9"
+			  "\x7f\x97\x9f\x3a\xe2\x4c\x48\x0f"
+			  "\x48\x00\xa0\x7d\x96\xb1\x3f\x47",
+		.ilen	= 64,
+		.result	= "\xf0\x81\x6f\x4c\xc4\xf6\x27\x0a"
+			  "\xf1\xbd\x40\x64\x74\x4c\xee\x9c"
+			  "\x35\x5d\xbf\x0e\x70\xcb\x75\xee"
+			  "\x68\x96\x59\x81\x15\xef\xa7\xd3"
+			  "\x7e\xc9\x69\xea\x60\x6f\xee\xfa"
+			  "\x9b\xa9\x22\x6e\x84\x20\xa0\xb2"
+			  "\xe7\x30\xd9\xf0\x03\x99\xff\x92"
+			  "\xee\x05\xfe\x4d\x0b\x2a\xc6\x1f"
+			  "\x4b\xae\xd5\x13\xd7\x58\xde\x33"
+			  "\xa1\xe3\x77\x1e\x19\xd9\x8a\x44",
+		.rlen	= 80,
+	}, {
+		.key	= "\x17\x00\xc3\x93\xc3\xbd\x5d\x6f"
+			  "\x6b\xc5\x80\x60\x9e\x83\x49\x1d"
+			  "\x1a\xe8\x58\xfd",
+		.klen	= 20,
+		.iv	= "\x35\xa0\x0c\x7d\xa1\xac\xfa\x37",
+		.assoc	= "\x5d\x39\x7f\x74\x39\x42\x08\xfd"
+			  "\x00\x65\x6c\x6b",
+		.alen	= 12,
+		.input	= "\x2a\xed\xcb\xc8\x70\x15\xe6\x8b"
+			  "\xfd\x3e\x88\x32\xde\x94\xaf\x7f"
+			  "\x41\xa9\xb7\x9e\xe3\x36\x13\x1c"
+			  "\x78\x1b\x19\x78\x80\x86\xe4\xaa"
+			  "\x73\xaf\x72\xe3\xc4\x58\x6e\xc2"
+			  "\x96\xf6\xf4\x75\x8b\xa4\xf4\xcc"
+			  "\x4d\xab\x6a\x30\xe1\x7d\x4d\x5a"
+			  "\x98\x66\xd2\x18\xec\xb6\xc2\x5f"
+			  "\x66\x35\x43\x2a\x8d\xb1",
+		.ilen	= 70,
+		.result	= "\x2b\xe4\x62\x14\x7b\x80\x44\x42"
+			  "\xd7\x56\x78\x05\xc9\x01\x84\x2b"
+			  "\xb2\xe1\x0a\x38\x0a\x98\x51\x43"
+			  "\xfb\x94\x03\xd6\x1b\xe6\x64\x3d"
+			  "\x19\x7a\xa2\x31\x57\x25\xfd\x64"
+			  "\x31\x3b\x59\xf7\x4b\xb4\xbf\x78"
+			  "\x60\xbd\x51\x21\x1a\x94\xda\xb3"
+			  "\x58\x2c\xc6\xd3\x51\xcf\x2f\xbd"
+			  "\xd8\x41\xc9\x18\xeb\x6b\x70\x70"
+			  "\xde\x4f\x86\x20\x2f\x44\x96\x6d"
+			  "\x7b\x78\xe3\xfc\xb2\x61",
+		.rlen	= 86,
+	}, {
+		.key	= "\xec\x24\xa8\xe1\x99\x33\x85\x8d"
+			  "\xff\xd2\x39\x69\x03\x1a\xe7\x50"
+			  "\x74\x7f\xb6\x47\x98\xa3\xfd\x5a"
+			  "\x02\x63\x8f\x45\x8e\x1d\xf7\x7a"
+			  "\x41\x9f\x5b\xda",
+		.klen	= 36,
+		.iv	= "\xd2\xe0\x67\xd1\xb3\xa0\x3a\xb6",
+		.assoc	= "\xbb\x21\x06\x2f\xa1\xbc\x76\x39",
+		.alen	= 8,
+		.input	= "\x5f\x74\x93\x62\xd7\x23\xa7\x65"
+			  "\x40\x9e\xe0\x81\x3d\x3b\x5b\x0f"
+			  "\x1c\xc2\xe0\xcf",
+		.ilen	= 20,
+		.result	= "\x6b\xf0\x1a\x3a\x82\xb7\xa8\x3b"
+			  "\x01\xbd\x81\xe2\x95\xfb\x3b\xa9"
+			  "\xfb\xbf\xf4\x75\xe4\xd5\xcf\x27"
+			  "\x70\x08\x03\xaf",
+		.rlen	= 28,
+	}
+};
+
+static struct aead_testvec aes_gcm_rfc4106_dec_tv_template[] = {
+	{
+		.key	= "\x57\x82\xeb\x34\x1d\x54\x3d\xd4"
+			  "\x70\xb0\xc1\x05\xb3\x36\xe5\x36"
+			  "\x51\x7c\x92\xd3",
+		.klen	= 20,
+		.iv	= "\x8d\xae\x34\xa2\xc0\x16\xb7\xf8",
+		.assoc	= "\x52\xe1\x4e\xaa\x63\x39\xde\x80",
+		.alen	= 8,
+		.input	= "\xf0\x81\x6f\x4c\xc4\xf6\x27\x0a"
+			  "\xf1\xbd\x40\x64\x74\x4c\xee\x9c"
+			  "\x35\x5d\xbf\x0e\x70\xcb\x75\xee"
+			  "\x68\x96\x59\x81\x15\xef\xa7\xd3"
+			  "\x7e\xc9\x69\xea\x60\x6f\xee\xfa"
+			  "\x9b\xa9\x22\x6e\x84\x20\xa0\xb2"
+			  "\xe7\x30\xd9\xf0\x03\x99\xff\x92"
+			  "\xee\x05\xfe\x4d\x0b\x2a\xc6\x1f"
+			  "\x4b\xae\xd5\x13\xd7\x58\xde\x33"
+			  "\xa1\xe3\x77\x1e\x19\xd9\x8a\x44",
+		.ilen	= 80,
+		.result	= "\x8d\x1b\x55\xfe\xcb\x16\x03\x7e"
+			  "\x4d\xe8\xb4\x9e\x65\x46\x71\xf2"
+			  "\xf5\xa5\x94\xb5\xbb\x4b\xad\x0e"
+			  "\x2d\xfb\xb8\x90\x35\x96\x11\xc2"
+			  "\xb1\x66\xc0\x7c\x7c\xc3\xfa\xc9"
+			  "\xac\xae\x68\x11\xf4\xd9\x03\xe9"
+			  "\x7f\x97\x9f\x3a\xe2\x4c\x48\x0f"
+			  "\x48\x00\xa0\x7d\x96\xb1\x3f\x47",
+		.rlen	= 64,
+	}, {
+		.key	= "\x17\x00\xc3\x93\xc3\xbd\x5d\x6f"
+			  "\x6b\xc5\x80\x60\x9e\x83\x49\x1d"
+			  "\x1a\xe8\x58\xfd",
+		.klen	= 20,
+		.iv	= "\x35\xa0\x0c\x7d\xa1\xac\xfa\x37",
+		.assoc	= "\x5d\x39\x7f\x74\x39\x42\x08\xfd"
+			  "\x00\x65\x6c\x6b",
+		.alen	= 12,
+		.input	= "\x2b\xe4\x62\x14\x7b\x80\x44\x42"
+			  "\xd7\x56\x78\x05\xc9\x01\x84\x2b"
+			  "\xb2\xe1\x0a\x38\x0a\x98\x51\x43"
+			  "\xfb\x94\x03\xd6\x1b\xe6\x64\x3d"
+			  "\x19\x7a\xa2\x31\x57\x25\xfd\x64"
+			  "\x31\x3b\x59\xf7\x4b\xb4\xbf\x78"
+			  "\x60\xbd\x51\x21\x1a\x94\xda\xb3"
+			  "\x58\x2c\xc6\xd3\x51\xcf\x2f\xbd"
+			  "\xd8\x41\xc9\x18\xeb\x6b\x70\x70"
+			  "\xde\x4f\x86\x20\x2f\x44\x96\x6d"
+			  "\x7b\x78\xe3\xfc\xb2\x61",
+		.ilen	= 86,
+		.result	= "\x2a\xed\xcb\xc8\x70\x15\xe6\x8b"
+			  "\xfd\x3e\x88\x32\xde\x94\xaf\x7f"
+			  "\x41\xa9\xb7\x9e\xe3\x36\x13\x1c"
+			  "\x78\x1b\x19\x78\x80\x86\xe4\xaa"
+			  "\x73\xaf\x72\xe3\xc4\x58\x6e\xc2"
+			  "\x96\xf6\xf4\x75\x8b\xa4\xf4\xcc"
+			  "\x4d\xab\x6a\x30\xe1\x7d\x4d\x5a"
+			  "\x98\x66\xd2\x18\xec\xb6\xc2\x5f"
+			  "\x66\x35\x43\x2a\x8d\xb1",
+		.rlen	= 70,
+	}, {
+		.key	= "\xec\x24\xa8\xe1\x99\x33\x85\x8d"
+			  "\xff\xd2\x39\x69\x03\x1a\xe7\x50"
+			  "\x74\x7f\xb6\x47\x98\xa3\xfd\x5a"
+			  "\x02\x63\x8f\x45\x8e\x1d\xf7\x7a"
+			  "\x41\x9f\x5b\xda",
+		.klen	= 36,
+		.iv	= "\xd2\xe0\x67\xd1\xb3\xa0\x3a\xb6",
+		.assoc	= "\xbb\x21\x06\x2f\xa1\xbc\x76\x39",
+		.alen	= 8,
+		.input	= "\x6b\xf0\x1a\x3a\x82\xb7\xa8\x3b"
+			  "\x01\xbd\x81\xe2\x95\xfb\x3b\xa9"
+			  "\xfb\xbf\xf4\x75\xe4\xd5\xcf\x27"
+			  "\x70\x08\x03\xaf",
+		.ilen	= 28,
+		.result	= "\x5f\x74\x93\x62\xd7\x23\xa7\x65"
+			  "\x40\x9e\xe0\x81\x3d\x3b\x5b\x0f"
+			  "\x1c\xc2\xe0\xcf",
+		.rlen	= 20,
+	}
+};
+
 static struct aead_testvec aes_ccm_enc_tv_template[] = {
 	{ /* From RFC 3610 */
 		.key	= "\xc0\xc1\xc2\xc3\xc4\xc5\xc6\xc7"
@@ -9431,6 +9625,214 @@ static struct hash_testvec michael_mic_tv_template[] = {
 	}
 };
 
+/*
+ * CRC32 test vectors
+ */
+#define CRC32_TEST_VECTORS 6
+
+static struct hash_testvec crc32_tv_template[] = {
+	{
+		.psize = 0,
+		.digest = "\x00\x00\x00\x00",
+	},
+	{
+		.key = "\x78\x56\x34\x12",
+		.ksize = 4,
+		.psize = 0,
+		.digest = "\x78\x56\x34\x12",
+	},
+	{
+		.key = "\xff\xff\xff\xff",
+		.ksize = 4,
+		.plaintext = "\x31\x32\x33\x34\x35\x36\x37\x38"
+			     "\x39",
+		.psize = 9,
+		.digest = "\xd9\xc6\x0b\x34",
+	},
+	{
+		.key = "\xff\xff\xff\xff",
+		.ksize = 4,
+		.plaintext = "\x01\x02\x03\x04\x05\x06\x07\x08"
+			     "\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10"
+			     "\x11\x12\x13\x14\x15\x16\x17\x18"
+			     "\x19\x1a\x1b\x1c\x1d\x1e\x1f\x20"
+			     "\x21\x22\x23\x24\x25\x26\x27\x28",
+		.psize = 40,
+		.digest = "\x3a\xdf\x4b\xb0",
+	},
+	{
+		.key = "\xff\xff\xff\xff",
+		.ksize = 4,
+		.plaintext = "\x01\x08\x0f\x16\x1d\x24\x2b\x32"
+			     "\x39\x40\x47\x4e\x55\x5c\x63\x6a"
+			     "\x71\x78\x7f\x86\x8d\x94\x9b\xa2"
+			     "\xa9\xb0\xb7\xbe\xc5\xcc\xd3\xda"
+			     "\xe1\xe8\xef\xf6\xfd\x04\x0b\x12"
+			     "\x19\x20\x27\x2e\x35\x3c\x43\x4a"
+			     "\x51\x58\x5f\x66\x6d\x74\x7b\x82"
+			     "\x89\x90\x97\x9e\xa5\xac\xb3\xba"
+			     "\xc1\xc8\xcf\xd6\xdd\xe4\xeb\xf2"
+			     "\xf9\x00\x07\x0e\x15\x1c\x23\x2a"
+			     "\x31\x38\x3f\x46\x4d\x54\x5b\x62"
+			     "\x69\x70\x77\x7e\x85\x8c\x93\x9a"
+			     "\xa1\xa8\xaf\xb6\xbd\xc4\xcb\xd2"
+			     "\xd9\xe0\xe7\xee\xf5\xfc\x03\x0a"
+			     "\x11\x18\x1f\x26\x2d\x34\x3b\x42"
+			     "\x49\x50\x57\x5e\x65\x6c\x73\x7a"
+			     "\x81\x88\x8f\x96\x9d\xa4\xab\xb2"
+			     "\xb9\xc0\xc7\xce\xd5\xdc\xe3\xea"
+			     "\xf1\xf8\xff\x06\x0d\x14\x1b\x22"
+			     "\x29\x30\x37\x3e\x45\x4c\x53\x5a"
+			     "\x61\x68\x6f\x76\x7d\x84\x8b\x92"
+			     "\x99\xa0\xa7\xae\xb5\xbc\xc3\xca"
+			     "\xd1\xd8\xdf\xe6\xed\xf4\xfb\x02"
+			     "\x09\x10\x17\x1e\x25\x2c\x33\x3a"
+			     "\x41\x48\x4f\x56\x5d\x64\x6b\x72"
+			     "\x79\x80\x87\x8e\x95\x9c\xa3\xaa"
+			     "\xb1\xb8\xbf\xc6\xcd\xd4\xdb\xe2"
+			     "\xe9\xf0\xf7\xfe\x05\x0c\x13\x1a"
+			     "\x21\x28\x2f\x36\x3d\x44\x4b\x52"
+			     "\x59\x60\x67\x6e\x75\x7c\x83\x8a"
+			     "\x91\x98\x9f\xa6\xad\xb4\xbb\xc2"
+			     "\xc9\xd0\xd7\xde\xe5\xec\xf3",
+		.psize = 255,
+		.digest = "\x40\x84\x7a\xc6",
+	},
+	{
+		.key = "\x00\x00\x00\x00",
+		.ksize = 4,
+		.plaintext = "\x01\x0e\x1b\x28\x35\x42\x4f\x5c"
+			     "\x69\x76\x83\x90\x9d\xaa\xb7\xc4"
+			     "\xd1\xde\xeb\xf8\x05\x12\x1f\x2c"
+			     "\x39\x46\x53\x60\x6d\x7a\x87\x94"
+			     "\xa1\xae\xbb\xc8\xd5\xe2\xef\xfc"
+			     "\x09\x16\x23\x30\x3d\x4a\x57\x64"
+			     "\x71\x7e\x8b\x98\xa5\xb2\xbf\xcc"
+			     "\xd9\xe6\xf3\x00\x0d\x1a\x27\x34"
+			     "\x41\x4e\x5b\x68\x75\x82\x8f\x9c"
+			     "\xa9\xb6\xc3\xd0\xdd\xea\xf7\x04"
+			     "\x11\x1e\x2b\x38\x45\x52\x5f\x6c"
+			     "\x79\x86\x93\xa0\xad\xba\xc7\xd4"
+			     "\xe1\xee\xfb\x08\x15\x22\x2f\x3c"
+			     "\x49\x56\x63\x70\x7d\x8a\x97\xa4"
+			     "\xb1\xbe\xcb\xd8\xe5\xf2\xff\x0c"
+			     "\x19\x26\x33\x40\x4d\x5a\x67\x74"
+			     "\x81\x8e\x9b\xa8\xb5\xc2\xcf\xdc"
+			     "\xe9\xf6\x03\x10\x1d\x2a\x37\x44"
+			     "\x51\x5e\x6b\x78\x85\x92\x9f\xac"
+			     "\xb9\xc6\xd3\xe0\xed\xfa\x07\x14"
+			     "\x21\x2e\x3b\x48\x55\x62\x6f\x7c"
+			     "\x89\x96\xa3\xb0\xbd\xca\xd7\xe4"
+			     "\xf1\xfe\x0b\x18\x25\x32\x3f\x4c"
+			     "\x59\x66\x73\x80\x8d\x9a\xa7\xb4"
+			     "\xc1\xce\xdb\xe8\xf5\x02\x0f\x1c"
+			     "\x29\x36\x43\x50\x5d\x6a\x77\x84"
+			     "\x91\x9e\xab\xb8\xc5\xd2\xdf\xec"
+			     "\xf9\x06\x13\x20\x2d\x3a\x47\x54"
+			     "\x61\x6e\x7b\x88\x95\xa2\xaf\xbc"
+			     "\xc9\xd6\xe3\xf0\xfd\x0a\x17\x24",
+		.psize = 240,
+		.digest = "\xb4\x8a\x0f\xa4",
+		.np = 2,
+		.tap = { 100, 140 },
+	}
+};
+
+/*
+ * CRC T10 DIF test vectors, the digest is in host byte order
+ */
+#define CRCT10DIF_TEST_VECTORS 4
+
+static struct hash_testvec crct10dif_tv_template[] = {
+	{
+		.plaintext = "\x31\x32\x33\x34\x35\x36\x37\x38"
+			     "\x39",
+		.psize = 9,
+		.digest = (char *)(u16 []){ 0xd0db },
+	},
+	{
+		.plaintext = "\x01\x02\x03\x04\x05\x06\x07\x08"
+			     "\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10"
+			     "\x11\x12\x13\x14\x15\x16\x17\x18"
+			     "\x19\x1a\x1b\x1c\x1d\x1e\x1f\x20"
+			     "\x21\x22\x23\x24\x25\x26\x27\x28",
+		.psize = 40,
+		.digest = (char *)(u16 []){ 0xf4a4 },
+	},
+	{
+		.plaintext = "\x01\x08\x0f\x16\x1d\x24\x2b\x32"
+			     "\x39\x40\x47\x4e\x55\x5c\x63\x6a"
+			     "\x71\x78\x7f\x86\x8d\x94\x9b\xa2"
+			     "\xa9\xb0\xb7\xbe\xc5\xcc\xd3\xda"
+			     "\xe1\xe8\xef\xf6\xfd\x04\x0b\x12"
+			     "\x19\x20\x27\x2e\x35\x3c\x43\x4a"
+			     "\x51\x58\x5f\x66\x6d\x74\x7b\x82"
+			     "\x89\x90\x97\x9e\xa5\xac\xb3\xba"
+			     "\xc1\xc8\xcf\xd6\xdd\xe4\xeb\xf2"
+			     "\xf9\x00\x07\x0e\x15\x1c\x23\x2a"
+			     "\x31\x38\x3f\x46\x4d\x54\x5b\x62"
+			     "\x69\x70\x77\x7e\x85\x8c\x93\x9a"
+			     "\xa1\xa8\xaf\xb6\xbd\xc4\xcb\xd2"
+			     "\xd9\xe0\xe7\xee\xf5\xfc\x03\x0a"
+			     "\x11\x18\x1f\x26\x2d\x34\x3b\x42"
+			     "\x49\x50\x57\x5e\x65\x6c\x73\x7a"
+			     "\x81\x88\x8f\x96\x9d\xa4\xab\xb2"
+			     "\xb9\xc0\xc7\xce\xd5\xdc\xe3\xea"
+			     "\xf1\xf8\xff\x06\x0d\x14\x1b\x22"
+			     "\x29\x30\x37\x3e\x45\x4c\x53\x5a"
+			     "\x61\x68\x6f\x76\x7d\x84\x8b\x92"
+			     "\x99\xa0\xa7\xae\xb5\xbc\xc3\xca"
+			     "\xd1\xd8\xdf\xe6\xed\xf4\xfb\x02"
+			     "\x09\x10\x17\x1e\x25\x2c\x33\x3a"
+			     "\x41\x48\x4f\x56\x5d\x64\x6b\x72"
+			     "\x79\x80\x87\x8e\x95\x9c\xa3\xaa"
+			     "\xb1\xb8\xbf\xc6\xcd\xd4\xdb\xe2"
+			     "\xe9\xf0\xf7\xfe\x05\x0c\x13\x1a"
+			     "\x21\x28\x2f\x36\x3d\x44\x4b\x52"
+			     "\x59\x60\x67\x6e\x75\x7c\x83\x8a"
+			     "\x91\x98\x9f\xa6\xad\xb4\xbb\xc2"
+			     "\xc9\xd0\xd7\xde\xe5\xec\xf3",
+		.psize = 255,
+		.digest = (char *)(u16 []){ 0x95b6 },
+	},
+	{
+		.plaintext = "\x01\x0e\x1b\x28\x35\x42\x4f\x5c"
+			     "\x69\x76\x83\x90\x9d\xaa\xb7\xc4"
+			     "\xd1\xde\xeb\xf8\x05\x12\x1f\x2c"
+			     "\x39\x46\x53\x60\x6d\x7a\x87\x94"
+			     "\xa1\xae\xbb\xc8\xd5\xe2\xef\xfc"
+			     "\x09\x16\x23\x30\x3d\x4a\x57\x64"
+			     "\x71\x7e\x8b\x98\xa5\xb2\xbf\xcc"
+			     "\xd9\xe6\xf3\x00\x0d\x1a\x27\x34"
+			     "\x41\x4e\x5b\x68\x75\x82\x8f\x9c"
+			     "\xa9\xb6\xc3\xd0\xdd\xea\xf7\x04"
+			     "\x11\x1e\x2b\x38\x45\x52\x5f\x6c"
+			     "\x79\x86\x93\xa0\xad\xba\xc7\xd4"
+			     "\xe1\xee\xfb\x08\x15\x22\x2f\x3c"
+			     "\x49\x56\x63\x70\x7d\x8a\x97\xa4"
+			     "\xb1\xbe\xcb\xd8\xe5\xf2\xff\x0c"
+			     "\x19\x26\x33\x40\x4d\x5a\x67\x74"
+			     "\x81\x8e\x9b\xa8\xb5\xc2\xcf\xdc"
+			     "\xe9\xf6\x03\x10\x1d\x2a\x37\x44"
+			     "\x51\x5e\x6b\x78\x85\x92\x9f\xac"
+			     "\xb9\xc6\xd3\xe0\xed\xfa\x07\x14"
+			     "\x21\x2e\x3b\x48\x55\x62\x6f\x7c"
+			     "\x89\x96\xa3\xb0\xbd\xca\xd7\xe4"
+			     "\xf1\xfe\x0b\x18\x25\x32\x3f\x4c"
+			     "\x59\x66\x73\x80\x8d\x9a\xa7\xb4"
+			     "\xc1\xce\xdb\xe8\xf5\x02\x0f\x1c"
+			     "\x29\x36\x43\x50\x5d\x6a\x77\x84"
+			     "\x91\x9e\xab\xb8\xc5\xd2\xdf\xec"
+			     "\xf9\x06\x13\x20\x2d\x3a\x47\x54"
+			     "\x61\x6e\x7b\x88\x95\xa2\xaf\xbc"
+			     "\xc9\xd6\xe3\xf0\xfd\x0a\x17\x24",
+		.psize = 240,
+		.digest = (char *)(u16 []){ 0x501b },
+		.np = 2,
+		.tap = { 100, 140 },
+	}
+};
+
 /*
  * CRC32C test vectors
  */
@@ -226,6 +226,8 @@ struct e1000_buffer {
 			/* arrays of page information for packet split */
 			struct e1000_ps_page *ps_pages;
 			struct page *page;
+			/* legacy Rx buffer, a page fragment for build_skb() */
+			u8 *data;
 		};
 	};
 };
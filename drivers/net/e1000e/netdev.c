@@ -400,7 +400,7 @@ rx_ring_summary:
 		 * 63       48 47    40 39      32 31         16 15      0
 		 */
 		printk(KERN_INFO "Rl[desc]     [address 63:0  ] "
-			"[vl er S cks ln] [bi->dma       ] [bi->skb] "
+			"[vl er S cks ln] [bi->dma       ] [bi->data] "
 			"<-- Legacy format\n");
 		for (i = 0; rx_ring->desc && (i < rx_ring->count); i++) {
 			rx_desc = E1000_RX_DESC(*rx_ring, i);
@@ -411,7 +411,7 @@ rx_ring_summary:
 				(unsigned long long)le64_to_cpu(u0->a),
 				(unsigned long long)le64_to_cpu(u0->b),
 				(unsigned long long)buffer_info->dma,
-				buffer_info->skb);
+				buffer_info->data);
 			if (i == rx_ring->next_to_use)
 				printk(KERN_CONT " NTU\n");
 			else if (i == rx_ring->next_to_clean)
@@ -509,6 +509,18 @@ static void e1000_rx_checksum(struct e1000_adapter *adapter, u32 status_err,
 	adapter->hw_csum_good++;
 }
 
+/*
+ * Legacy Rx buffers are page fragments: the frame is DMA'd after the
+ * headroom and the fragment becomes the skb head with build_skb().
+ */
+#define E1000_RX_HEADROOM	(NET_SKB_PAD + NET_IP_ALIGN)
+
+static unsigned int e1000_rx_frag_size(struct e1000_adapter *adapter)
+{
+	return SKB_DATA_ALIGN(E1000_RX_HEADROOM + adapter->rx_buffer_len) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+}
+
 /**
  * e1000_alloc_rx_buffers - Replace used receive buffers; legacy & extended
  * @adapter: address of board private structure
@@ -516,35 +528,33 @@ static void e1000_rx_checksum(struct e1000_adapter *adapter, u32 status_err,
 static void e1000_alloc_rx_buffers(struct e1000_adapter *adapter,
 				   int cleaned_count)
 {
-	struct net_device *netdev = adapter->netdev;
 	struct pci_dev *pdev = adapter->pdev;
 	struct e1000_ring *rx_ring = adapter->rx_ring;
 	struct e1000_rx_desc *rx_desc;
 	struct e1000_buffer *buffer_info;
-	struct sk_buff *skb;
 	unsigned int i;
-	unsigned int bufsz = adapter->rx_buffer_len;
+	unsigned int fragsz = e1000_rx_frag_size(adapter);
+	u8 *data;
 
 	i = rx_ring->next_to_use;
 	buffer_info = &rx_ring->buffer_info[i];
 
 	while (cleaned_count--) {
-		skb = buffer_info->skb;
-		if (skb) {
-			skb_trim(skb, 0);
-			goto map_skb;
-		}
+		data = buffer_info->data;
+		if (data)
+			goto map_data;
 
-		skb = netdev_alloc_skb_ip_align(netdev, bufsz);
-		if (!skb) {
+		data = netdev_alloc_frag(fragsz);
+		if (!data) {
 			/* Better luck next round */
 			adapter->alloc_rx_buff_failed++;
 			break;
 		}
 
-		buffer_info->skb = skb;
-map_skb:
-		buffer_info->dma = dma_map_single(&pdev->dev, skb->data,
+		buffer_info->data = data;
+map_data:
+		buffer_info->dma = dma_map_single(&pdev->dev,
+						  data + E1000_RX_HEADROOM,
 						  adapter->rx_buffer_len,
 						  DMA_FROM_DEVICE);
 		if (dma_mapping_error(&pdev->dev, buffer_info->dma)) {
@@ -767,6 +777,7 @@ static bool e1000_clean_rx_irq(struct e1000_adapter *adapter,
 	struct e1000_buffer *buffer_info, *next_buffer;
 	u32 length;
 	unsigned int i;
+	unsigned int fragsz = e1000_rx_frag_size(adapter);
 	int cleaned_count = 0;
 	bool cleaned = 0;
 	unsigned int total_rx_bytes = 0, total_rx_packets = 0;
@@ -776,7 +787,8 @@ static bool e1000_clean_rx_irq(struct e1000_adapter *adapter,
 	buffer_info = &rx_ring->buffer_info[i];
 
 	while (rx_desc->status & E1000_RXD_STAT_DD) {
-		struct sk_buff *skb;
+		struct sk_buff *skb = NULL;
+		u8 *data;
 		u8 status;
 
 		if (*work_done >= work_to_do)
@@ -785,10 +797,10 @@ static bool e1000_clean_rx_irq(struct e1000_adapter *adapter,
 		rmb();	/* read descriptor and rx_buffer_info after status DD */
 
 		status = rx_desc->status;
-		skb = buffer_info->skb;
-		buffer_info->skb = NULL;
+		data = buffer_info->data;
+		buffer_info->data = NULL;
 
-		prefetch(skb->data - NET_IP_ALIGN);
+		prefetch(data + NET_SKB_PAD);
 
 		i++;
 		if (i == rx_ring->count)
@@ -822,7 +834,7 @@ static bool e1000_clean_rx_irq(struct e1000_adapter *adapter,
 			/* All receives must fit into a single buffer */
 			e_dbg("Receive packet consumed multiple buffers\n");
 			/* recycle */
-			buffer_info->skb = skb;
+			buffer_info->data = data;
 			if (status & E1000_RXD_STAT_EOP)
 				adapter->flags2 &= ~FLAG2_IS_DISCARDING;
 			goto next_desc;
@@ -830,7 +842,7 @@ static bool e1000_clean_rx_irq(struct e1000_adapter *adapter,
 
 		if (rx_desc->errors & E1000_RXD_ERR_FRAME_ERR_MASK) {
 			/* recycle */
-			buffer_info->skb = skb;
+			buffer_info->data = data;
 			goto next_desc;
 		}
 
@@ -838,33 +850,40 @@ static bool e1000_clean_rx_irq(struct e1000_adapter *adapter,
 		if (!(adapter->flags2 & FLAG2_CRC_STRIPPING))
 			length -= 4;
 
-		total_rx_bytes += length;
-		total_rx_packets++;
-
 		/*
 		 * code added for copybreak, this should improve
 		 * performance for small packets with large amounts
 		 * of reassembly being done in the stack
 		 */
 		if (length < copybreak) {
-			struct sk_buff *new_skb =
-			    netdev_alloc_skb_ip_align(netdev, length);
-			if (new_skb) {
-				skb_copy_to_linear_data_offset(new_skb,
+			skb = netdev_alloc_skb_ip_align(netdev, length);
+			if (skb) {
+				skb_copy_to_linear_data_offset(skb,
 							       -NET_IP_ALIGN,
-							       (skb->data -
-								NET_IP_ALIGN),
+							       data + NET_SKB_PAD,
 							       (length +
 								NET_IP_ALIGN));
-				/* save the skb in buffer_info as good */
-				buffer_info->skb = skb;
-				skb = new_skb;
+				/* save the buffer in buffer_info as good */
+				buffer_info->data = data;
 			}
-			/* else just continue with the old one */
+			/* else just continue with the buffer itself */
 		}
 		/* end copybreak code */
+		if (!skb) {
+			skb = build_skb(data, fragsz);
+			if (unlikely(!skb)) {
+				/* recycle */
+				adapter->alloc_rx_buff_failed++;
+				buffer_info->data = data;
+				goto next_desc;
+			}
+			skb_reserve(skb, E1000_RX_HEADROOM);
+		}
 		skb_put(skb, length);
 
+		total_rx_bytes += length;
+		total_rx_packets++;
+
 		/* Receive Checksum Offload */
 		e1000_rx_checksum(adapter,
 				  (u32)(status) |
@@ -1462,6 +1481,11 @@ static void e1000_clean_rx_ring(struct e1000_adapter *adapter)
 			buffer_info->page = NULL;
 		}
 
+		if (buffer_info->data) {
+			put_page(virt_to_head_page(buffer_info->data));
+			buffer_info->data = NULL;
+		}
+
 		if (buffer_info->skb) {
 			dev_kfree_skb(buffer_info->skb);
 			buffer_info->skb = NULL;
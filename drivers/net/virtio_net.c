@@ -38,6 +38,14 @@ module_param(gso, bool, 0444);
 #define MAX_PACKET_LEN (ETH_HLEN + VLAN_HLEN + ETH_DATA_LEN)
 #define GOOD_COPY_LEN	128
 
+/* Small receive buffers are page fragments turned into skbs by build_skb().
+ * The virtio header is written at the start of the headroom.
+ */
+#define VIRTNET_RX_PAD (NET_SKB_PAD + NET_IP_ALIGN)
+#define VIRTNET_SMALL_BUF_LEN \
+	(SKB_DATA_ALIGN(VIRTNET_RX_PAD + MAX_PACKET_LEN) + \
+	 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+
 #define VIRTNET_SEND_COMMAND_SG_MAX    2
 
 struct virtnet_info {
@@ -227,7 +235,22 @@ static int receive_mergeable(struct virtnet_info *vi, struct sk_buff *skb)
 	return 0;
 }
 
-static void receive_buf(struct net_device *dev, void *buf, unsigned int len)
+static struct sk_buff *receive_small(void *buf, unsigned int len)
+{
+	struct sk_buff *skb;
+
+	skb = build_skb(buf, VIRTNET_SMALL_BUF_LEN);
+	if (unlikely(!skb))
+		return NULL;
+
+	memcpy(&skb_vnet_hdr(skb)->hdr, buf, sizeof(struct virtio_net_hdr));
+	skb_reserve(skb, VIRTNET_RX_PAD);
+	skb_put(skb, len - sizeof(struct virtio_net_hdr));
+	return skb;
+}
+
+static void receive_buf(struct net_device *dev, void *buf, unsigned int len,
+			struct sk_buff_head *rx_list)
 {
 	struct virtnet_info *vi = netdev_priv(dev);
 	struct sk_buff *skb;
@@ -240,14 +263,17 @@ static void receive_buf(struct net_device *dev, void *buf, unsigned int len)
 		if (vi->mergeable_rx_bufs || vi->big_packets)
 			give_pages(vi, buf);
 		else
-			dev_kfree_skb(buf);
+			put_page(virt_to_head_page(buf));
 		return;
 	}
 
 	if (!vi->mergeable_rx_bufs && !vi->big_packets) {
-		skb = buf;
-		len -= sizeof(struct virtio_net_hdr);
-		skb_trim(skb, len);
+		skb = receive_small(buf, len);
+		if (unlikely(!skb)) {
+			dev->stats.rx_dropped++;
+			put_page(virt_to_head_page(buf));
+			return;
+		}
 	} else {
 		page = buf;
 		skb = page_to_skb(vi, page, len);
@@ -315,7 +341,7 @@ static void receive_buf(struct net_device *dev, void *buf, unsigned int len)
 		skb_shinfo(skb)->gso_segs = 0;
 	}
 
-	netif_receive_skb(skb);
+	__skb_queue_tail(rx_list, skb);
 	return;
 
 frame_err:
@@ -325,24 +351,19 @@ frame_err:
 
 static int add_recvbuf_small(struct virtnet_info *vi, gfp_t gfp)
 {
-	struct sk_buff *skb;
-	struct skb_vnet_hdr *hdr;
+	char *buf;
 	int err;
 
-	skb = netdev_alloc_skb_ip_align(vi->dev, MAX_PACKET_LEN);
-	if (unlikely(!skb))
+	buf = netdev_alloc_frag(VIRTNET_SMALL_BUF_LEN);
+	if (unlikely(!buf))
 		return -ENOMEM;
 
-	skb_put(skb, MAX_PACKET_LEN);
-
-	hdr = skb_vnet_hdr(skb);
-	sg_set_buf(vi->rx_sg, &hdr->hdr, sizeof hdr->hdr);
+	sg_set_buf(vi->rx_sg, buf, sizeof(struct virtio_net_hdr));
+	sg_set_buf(vi->rx_sg + 1, buf + VIRTNET_RX_PAD, MAX_PACKET_LEN);
 
-	skb_to_sgvec(skb, vi->rx_sg + 1, 0, skb->len);
-
-	err = virtqueue_add_buf_gfp(vi->rvq, vi->rx_sg, 0, 2, skb, gfp);
+	err = virtqueue_add_buf_gfp(vi->rvq, vi->rx_sg, 0, 2, buf, gfp);
 	if (err < 0)
-		dev_kfree_skb(skb);
+		put_page(virt_to_head_page(buf));
 
 	return err;
 }
@@ -465,16 +486,20 @@ static void refill_work(struct work_struct *work)
 static int virtnet_poll(struct napi_struct *napi, int budget)
 {
 	struct virtnet_info *vi = container_of(napi, struct virtnet_info, napi);
+	struct sk_buff_head rx_list;
 	void *buf;
 	unsigned int len, received = 0;
 
+	__skb_queue_head_init(&rx_list);
+
 again:
 	while (received < budget &&
 	       (buf = virtqueue_get_buf(vi->rvq, &len)) != NULL) {
-		receive_buf(vi->dev, buf, len);
+		receive_buf(vi->dev, buf, len, &rx_list);
 		--vi->num;
 		received++;
 	}
+	netif_receive_skb_list(&rx_list);
 
 	if (vi->num < vi->max / 2) {
 		if (!try_fill_recv(vi, GFP_ATOMIC))
@@ -1019,7 +1044,7 @@ static void free_unused_bufs(struct virtnet_info *vi)
 		if (vi->mergeable_rx_bufs || vi->big_packets)
 			give_pages(vi, buf);
 		else
-			dev_kfree_skb(buf);
+			put_page(virt_to_head_page(buf));
 		--vi->num;
 	}
 	BUG_ON(vi->num != 0);
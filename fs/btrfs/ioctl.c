@@ -1428,12 +1428,12 @@ static long btrfs_ioctl_rm_dev(struct btrfs_root *root, void __user *arg)
 	return ret;
 }
 
-static noinline long btrfs_ioctl_clone(struct file *file, unsigned long srcfd,
+static noinline long btrfs_clone_files(struct file *file,
+				       struct file *src_file,
 				       u64 off, u64 olen, u64 destoff)
 {
 	struct inode *inode = fdentry(file)->d_inode;
 	struct btrfs_root *root = BTRFS_I(inode)->root;
-	struct file *src_file;
 	struct inode *src;
 	struct btrfs_trans_handle *trans;
 	struct btrfs_path *path;
@@ -1465,39 +1465,33 @@ static noinline long btrfs_ioctl_clone(struct file *file, unsigned long srcfd,
 	if (ret)
 		return ret;
 
-	src_file = fget(srcfd);
-	if (!src_file) {
-		ret = -EBADF;
-		goto out_drop_write;
-	}
-
 	src = src_file->f_dentry->d_inode;
 
 	ret = -EINVAL;
 	if (src == inode)
-		goto out_fput;
+		goto out_drop_write;
 
 	/* the src must be open for reading */
 	if (!(src_file->f_mode & FMODE_READ))
-		goto out_fput;
+		goto out_drop_write;
 
 	ret = -EISDIR;
 	if (S_ISDIR(src->i_mode) || S_ISDIR(inode->i_mode))
-		goto out_fput;
+		goto out_drop_write;
 
 	ret = -EXDEV;
 	if (src->i_sb != inode->i_sb || BTRFS_I(src)->root != root)
-		goto out_fput;
+		goto out_drop_write;
 
 	ret = -ENOMEM;
 	buf = vmalloc(btrfs_level_size(root, 0));
 	if (!buf)
-		goto out_fput;
+		goto out_drop_write;
 
 	path = btrfs_alloc_path();
 	if (!path) {
 		vfree(buf);
-		goto out_fput;
+		goto out_drop_write;
 	}
 	path->reada = 2;
 
@@ -1743,13 +1737,51 @@ out_unlock:
 	mutex_unlock(&inode->i_mutex);
 	vfree(buf);
 	btrfs_free_path(path);
-out_fput:
-	fput(src_file);
 out_drop_write:
 	mnt_drop_write(file->f_path.mnt);
 	return ret;
 }
 
+static long btrfs_ioctl_clone(struct file *file, unsigned long srcfd,
+			      u64 off, u64 olen, u64 destoff)
+{
+	struct file *src_file;
+	long ret;
+
+	src_file = fget(srcfd);
+	if (!src_file)
+		return -EBADF;
+
+	ret = btrfs_clone_files(file, src_file, off, olen, destoff);
+	fput(src_file);
+	return ret;
+}
+
+/*
+ * ->copy_range() for copy_file_range(2): share the extents of the source
+ * range with the destination instead of copying the data.  Anything the
+ * clone code can't handle (unaligned ranges, ranges within one file,
+ * crossing subvolumes) is left to the generic splice copy in the VFS.
+ */
+ssize_t btrfs_copy_range(struct file *file_in, loff_t pos_in,
+			 struct file *file_out, loff_t pos_out,
+			 size_t len, unsigned int flags)
+{
+	struct inode *inode = fdentry(file_out)->d_inode;
+	u64 bs = BTRFS_I(inode)->root->fs_info->sb->s_blocksize;
+	long ret;
+
+	if (pos_out & (bs - 1))
+		return -EOPNOTSUPP;
+
+	ret = btrfs_clone_files(file_out, file_in, pos_in, len, pos_out);
+	if (ret == -EINVAL || ret == -EXDEV)
+		return -EOPNOTSUPP;
+	if (ret < 0)
+		return ret;
+	return len;
+}
+
 static long btrfs_ioctl_clone_range(struct file *file, void __user *argp)
 {
 	struct btrfs_ioctl_clone_range_args args;
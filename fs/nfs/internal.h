@@ -62,6 +62,11 @@ struct nfs_clone_mount {
  */
 #define NFS_UNSPEC_PORT		(-1)
 
+/*
+ * Upper bound for the "nconnect" mount option.
+ */
+#define NFS_MAX_CONNECTIONS	RPC_MAX_XPRTS
+
 /*
  * Maximum number of pages that readdir can use for creating
  * a vmapped array of pages.
@@ -85,6 +90,7 @@ struct nfs_parsed_mount_data {
 	char			*client_address;
 	unsigned int		version;
 	unsigned int		minorversion;
+	unsigned int		nconnect;
 	char			*fscache_uniq;
 
 	struct {
@@ -5,68 +5,191 @@
  * This code is heavily inspired by the 44BSD implementation, although
  * it does things a bit differently.
  *
+ * The cache is split into a power-of-two number of buckets, each with
+ * its own lock and its own LRU list, so that nfsd threads working on
+ * unrelated XIDs do not contend with each other.  Entries are allocated
+ * on demand, and the total number of entries is bounded by a limit that
+ * scales with the amount of low memory in the machine.
+ *
  * Copyright (C) 1995, 1996 Olaf Kirch <okir@monad.swb.de>
  */
 
 #include <linux/slab.h>
+#include <linux/hash.h>
+#include <linux/highmem.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
+#include <linux/sunrpc/clnt.h>
+#include <net/checksum.h>
 
 #include "nfsd.h"
 #include "cache.h"
 
-/* Size of reply cache. Common values are:
- * 4.3BSD:	128
- * 4.4BSD:	256
- * Solaris2:	1024
- * DEC Unix:	512-4096
+#define NFSDDBG_FACILITY	NFSDDBG_REPCACHE
+
+/*
+ * We use this value to determine the number of hash buckets from the max
+ * cache size, the idea being that when the cache is at its maximum number
+ * of entries, then this should be the average number of entries per bucket.
  */
-#define CACHESIZE		1024
-#define HASHSIZE		64
+#define TARGET_BUCKET_SIZE	64
+
+struct nfsd_drc_bucket {
+	struct list_head	lru_head;
+	spinlock_t		cache_lock;
+	unsigned int		contended;	/* lock was already held */
+
+	/* statistics, protected by cache_lock */
+	unsigned int		payload_misses;	/* body checksum mismatch */
+	unsigned int		longest_chain;	/* longest chain walked */
+	unsigned int		longest_chain_cachesize; /* cache size then */
+};
 
-static struct hlist_head *	cache_hash;
-static struct list_head 	lru_head;
+static struct nfsd_drc_bucket	*drc_hashtbl;
+static struct kmem_cache	*drc_slab;
 static int			cache_disabled = 1;
 
+/* max number of entries allowed in the cache */
+static unsigned int		max_drc_entries;
+
+/* number of significant bits in the hash value */
+static unsigned int		maskbits;
+
+/* total number of entries and memory used by cached replies */
+static atomic_t			num_drc_entries;
+static atomic_t			drc_mem_usage;
+
+static int	nfsd_cache_append(struct svc_rqst *rqstp, struct kvec *vec);
+static int	nfsd_reply_cache_shrink(struct shrinker *shrink,
+					int nr_to_scan, gfp_t gfp_mask);
+
+static struct shrinker nfsd_reply_cache_shrinker = {
+	.shrink	= nfsd_reply_cache_shrink,
+	.seeks	= 1,
+};
+
+/*
+ * locking for the reply cache:
+ * A cache entry is "single use" if c_state == RC_INPROG
+ * Otherwise, when accessing _prev or _next, the lock of the bucket the
+ * entry hashes to must be held.
+ */
+
+/*
+ * Put a cap on the size of the DRC based on the amount of available
+ * low memory in the machine.
+ *
+ *  64MB:    8192
+ * 128MB:   11585
+ * 512MB:   23170
+ *   1GB:   32768
+ *   2GB:   46340
+ *  16GB:  131072
+ *
+ * ...with a hard cap of 256k entries. In the worst case, each entry will be
+ * ~1k, so the above numbers should give a rough max of the amount of memory
+ * used in k.
+ */
+static unsigned int
+nfsd_cache_size_limit(void)
+{
+	unsigned int limit;
+	unsigned long low_pages = totalram_pages - totalhigh_pages;
+
+	limit = (16 * int_sqrt(low_pages)) << (PAGE_SHIFT-10);
+	return min_t(unsigned int, limit, 256*1024);
+}
+
 /*
- * Calculate the hash index from an XID.
+ * Compute the number of hash buckets we need. Divide the max cachesize by
+ * the "target" max bucket size, and round up to next power of two.
  */
-static inline u32 request_hash(u32 xid)
+static unsigned int
+nfsd_hashsize(unsigned int limit)
 {
-	u32 h = xid;
-	h ^= (xid >> 24);
-	return h & (HASHSIZE-1);
+	return roundup_pow_of_two(limit / TARGET_BUCKET_SIZE);
 }
 
-static int	nfsd_cache_append(struct svc_rqst *rqstp, struct kvec *vec);
+static struct nfsd_drc_bucket *
+nfsd_cache_bucket_find(__be32 xid)
+{
+	return &drc_hashtbl[hash_32(be32_to_cpu(xid), maskbits)];
+}
 
 /*
- * locking for the reply cache:
- * A cache entry is "single use" if c_state == RC_INPROG
- * Otherwise, it when accessing _prev or _next, the lock must be held.
+ * Take a bucket lock, noting whether somebody else already held it.
  */
-static DEFINE_SPINLOCK(cache_lock);
+static void
+nfsd_cache_bucket_lock(struct nfsd_drc_bucket *b)
+{
+	if (!spin_trylock(&b->cache_lock)) {
+		spin_lock(&b->cache_lock);
+		b->contended++;
+	}
+}
 
-int nfsd_reply_cache_init(void)
+static struct svc_cacherep *
+nfsd_reply_cache_alloc(void)
 {
 	struct svc_cacherep	*rp;
-	int			i;
-
-	INIT_LIST_HEAD(&lru_head);
-	i = CACHESIZE;
-	while (i) {
-		rp = kmalloc(sizeof(*rp), GFP_KERNEL);
-		if (!rp)
-			goto out_nomem;
-		list_add(&rp->c_lru, &lru_head);
+
+	rp = kmem_cache_alloc(drc_slab, GFP_KERNEL);
+	if (rp) {
 		rp->c_state = RC_UNUSED;
 		rp->c_type = RC_NOCACHE;
-		INIT_HLIST_NODE(&rp->c_hash);
-		i--;
+		INIT_LIST_HEAD(&rp->c_lru);
+	}
+	return rp;
+}
+
+static void
+nfsd_reply_cache_free_locked(struct svc_cacherep *rp)
+{
+	if (rp->c_type == RC_REPLBUFF && rp->c_replvec.iov_base) {
+		atomic_sub(rp->c_replvec.iov_len, &drc_mem_usage);
+		kfree(rp->c_replvec.iov_base);
+	}
+	if (rp->c_state != RC_UNUSED) {
+		list_del(&rp->c_lru);
+		atomic_dec(&num_drc_entries);
+		atomic_sub(sizeof(*rp), &drc_mem_usage);
 	}
+	kmem_cache_free(drc_slab, rp);
+}
+
+static void
+nfsd_reply_cache_free(struct nfsd_drc_bucket *b, struct svc_cacherep *rp)
+{
+	spin_lock(&b->cache_lock);
+	nfsd_reply_cache_free_locked(rp);
+	spin_unlock(&b->cache_lock);
+}
+
+int nfsd_reply_cache_init(void)
+{
+	unsigned int hashsize;
+	unsigned int i;
+
+	max_drc_entries = nfsd_cache_size_limit();
+	atomic_set(&num_drc_entries, 0);
+	atomic_set(&drc_mem_usage, 0);
+	hashsize = nfsd_hashsize(max_drc_entries);
+	maskbits = ilog2(hashsize);
+
+	drc_slab = kmem_cache_create("nfsd_drc", sizeof(struct svc_cacherep),
+					0, 0, NULL);
+	if (!drc_slab)
+		goto out_nomem;
 
-	cache_hash = kcalloc (HASHSIZE, sizeof(struct hlist_head), GFP_KERNEL);
-	if (!cache_hash)
+	drc_hashtbl = kcalloc(hashsize, sizeof(*drc_hashtbl), GFP_KERNEL);
+	if (!drc_hashtbl)
 		goto out_nomem;
+	for (i = 0; i < hashsize; i++) {
+		INIT_LIST_HEAD(&drc_hashtbl[i].lru_head);
+		spin_lock_init(&drc_hashtbl[i].cache_lock);
+	}
 
+	register_shrinker(&nfsd_reply_cache_shrinker);
 	cache_disabled = 0;
 	return 0;
 out_nomem:
@@ -78,55 +201,197 @@ out_nomem:
 void nfsd_reply_cache_shutdown(void)
 {
 	struct svc_cacherep	*rp;
+	unsigned int		i;
 
-	while (!list_empty(&lru_head)) {
-		rp = list_entry(lru_head.next, struct svc_cacherep, c_lru);
-		if (rp->c_state == RC_DONE && rp->c_type == RC_REPLBUFF)
-			kfree(rp->c_replvec.iov_base);
-		list_del(&rp->c_lru);
-		kfree(rp);
+	if (drc_hashtbl && !cache_disabled)
+		unregister_shrinker(&nfsd_reply_cache_shrinker);
+	cache_disabled = 1;
+
+	if (drc_hashtbl) {
+		for (i = 0; i < (1U << maskbits); i++) {
+			struct list_head *head = &drc_hashtbl[i].lru_head;
+
+			while (!list_empty(head)) {
+				rp = list_first_entry(head, struct svc_cacherep,
+						      c_lru);
+				nfsd_reply_cache_free_locked(rp);
+			}
+		}
 	}
 
-	cache_disabled = 1;
+	kfree(drc_hashtbl);
+	drc_hashtbl = NULL;
 
-	kfree (cache_hash);
-	cache_hash = NULL;
+	if (drc_slab) {
+		kmem_cache_destroy(drc_slab);
+		drc_slab = NULL;
+	}
 }
 
 /*
- * Move cache entry to end of LRU list
+ * Move cache entry to end of its bucket's LRU list
  */
 static void
-lru_put_end(struct svc_cacherep *rp)
+lru_put_end(struct nfsd_drc_bucket *b, struct svc_cacherep *rp)
 {
-	list_move_tail(&rp->c_lru, &lru_head);
+	rp->c_timestamp = jiffies;
+	list_move_tail(&rp->c_lru, &b->lru_head);
 }
 
 /*
- * Move a cache entry from one hash list to another
+ * Walk a bucket's LRU list and free entries that have expired, or all
+ * completed entries while the cache is over its size limit.  Entries
+ * that are still in progress are skipped.
  */
-static void
-hash_refile(struct svc_cacherep *rp)
+static long
+prune_bucket(struct nfsd_drc_bucket *b)
+{
+	struct svc_cacherep *rp, *tmp;
+	long freed = 0;
+
+	list_for_each_entry_safe(rp, tmp, &b->lru_head, c_lru) {
+		if (rp->c_state == RC_INPROG)
+			continue;
+		if (atomic_read(&num_drc_entries) <= max_drc_entries &&
+		    time_before(jiffies, rp->c_timestamp + RC_EXPIRE))
+			break;
+		nfsd_reply_cache_free_locked(rp);
+		freed++;
+	}
+	return freed;
+}
+
+static long
+prune_cache_entries(void)
+{
+	unsigned int i;
+	long freed = 0;
+
+	for (i = 0; i < (1U << maskbits); i++) {
+		struct nfsd_drc_bucket *b = &drc_hashtbl[i];
+
+		if (list_empty(&b->lru_head))
+			continue;
+		spin_lock(&b->cache_lock);
+		freed += prune_bucket(b);
+		spin_unlock(&b->cache_lock);
+	}
+	return freed;
+}
+
+static int
+nfsd_reply_cache_shrink(struct shrinker *shrink, int nr_to_scan, gfp_t gfp_mask)
+{
+	if (nr_to_scan)
+		prune_cache_entries();
+	return atomic_read(&num_drc_entries);
+}
+
+/*
+ * Walk an xdr_buf and get a CRC for at most the first RC_CSUMLEN bytes
+ * of the request body, past the RPC header.
+ */
+static __wsum
+nfsd_cache_csum(struct svc_rqst *rqstp)
+{
+	int idx;
+	unsigned int base;
+	__wsum csum;
+	struct xdr_buf *buf = &rqstp->rq_arg;
+	const unsigned char *p = buf->head[0].iov_base;
+	size_t csum_len = min_t(size_t, buf->head[0].iov_len + buf->page_len,
+				RC_CSUMLEN);
+	size_t len = min(buf->head[0].iov_len, csum_len);
+
+	/* rq_arg.head first */
+	csum = csum_partial(p, len, 0);
+	csum_len -= len;
+
+	/* Continue into page array */
+	idx = buf->page_base / PAGE_SIZE;
+	base = buf->page_base & ~PAGE_MASK;
+	while (csum_len) {
+		p = page_address(buf->pages[idx]) + base;
+		len = min_t(size_t, PAGE_SIZE - base, csum_len);
+		csum = csum_partial(p, len, csum);
+		csum_len -= len;
+		base = 0;
+		++idx;
+	}
+	return csum;
+}
+
+static int
+nfsd_cache_match(struct nfsd_drc_bucket *b, struct svc_rqst *rqstp,
+		 __wsum csum, struct svc_cacherep *rp)
+{
+	/* Check RPC XID first */
+	if (rqstp->rq_xid != rp->c_xid)
+		return 0;
+	/* compare other fields */
+	if (rqstp->rq_proc != rp->c_proc ||
+	    rqstp->rq_prot != rp->c_prot ||
+	    rqstp->rq_vers != rp->c_vers ||
+	    rqstp->rq_arg.len != rp->c_len ||
+	    !rpc_cmp_addr(svc_addr(rqstp), (struct sockaddr *)&rp->c_addr) ||
+	    rpc_get_port(svc_addr(rqstp)) !=
+	    rpc_get_port((struct sockaddr *)&rp->c_addr))
+		return 0;
+
+	/* Same call from the same client; reject it if the body differs */
+	if (csum != rp->c_csum) {
+		++b->payload_misses;
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Search a bucket for a matching entry.  Must be called with the bucket
+ * lock held.
+ */
+static struct svc_cacherep *
+nfsd_cache_search(struct nfsd_drc_bucket *b, struct svc_rqst *rqstp,
+		  __wsum csum)
 {
-	hlist_del_init(&rp->c_hash);
-	hlist_add_head(&rp->c_hash, cache_hash + request_hash(rp->c_xid));
+	struct svc_cacherep	*rp, *ret = NULL;
+	unsigned int		entries = 0;
+
+	list_for_each_entry(rp, &b->lru_head, c_lru) {
+		++entries;
+		if (nfsd_cache_match(b, rqstp, csum, rp)) {
+			ret = rp;
+			break;
+		}
+	}
+
+	/* tally hash chain length stats */
+	if (entries > b->longest_chain) {
+		b->longest_chain = entries;
+		b->longest_chain_cachesize = atomic_read(&num_drc_entries);
+	} else if (entries == b->longest_chain) {
+		/* prefer to keep the smallest cachesize possible here */
+		b->longest_chain_cachesize = min_t(unsigned int,
+				b->longest_chain_cachesize,
+				atomic_read(&num_drc_entries));
+	}
+
+	return ret;
 }
 
 /*
  * Try to find an entry matching the current call in the cache. When none
- * is found, we grab the oldest unlocked entry off the LRU list.
- * Note that no operation within the loop may sleep.
+ * is found, we insert a freshly allocated entry at the tail of the
+ * bucket's LRU list.
+ * Note that no operation within the locked section may sleep.
  */
 int
 nfsd_cache_lookup(struct svc_rqst *rqstp, int type)
 {
-	struct hlist_node	*hn;
-	struct hlist_head 	*rh;
-	struct svc_cacherep	*rp;
+	struct svc_cacherep	*rp, *found;
+	struct nfsd_drc_bucket	*b;
 	__be32			xid = rqstp->rq_xid;
-	u32			proto =  rqstp->rq_prot,
-				vers = rqstp->rq_vers,
-				proc = rqstp->rq_proc;
+	__wsum			csum;
 	unsigned long		age;
 	int rtn;
 
@@ -136,74 +401,65 @@ nfsd_cache_lookup(struct svc_rqst *rqstp, int type)
 		return RC_DOIT;
 	}
 
-	spin_lock(&cache_lock);
+	csum = nfsd_cache_csum(rqstp);
+	b = nfsd_cache_bucket_find(xid);
+
+	/*
+	 * Since the common case is a cache miss followed by an insert,
+	 * preallocate an entry outside of the bucket lock.
+	 */
+	rp = nfsd_reply_cache_alloc();
+	nfsd_cache_bucket_lock(b);
 	rtn = RC_DOIT;
 
-	rh = &cache_hash[request_hash(xid)];
-	hlist_for_each_entry(rp, hn, rh, c_hash) {
-		if (rp->c_state != RC_UNUSED &&
-		    xid == rp->c_xid && proc == rp->c_proc &&
-		    proto == rp->c_prot && vers == rp->c_vers &&
-		    time_before(jiffies, rp->c_timestamp + 120*HZ) &&
-		    memcmp((char*)&rqstp->rq_addr, (char*)&rp->c_addr, sizeof(rp->c_addr))==0) {
-			nfsdstats.rchits++;
-			goto found_entry;
-		}
+	/*
+	 * Drop expired entries first, so that a new call reusing an old
+	 * XID is never answered from a stale reply.
+	 */
+	prune_bucket(b);
+
+	found = nfsd_cache_search(b, rqstp, csum);
+	if (found) {
+		if (likely(rp))
+			kmem_cache_free(drc_slab, rp);
+		rp = found;
+		goto found_entry;
 	}
 	nfsdstats.rcmisses++;
 
-	/* This loop shouldn't take more than a few iterations normally */
-	{
-	int	safe = 0;
-	list_for_each_entry(rp, &lru_head, c_lru) {
-		if (rp->c_state != RC_INPROG)
-			break;
-		if (safe++ > CACHESIZE) {
-			printk("nfsd: loop in repcache LRU list\n");
-			cache_disabled = 1;
-			goto out;
-		}
-	}
-	}
-
-	/* All entries on the LRU are in-progress. This should not happen */
-	if (&rp->c_lru == &lru_head) {
-		static int	complaints;
-
-		printk(KERN_WARNING "nfsd: all repcache entries locked!\n");
-		if (++complaints > 5) {
-			printk(KERN_WARNING "nfsd: disabling repcache.\n");
-			cache_disabled = 1;
-		}
+	if (!rp) {
+		dprintk("nfsd: unable to allocate DRC entry!\n");
 		goto out;
 	}
 
 	rqstp->rq_cacherep = rp;
 	rp->c_state = RC_INPROG;
 	rp->c_xid = xid;
-	rp->c_proc = proc;
-	memcpy(&rp->c_addr, svc_addr_in(rqstp), sizeof(rp->c_addr));
-	rp->c_prot = proto;
-	rp->c_vers = vers;
-	rp->c_timestamp = jiffies;
-
-	hash_refile(rp);
-
-	/* release any buffer */
-	if (rp->c_type == RC_REPLBUFF) {
-		kfree(rp->c_replvec.iov_base);
-		rp->c_replvec.iov_base = NULL;
-	}
-	rp->c_type = RC_NOCACHE;
+	rp->c_proc = rqstp->rq_proc;
+	memset(&rp->c_addr, 0, sizeof(rp->c_addr));
+	memcpy(&rp->c_addr, svc_addr(rqstp),
+	       min_t(size_t, rqstp->rq_addrlen, sizeof(rp->c_addr)));
+	rp->c_prot = rqstp->rq_prot;
+	rp->c_vers = rqstp->rq_vers;
+	rp->c_len = rqstp->rq_arg.len;
+	rp->c_csum = csum;
+
+	lru_put_end(b, rp);
+	atomic_inc(&num_drc_entries);
+	atomic_add(sizeof(*rp), &drc_mem_usage);
+
+	/* Make room for the new entry if the cache has grown too large */
+	if (atomic_read(&num_drc_entries) > max_drc_entries)
+		prune_bucket(b);
  out:
-	spin_unlock(&cache_lock);
+	spin_unlock(&b->cache_lock);
 	return rtn;
 
 found_entry:
+	nfsdstats.rchits++;
 	/* We found a matching entry which is either in progress or done. */
 	age = jiffies - rp->c_timestamp;
-	rp->c_timestamp = jiffies;
-	lru_put_end(rp);
+	lru_put_end(b, rp);
 
 	rtn = RC_DROPIT;
 	/* Request being processed or excessive rexmits */
@@ -231,7 +487,7 @@ found_entry:
 		break;
 	default:
 		printk(KERN_WARNING "nfsd: bad repcache type %d\n", rp->c_type);
-		rp->c_state = RC_UNUSED;
+		nfsd_reply_cache_free_locked(rp);
 	}
 
 	goto out;
@@ -257,18 +513,21 @@ void
 nfsd_cache_update(struct svc_rqst *rqstp, int cachetype, __be32 *statp)
 {
 	struct svc_cacherep *rp;
+	struct nfsd_drc_bucket *b;
 	struct kvec	*resv = &rqstp->rq_res.head[0], *cachv;
 	int		len;
 
 	if (!(rp = rqstp->rq_cacherep) || cache_disabled)
 		return;
 
+	b = nfsd_cache_bucket_find(rp->c_xid);
+
 	len = resv->iov_len - ((char*)statp - (char*)resv->iov_base);
 	len >>= 2;
 
 	/* Don't cache excessive amounts of data and XDR failures */
 	if (!statp || len > (256 >> 2)) {
-		rp->c_state = RC_UNUSED;
+		nfsd_reply_cache_free(b, rp);
 		return;
 	}
 
@@ -282,22 +541,23 @@ nfsd_cache_update(struct svc_rqst *rqstp, int cachetype, __be32 *statp)
 		cachv = &rp->c_replvec;
 		cachv->iov_base = kmalloc(len << 2, GFP_KERNEL);
 		if (!cachv->iov_base) {
-			spin_lock(&cache_lock);
-			rp->c_state = RC_UNUSED;
-			spin_unlock(&cache_lock);
+			nfsd_reply_cache_free(b, rp);
 			return;
 		}
 		cachv->iov_len = len << 2;
 		memcpy(cachv->iov_base, statp, len << 2);
+		atomic_add(cachv->iov_len, &drc_mem_usage);
 		break;
+	case RC_NOCACHE:
+		nfsd_reply_cache_free(b, rp);
+		return;
 	}
-	spin_lock(&cache_lock);
-	lru_put_end(rp);
+	spin_lock(&b->cache_lock);
+	lru_put_end(b, rp);
 	rp->c_secure = rqstp->rq_secure;
 	rp->c_type = cachetype;
 	rp->c_state = RC_DONE;
-	rp->c_timestamp = jiffies;
-	spin_unlock(&cache_lock);
+	spin_unlock(&b->cache_lock);
 	return;
 }
 
@@ -320,3 +580,52 @@ nfsd_cache_append(struct svc_rqst *rqstp, struct kvec *data)
 	vec->iov_len += data->iov_len;
 	return 1;
 }
+
+/*
+ * Note that fields may be added, removed or reordered in the future. Programs
+ * scraping this file for info should test the labels to ensure they're
+ * getting the correct field.
+ */
+static int nfsd_reply_cache_stats_show(struct seq_file *m, void *v)
+{
+	unsigned int contended = 0, payload_misses = 0;
+	unsigned int longest_chain = 0, longest_chain_cachesize = 0;
+	unsigned int i;
+
+	for (i = 0; drc_hashtbl && i < (1U << maskbits); i++) {
+		struct nfsd_drc_bucket *b = &drc_hashtbl[i];
+
+		spin_lock(&b->cache_lock);
+		contended += b->contended;
+		payload_misses += b->payload_misses;
+		if (b->longest_chain > longest_chain) {
+			longest_chain = b->longest_chain;
+			longest_chain_cachesize = b->longest_chain_cachesize;
+		} else if (b->longest_chain &&
+			   b->longest_chain == longest_chain) {
+			longest_chain_cachesize = min(longest_chain_cachesize,
+					b->longest_chain_cachesize);
+		}
+		spin_unlock(&b->cache_lock);
+	}
+
+	seq_printf(m, "max entries:           %u\n", max_drc_entries);
+	seq_printf(m, "num entries:           %u\n",
+			atomic_read(&num_drc_entries));
+	seq_printf(m, "hash buckets:          %u\n", 1U << maskbits);
+	seq_printf(m, "mem usage:             %u\n",
+			atomic_read(&drc_mem_usage));
+	seq_printf(m, "cache hits:            %u\n", nfsdstats.rchits);
+	seq_printf(m, "cache misses:          %u\n", nfsdstats.rcmisses);
+	seq_printf(m, "not cached:            %u\n", nfsdstats.rcnocache);
+	seq_printf(m, "payload misses:        %u\n", payload_misses);
+	seq_printf(m, "longest chain len:     %u\n", longest_chain);
+	seq_printf(m, "cachesize at longest:  %u\n", longest_chain_cachesize);
+	seq_printf(m, "lock contentions:      %u\n", contended);
+	return 0;
+}
+
+int nfsd_reply_cache_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nfsd_reply_cache_stats_show, NULL);
+}
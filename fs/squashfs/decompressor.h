@@ -23,33 +23,59 @@
  * decompressor.h
  */
 
+#include "page_actor.h"
+
 struct squashfs_decompressor {
 	void	*(*init)(struct squashfs_sb_info *);
 	void	(*free)(void *);
-	int	(*decompress)(struct squashfs_sb_info *, void **,
-		struct buffer_head **, int, int, int, int, int);
+	int	(*decompress)(struct squashfs_sb_info *, void *,
+		struct buffer_head **, int, int, int,
+		struct squashfs_page_actor *);
 	int	id;
 	char	*name;
 	int	supported;
 };
 
-static inline void *squashfs_decompressor_init(struct squashfs_sb_info *msblk)
+/*
+ * A decompressor implementation (zlib, lzo) only knows how to decompress
+ * using one stream.  How streams are allocated and shared between
+ * concurrent readers is decided by the thread operations below, which
+ * are selected per superblock (see the "threads=" mount option).
+ */
+struct squashfs_decompressor_thread_ops {
+	void	*(*create)(struct squashfs_sb_info *);
+	void	(*destroy)(struct squashfs_sb_info *);
+	int	(*decompress)(struct squashfs_sb_info *, struct buffer_head **,
+		int, int, int, struct squashfs_page_actor *);
+	char	*name;
+};
+
+/* decompressor_single.c */
+extern const struct squashfs_decompressor_thread_ops
+	squashfs_decompressor_single;
+
+/* decompressor_multi_percpu.c */
+extern const struct squashfs_decompressor_thread_ops
+	squashfs_decompressor_percpu;
+
+static inline void *squashfs_decompressor_create(
+	struct squashfs_sb_info *msblk)
 {
-	return msblk->decompressor->init(msblk);
+	return msblk->thread_ops->create(msblk);
 }
 
-static inline void squashfs_decompressor_free(struct squashfs_sb_info *msblk,
-	void *s)
+static inline void squashfs_decompressor_destroy(
+	struct squashfs_sb_info *msblk)
 {
-	if (msblk->decompressor)
-		msblk->decompressor->free(s);
+	if (msblk->decompressor && msblk->stream)
+		msblk->thread_ops->destroy(msblk);
 }
 
 static inline int squashfs_decompress(struct squashfs_sb_info *msblk,
-	void **buffer, struct buffer_head **bh, int b, int offset, int length,
-	int srclength, int pages)
+	struct buffer_head **bh, int b, int offset, int length,
+	struct squashfs_page_actor *output)
 {
-	return msblk->decompressor->decompress(msblk, buffer, bh, b, offset,
-		length, srclength, pages);
+	return msblk->thread_ops->decompress(msblk, bh, b, offset, length,
+		output);
 }
 #endif
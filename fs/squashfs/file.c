@@ -409,6 +409,18 @@ static int squashfs_readpage(struct file *file, struct page *page)
 				 msblk->block_size;
 			sparse = 1;
 		} else {
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+			/*
+			 * Try to decompress the datablock straight into the
+			 * page cache, bypassing the read cache.
+			 */
+			int res = squashfs_readpage_block(page, block, bsize);
+
+			if (res == 0)
+				return 0;
+			if (res < 0)
+				goto error_out;
+#endif
 			/*
 			 * Read and decompress datablock.
 			 */
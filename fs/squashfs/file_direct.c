@@ -0,0 +1,148 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * Copyright (c) 2002, 2003, 2004, 2005, 2006, 2007, 2008, 2009
+ * Phillip Lougher <phillip@lougher.demon.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * file_direct.c
+ */
+
+/*
+ * This file decompresses datablocks directly into the page cache.
+ * Rather than decompressing into the single "read_page" cache entry
+ * and copying out of it, all the page cache pages covering the
+ * datablock are grabbed and passed to the decompressor as its output
+ * buffer.  Readers of different datablocks therefore do not serialise
+ * on the read cache, and readahead, which calls ->readpage for the
+ * first page of each datablock, fills the whole block in one pass.
+ */
+
+#include <linux/fs.h>
+#include <linux/vfs.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs_fs_i.h"
+#include "squashfs.h"
+#include "page_actor.h"
+
+/*
+ * Read a datablock straight into the page cache.  Returns 0 if the
+ * datablock was decompressed and all its pages (including target_page)
+ * are now uptodate and unlocked, a negative errno if the read failed,
+ * or 1 if some page of the datablock could not be grabbed, in which case
+ * the caller should fall back to reading through the read cache.  In
+ * the last two cases target_page is still locked.
+ */
+int squashfs_readpage_block(struct page *target_page, u64 block, int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = start_index | mask;
+	int i, n, pages, bytes, res = -ENOMEM;
+	struct squashfs_page_actor *actor;
+	struct page **page;
+	void *pageaddr;
+
+	if (end_index > file_end)
+		end_index = file_end;
+
+	pages = end_index - start_index + 1;
+
+	page = kmalloc(sizeof(void *) * pages, GFP_KERNEL);
+	if (page == NULL)
+		return res;
+
+	/*
+	 * The actor maps one page at a time while decompressing, so that a
+	 * large datablock does not tie up as many kmap slots as it has pages.
+	 */
+	actor = squashfs_page_actor_init_special(page, pages, 0);
+	if (actor == NULL)
+		goto out_page;
+
+	/*
+	 * Grab all the pages of the datablock.  Give up (and let the caller
+	 * use the read cache) if any of them is missing, locked by somebody
+	 * else, or already uptodate.
+	 */
+	for (i = 0, n = start_index; i < pages; i++, n++) {
+		page[i] = (n == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+
+		if (page[i] == NULL || PageUptodate(page[i]))
+			goto fallback;
+	}
+
+	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+
+	if (res >= 0) {
+		/* Zero the part of the last page not covered by the block */
+		bytes = res - (pages - 1) * PAGE_CACHE_SIZE;
+		if (bytes >= 0 && bytes < PAGE_CACHE_SIZE) {
+			pageaddr = kmap_atomic(page[pages - 1], KM_USER0);
+			memset(pageaddr + bytes, 0, PAGE_CACHE_SIZE - bytes);
+			kunmap_atomic(pageaddr, KM_USER0);
+		} else if (bytes < 0)
+			res = -EIO;
+	}
+
+	if (res < 0) {
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+		goto release_pages;
+	}
+
+	/* Mark pages as uptodate, unlock and release */
+	for (i = 0; i < pages; i++) {
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		if (page[i] != target_page)
+			page_cache_release(page[i]);
+	}
+
+	kfree(actor);
+	kfree(page);
+
+	return 0;
+
+fallback:
+	res = 1;
+	pages = i + 1;
+release_pages:
+	/* Leave target_page locked for the caller */
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL || page[i] == target_page)
+			continue;
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+	kfree(actor);
+out_page:
+	kfree(page);
+	return res;
+}
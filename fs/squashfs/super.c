@@ -36,6 +36,9 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/mount.h>
+#include <linux/parser.h>
+#include <linux/seq_file.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -74,6 +77,66 @@ static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 }
 
 
+#ifdef CONFIG_SQUASHFS_DECOMP_MULTI_PERCPU
+#define SQUASHFS_DEFAULT_THREAD_OPS	(&squashfs_decompressor_percpu)
+#else
+#define SQUASHFS_DEFAULT_THREAD_OPS	(&squashfs_decompressor_single)
+#endif
+
+enum {
+	Opt_threads_single,
+	Opt_threads_percpu,
+	Opt_threads_err,
+	Opt_err
+};
+
+static const match_table_t squashfs_tokens = {
+	{Opt_threads_single, "threads=single"},
+	{Opt_threads_percpu, "threads=percpu"},
+	{Opt_threads_err, "threads=%s"},
+	{Opt_err, NULL}
+};
+
+/*
+ * Parse mount options.  Squashfs has historically ignored any options
+ * it was given, so unknown options are still ignored; only a bad value
+ * for an option we do understand is an error.
+ */
+static int squashfs_parse_options(char *options,
+	const struct squashfs_decompressor_thread_ops **thread_ops)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+
+	*thread_ops = SQUASHFS_DEFAULT_THREAD_OPS;
+
+	if (!options)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		if (!*p)
+			continue;
+
+		switch (match_token(p, squashfs_tokens, args)) {
+		case Opt_threads_single:
+			*thread_ops = &squashfs_decompressor_single;
+			break;
+		case Opt_threads_percpu:
+			*thread_ops = &squashfs_decompressor_percpu;
+			break;
+		case Opt_threads_err:
+			ERROR("Invalid value for threads= option, "
+				"expected single or percpu\n");
+			return -EINVAL;
+		default:
+			break;
+		}
+	}
+
+	return 0;
+}
+
+
 static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 {
 	struct squashfs_sb_info *msblk;
@@ -95,6 +158,13 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	}
 	msblk = sb->s_fs_info;
 
+	err = squashfs_parse_options(data, &msblk->thread_ops);
+	if (err) {
+		kfree(sb->s_fs_info);
+		sb->s_fs_info = NULL;
+		return err;
+	}
+
 	sblk = kzalloc(sizeof(*sblk), GFP_KERNEL);
 	if (sblk == NULL) {
 		ERROR("Failed to allocate squashfs_super_block\n");
@@ -104,7 +174,6 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	msblk->devblksize = sb_min_blocksize(sb, BLOCK_SIZE);
 	msblk->devblksize_log2 = ffz(~msblk->devblksize);
 
-	mutex_init(&msblk->read_data_mutex);
 	mutex_init(&msblk->meta_index_mutex);
 
 	/*
@@ -199,7 +268,7 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 
 	err = -ENOMEM;
 
-	msblk->stream = squashfs_decompressor_init(msblk);
+	msblk->stream = squashfs_decompressor_create(msblk);
 	if (msblk->stream == NULL)
 		goto failed_mount;
 
@@ -306,7 +375,7 @@ failed_mount:
 	squashfs_cache_delete(msblk->block_cache);
 	squashfs_cache_delete(msblk->fragment_cache);
 	squashfs_cache_delete(msblk->read_page);
-	squashfs_decompressor_free(msblk, msblk->stream);
+	squashfs_decompressor_destroy(msblk);
 	kfree(msblk->inode_lookup_table);
 	kfree(msblk->fragment_index);
 	kfree(msblk->id_table);
@@ -351,6 +420,16 @@ static int squashfs_remount(struct super_block *sb, int *flags, char *data)
 }
 
 
+static int squashfs_show_options(struct seq_file *seq, struct vfsmount *mnt)
+{
+	struct squashfs_sb_info *msblk = mnt->mnt_sb->s_fs_info;
+
+	if (msblk->thread_ops != SQUASHFS_DEFAULT_THREAD_OPS)
+		seq_printf(seq, ",threads=%s", msblk->thread_ops->name);
+	return 0;
+}
+
+
 static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
@@ -358,7 +437,7 @@ static void squashfs_put_super(struct super_block *sb)
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
-		squashfs_decompressor_free(sbi, sbi->stream);
+		squashfs_decompressor_destroy(sbi);
 		kfree(sbi->id_table);
 		kfree(sbi->fragment_index);
 		kfree(sbi->meta_index);
@@ -461,7 +540,8 @@ static const struct super_operations squashfs_super_ops = {
 	.destroy_inode = squashfs_destroy_inode,
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
-	.remount_fs = squashfs_remount
+	.remount_fs = squashfs_remount,
+	.show_options = squashfs_show_options
 };
 
 module_init(init_squashfs_fs);
@@ -37,6 +37,8 @@ extern void cgroup_post_fork(struct task_struct *p);
 extern void cgroup_exit(struct task_struct *p, int run_callbacks);
 extern int cgroupstats_build(struct cgroupstats *stats,
 				struct dentry *dentry);
+extern int cgroupstats_has_task(struct dentry *dentry,
+				struct task_struct *tsk);
 extern int cgroup_load_subsys(struct cgroup_subsys *ss);
 extern void cgroup_unload_subsys(struct cgroup_subsys *ss);
 
@@ -643,6 +645,11 @@ static inline int cgroupstats_build(struct cgroupstats *stats,
 {
 	return -EINVAL;
 }
+static inline int cgroupstats_has_task(struct dentry *dentry,
+					struct task_struct *tsk)
+{
+	return -EINVAL;
+}
 
 /* No cgroups - nothing to do */
 static inline int cgroup_attach_task_all(struct task_struct *from,
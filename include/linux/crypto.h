@@ -306,6 +306,24 @@ struct crypto_alg {
 int crypto_register_alg(struct crypto_alg *alg);
 int crypto_unregister_alg(struct crypto_alg *alg);
 
+/*
+ * Crypto notification events.  CRYPTO_MSG_ALG_LOADED is sent with the
+ * struct crypto_alg once a newly registered algorithm has been tested,
+ * so that users holding a transform can switch to a better driver.
+ */
+enum {
+	CRYPTO_MSG_ALG_REQUEST,
+	CRYPTO_MSG_ALG_REGISTER,
+	CRYPTO_MSG_ALG_UNREGISTER,
+	CRYPTO_MSG_TMPL_REGISTER,
+	CRYPTO_MSG_TMPL_UNREGISTER,
+	CRYPTO_MSG_ALG_LOADED,
+};
+
+struct notifier_block;
+int crypto_register_notifier(struct notifier_block *nb);
+int crypto_unregister_notifier(struct notifier_block *nb);
+
 /*
  * Algorithm query interface.
  */
@@ -228,6 +228,25 @@ NF_HOOK(uint8_t pf, unsigned int hook, struct sk_buff *skb,
 	return NF_HOOK_THRESH(pf, hook, skb, in, out, okfn, INT_MIN);
 }
 
+/* Run the hook on every skb of @list, leaving only those that okfn()
+ * would have been called for.  The caller then processes the rest as
+ * a batch.
+ */
+static inline void
+NF_HOOK_LIST(uint8_t pf, unsigned int hook, struct sk_buff_head *list,
+	     struct net_device *in, struct net_device *out,
+	     int (*okfn)(struct sk_buff *))
+{
+	struct sk_buff_head sublist;
+	struct sk_buff *skb;
+
+	__skb_queue_head_init(&sublist);
+	while ((skb = __skb_dequeue(list)) != NULL)
+		if (nf_hook_thresh(pf, hook, skb, in, out, okfn, INT_MIN) == 1)
+			__skb_queue_tail(&sublist, skb);
+	skb_queue_splice_init(&sublist, list);
+}
+
 /* Call setsockopt() */
 int nf_setsockopt(struct sock *sk, u_int8_t pf, int optval, char __user *opt,
 		  unsigned int len);
@@ -333,6 +352,12 @@ extern struct proc_dir_entry *proc_net_netfilter;
 #else /* !CONFIG_NETFILTER */
 #define NF_HOOK(pf, hook, skb, indev, outdev, okfn) (okfn)(skb)
 #define NF_HOOK_COND(pf, hook, skb, indev, outdev, okfn, cond) (okfn)(skb)
+static inline void
+NF_HOOK_LIST(uint8_t pf, unsigned int hook, struct sk_buff_head *list,
+	     struct net_device *in, struct net_device *out,
+	     int (*okfn)(struct sk_buff *))
+{
+}
 static inline int nf_hook_thresh(u_int8_t pf, unsigned int hook,
 				 struct sk_buff *skb,
 				 struct net_device *indev,
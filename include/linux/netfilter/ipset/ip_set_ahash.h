@@ -0,0 +1,646 @@
+#ifndef _IP_SET_AHASH_H
+#define _IP_SET_AHASH_H
+
+/* Generic hash engine of the hash:* set types
+ *
+ * The elements are fixed size keys, hashed with jhash2() into an array
+ * of buckets.  A bucket is a small array of elements which is never
+ * modified in place: adding or deleting an element builds a new copy of
+ * the bucket, publishes it with rcu_assign_pointer() and frees the old
+ * one after a grace period.  Lookups from the packet path therefore run
+ * under rcu_read_lock_bh() only, while writers are serialized by the
+ * set->lock spinlock.
+ *
+ * When a bucket would grow beyond AHASH_MAX_SIZE elements, the add
+ * operation returns -EAGAIN and the core calls the resize function,
+ * which doubles the table until every bucket fits.
+ *
+ * Every set type includes this file and builds its variant from the
+ * functions here plus its own kadt/uadt functions.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <linux/rcupdate.h>
+#include <linux/slab.h>
+#include <linux/timer.h>
+#include <linux/netfilter/ipset/ip_set_timeout.h>
+
+/* Max number of elements in a bucket before the table is grown */
+#define AHASH_MAX_SIZE		8
+
+/* Max number of bits of the hash table */
+#define AHASH_MAX_BITS		31
+
+/* A bucket of the hash table */
+struct hbucket {
+	struct rcu_head rcu;	/* freeing the replaced copies */
+	u8 size;		/* number of elements in value */
+	/* the elements */
+	char value[0] __aligned(__alignof__(unsigned long));
+};
+
+/* The hash table: the table itself and the array of buckets */
+struct htable {
+	u8 htable_bits;		/* size of hash table == 2^htable_bits */
+	struct hbucket __rcu *bucket[0];
+};
+
+/* The generic hash structure */
+struct ip_set_hash {
+	struct htable __rcu *table; /* the hash table */
+	u32 maxelem;		/* max elements in the hash */
+	u32 elements;		/* current element (vs timeout) */
+	u32 initval;		/* random jhash init value */
+	u32 timeout;		/* timeout value, if enabled */
+	u8 dsize;		/* size of the key, multiple of 4 */
+	u8 tofs;		/* offset of the timeout in an element */
+	u8 esize;		/* size of an element */
+	struct timer_list gc;	/* garbage collection when timeout enabled */
+	/* Number of elements per prefix length when the key starts
+	 * with the cidr value of the element (hash:net), else NULL
+	 */
+	u32 *nets;
+	/* Element an IPv4 range add stopped at with -EAGAIN, host order */
+	u32 next_ip;
+	u16 next_port;
+	/* Dump the key of an element */
+	int (*data_list)(struct sk_buff *skb, const void *data);
+};
+
+#define ahash_size(n)		((u32)1 << (n))
+#define ahash_mask(n)		(ahash_size(n) - 1)
+
+#define ahash_elem(h, n, i)	((void *)((n)->value + (i) * (h)->esize))
+#define ahash_timeout(h, e)	(*(unsigned long *)((char *)(e) + (h)->tofs))
+
+/* The table is replaced by the resize function only, which is
+ * serialized by the nfnl mutex like every other control operation.
+ */
+#define ahash_table(h)		rcu_dereference_protected((h)->table, 1)
+
+static inline u32
+ahash_hkey(const struct ip_set_hash *h, const void *key, u8 htable_bits)
+{
+	return jhash2(key, h->dsize / sizeof(u32), h->initval)
+		& ahash_mask(htable_bits);
+}
+
+static inline bool
+ahash_elem_expired(const struct ip_set_hash *h, const void *e)
+{
+	return with_timeout(h->timeout) &&
+	       ip_set_timeout_expired(ahash_timeout(h, e));
+}
+
+static inline void
+ahash_elem_add(struct ip_set_hash *h, const void *e)
+{
+	h->elements++;
+	if (h->nets)
+		h->nets[*(const u8 *)e]++;
+}
+
+static inline void
+ahash_elem_gone(struct ip_set_hash *h, const void *e)
+{
+	h->elements--;
+	if (h->nets)
+		h->nets[*(const u8 *)e]--;
+}
+
+static void
+ahash_bucket_free_rcu(struct rcu_head *head)
+{
+	kfree(container_of(head, struct hbucket, rcu));
+}
+
+/* Replace a published bucket, the old one is freed after a grace period */
+static void
+ahash_bucket_replace(struct htable *t, u32 key, struct hbucket *old,
+		     struct hbucket *n)
+{
+	rcu_assign_pointer(t->bucket[key], n);
+	if (old)
+		call_rcu_bh(&old->rcu, ahash_bucket_free_rcu);
+}
+
+/* Make a copy of a bucket, leaving out the element at index skip and
+ * the expired elements and with room for extra new elements.  Returns
+ * NULL if the new bucket would be empty.
+ */
+static struct hbucket *
+ahash_bucket_copy(struct ip_set_hash *h, const struct hbucket *n,
+		  int skip, u8 extra)
+{
+	struct hbucket *m;
+	const void *e;
+	int i, live = 0;
+
+	for (i = 0; n && i < n->size; i++)
+		if (i != skip && !ahash_elem_expired(h, ahash_elem(h, n, i)))
+			live++;
+	if (!live && !extra)
+		return NULL;
+
+	m = kzalloc(sizeof(*m) + (live + extra) * h->esize, GFP_ATOMIC);
+	if (!m)
+		return ERR_PTR(-ENOMEM);
+
+	for (i = 0; n && i < n->size; i++) {
+		if (i == skip)
+			continue;
+		e = ahash_elem(h, n, i);
+		if (ahash_elem_expired(h, e)) {
+			ahash_elem_gone(h, e);
+			continue;
+		}
+		memcpy(ahash_elem(h, m, m->size++), e, h->esize);
+	}
+	return m;
+}
+
+static void
+ahash_table_destroy(struct htable *t)
+{
+	u32 i;
+
+	for (i = 0; i < ahash_size(t->htable_bits); i++)
+		kfree(rcu_dereference_protected(t->bucket[i], 1));
+	ip_set_free(t);
+}
+
+static size_t
+ahash_memsize(const struct ip_set_hash *h, const struct htable *t)
+{
+	const struct hbucket *n;
+	size_t memsize = sizeof(*h) + sizeof(*t) +
+			 ahash_size(t->htable_bits) * sizeof(n);
+	u32 i;
+
+	for (i = 0; i < ahash_size(t->htable_bits); i++) {
+		n = rcu_dereference_bh(t->bucket[i]);
+		if (n)
+			memsize += sizeof(*n) + n->size * h->esize;
+	}
+	return memsize;
+}
+
+/* Test the presence of the key: under rcu_read_lock_bh() */
+static int
+ahash_test(struct ip_set *set, const void *key)
+{
+	const struct ip_set_hash *h = set->data;
+	const struct htable *t = rcu_dereference_bh(h->table);
+	const struct hbucket *n;
+	const void *e;
+	int i;
+
+	n = rcu_dereference_bh(t->bucket[ahash_hkey(h, key, t->htable_bits)]);
+	for (i = 0; n && i < n->size; i++) {
+		e = ahash_elem(h, n, i);
+		if (memcmp(e, key, h->dsize) == 0)
+			return !ahash_elem_expired(h, e);
+	}
+	return 0;
+}
+
+/* Drop the expired elements: with set->lock held */
+static void
+ahash_expire(struct ip_set_hash *h)
+{
+	struct htable *t = rcu_dereference_bh(h->table);
+	struct hbucket *n, *m;
+	u32 i;
+	int j;
+
+	for (i = 0; i < ahash_size(t->htable_bits); i++) {
+		n = rcu_dereference_bh(t->bucket[i]);
+		for (j = 0; n && j < n->size; j++)
+			if (ahash_elem_expired(h, ahash_elem(h, n, j)))
+				break;
+		if (!n || j == n->size)
+			continue;
+		m = ahash_bucket_copy(h, n, -1, 0);
+		if (IS_ERR(m))
+			/* Try again at the next run */
+			continue;
+		ahash_bucket_replace(t, i, n, m);
+	}
+}
+
+/* Add the key: with set->lock held */
+static int
+ahash_add(struct ip_set *set, const void *key, u32 timeout, u32 flags)
+{
+	struct ip_set_hash *h = set->data;
+	struct htable *t = rcu_dereference_bh(h->table);
+	struct hbucket *n, *m;
+	u32 hkey;
+	void *e;
+	int i, live = 0;
+
+	if (h->elements >= h->maxelem) {
+		if (with_timeout(h->timeout))
+			ahash_expire(h);
+		if (h->elements >= h->maxelem)
+			return -IPSET_ERR_HASH_FULL;
+	}
+
+	hkey = ahash_hkey(h, key, t->htable_bits);
+	n = rcu_dereference_bh(t->bucket[hkey]);
+	for (i = 0; n && i < n->size; i++) {
+		e = ahash_elem(h, n, i);
+		if (memcmp(e, key, h->dsize) == 0) {
+			if (ahash_elem_expired(h, e)) {
+				/* Revive it: a single store, safe for readers */
+				ahash_timeout(h, e) = ip_set_timeout_set(timeout);
+				return 0;
+			}
+			if (with_timeout(h->timeout) &&
+			    (flags & IPSET_FLAG_EXIST))
+				ahash_timeout(h, e) = ip_set_timeout_set(timeout);
+			return -IPSET_ERR_EXIST;
+		}
+		if (!ahash_elem_expired(h, e))
+			live++;
+	}
+	if (live >= AHASH_MAX_SIZE)
+		return -EAGAIN;
+
+	m = ahash_bucket_copy(h, n, -1, 1);
+	if (IS_ERR(m))
+		return PTR_ERR(m);
+	e = ahash_elem(h, m, m->size++);
+	memcpy(e, key, h->dsize);
+	if (with_timeout(h->timeout))
+		ahash_timeout(h, e) = ip_set_timeout_set(timeout);
+	ahash_elem_add(h, e);
+	ahash_bucket_replace(t, hkey, n, m);
+
+	return 0;
+}
+
+/* Delete the key: with set->lock held */
+static int
+ahash_del(struct ip_set *set, const void *key)
+{
+	struct ip_set_hash *h = set->data;
+	struct htable *t = rcu_dereference_bh(h->table);
+	struct hbucket *n, *m;
+	u32 hkey;
+	void *e;
+	int i;
+
+	hkey = ahash_hkey(h, key, t->htable_bits);
+	n = rcu_dereference_bh(t->bucket[hkey]);
+	for (i = 0; n && i < n->size; i++) {
+		e = ahash_elem(h, n, i);
+		if (memcmp(e, key, h->dsize) != 0)
+			continue;
+		if (ahash_elem_expired(h, e))
+			break;
+		m = ahash_bucket_copy(h, n, i, 0);
+		if (IS_ERR(m))
+			return PTR_ERR(m);
+		ahash_elem_gone(h, e);
+		ahash_bucket_replace(t, hkey, n, m);
+		return 0;
+	}
+	return -IPSET_ERR_EXIST;
+}
+
+/* Append an element to a bucket of a table not published yet */
+static int
+ahash_bucket_append(struct ip_set_hash *h, struct htable *t, u32 key,
+		    const void *e)
+{
+	struct hbucket *n, *m;
+
+	n = rcu_dereference_protected(t->bucket[key], 1);
+	if (n && n->size >= AHASH_MAX_SIZE)
+		return -EAGAIN;
+
+	m = kzalloc(sizeof(*m) + ((n ? n->size : 0) + 1) * h->esize,
+		    GFP_ATOMIC);
+	if (!m)
+		return -ENOMEM;
+	if (n) {
+		memcpy(m->value, n->value, n->size * h->esize);
+		m->size = n->size;
+		kfree(n);
+	}
+	memcpy(ahash_elem(h, m, m->size++), e, h->esize);
+	RCU_INIT_POINTER(t->bucket[key], m);
+
+	return 0;
+}
+
+/* Grow the hash table: called without set->lock held */
+static int
+ahash_resize(struct ip_set *set, bool retried)
+{
+	struct ip_set_hash *h = set->data;
+	struct htable *t, *orig = ahash_table(h);
+	const struct hbucket *n;
+	u8 htable_bits = orig->htable_bits;
+	u32 i;
+	int j, ret;
+
+retry:
+	if (++htable_bits > AHASH_MAX_BITS)
+		return -IPSET_ERR_HASH_FULL;
+	t = ip_set_alloc(sizeof(*t) +
+			 ahash_size(htable_bits) * sizeof(struct hbucket *));
+	if (!t)
+		return -ENOMEM;
+	t->htable_bits = htable_bits;
+
+	pr_debug("attempt to resize set %s from %u to %u, t %p\n",
+		 set->name, orig->htable_bits, htable_bits, t);
+
+	spin_lock_bh(&set->lock);
+	for (i = 0; i < ahash_size(orig->htable_bits); i++) {
+		n = rcu_dereference_bh(orig->bucket[i]);
+		for (j = 0; n && j < n->size; j++) {
+			const void *e = ahash_elem(h, n, j);
+
+			ret = ahash_bucket_append(h, t,
+					ahash_hkey(h, e, htable_bits), e);
+			if (ret) {
+				spin_unlock_bh(&set->lock);
+				ahash_table_destroy(t);
+				if (ret == -EAGAIN)
+					goto retry;
+				return ret;
+			}
+		}
+	}
+	rcu_assign_pointer(h->table, t);
+	spin_unlock_bh(&set->lock);
+
+	/* Give time to other readers of the set */
+	synchronize_rcu_bh();
+
+	pr_debug("set %s resized from %u to %u\n",
+		 set->name, orig->htable_bits, htable_bits);
+	ahash_table_destroy(orig);
+
+	return 0;
+}
+
+/* Flush the set: with set->lock held */
+static void
+ahash_flush(struct ip_set *set)
+{
+	struct ip_set_hash *h = set->data;
+	struct htable *t = rcu_dereference_bh(h->table);
+	struct hbucket *n;
+	u32 i;
+
+	for (i = 0; i < ahash_size(t->htable_bits); i++) {
+		n = rcu_dereference_bh(t->bucket[i]);
+		if (n)
+			ahash_bucket_replace(t, i, n, NULL);
+	}
+	h->elements = 0;
+	if (h->nets)
+		memset(h->nets, 0,
+		       (set->family == NFPROTO_IPV4 ? 33 : 129) * sizeof(u32));
+}
+
+static void
+ahash_destroy(struct ip_set *set)
+{
+	struct ip_set_hash *h = set->data;
+
+	if (with_timeout(h->timeout))
+		del_timer_sync(&h->gc);
+
+	ahash_table_destroy(ahash_table(h));
+	kfree(h->nets);
+	kfree(h);
+
+	set->data = NULL;
+}
+
+static int
+ahash_head(struct ip_set *set, struct sk_buff *skb)
+{
+	const struct ip_set_hash *h = set->data;
+	const struct htable *t;
+	struct nlattr *nested;
+	size_t memsize;
+	u8 htable_bits;
+
+	rcu_read_lock_bh();
+	t = rcu_dereference_bh(h->table);
+	htable_bits = t->htable_bits;
+	memsize = ahash_memsize(h, t);
+	rcu_read_unlock_bh();
+
+	nested = ipset_nest_start(skb, IPSET_ATTR_DATA);
+	if (!nested)
+		goto nla_put_failure;
+	NLA_PUT_NET32(skb, IPSET_ATTR_HASHSIZE,
+		      htonl(ahash_size(htable_bits)));
+	NLA_PUT_NET32(skb, IPSET_ATTR_MAXELEM, htonl(h->maxelem));
+	NLA_PUT_NET32(skb, IPSET_ATTR_REFERENCES, htonl(set->ref - 1));
+	NLA_PUT_NET32(skb, IPSET_ATTR_MEMSIZE, htonl(memsize));
+	if (with_timeout(h->timeout))
+		NLA_PUT_NET32(skb, IPSET_ATTR_TIMEOUT, htonl(h->timeout));
+	ipset_nest_end(skb, nested);
+
+	return 0;
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+/* Dump the elements, bucket by bucket: the next bucket to dump is
+ * kept in cb->args[IPSET_CB_ARG0].
+ */
+static int
+ahash_list(const struct ip_set *set, struct sk_buff *skb,
+	   struct netlink_callback *cb)
+{
+	const struct ip_set_hash *h = set->data;
+	const struct htable *t;
+	const struct hbucket *n;
+	struct nlattr *atd, *nested;
+	const void *e;
+	u32 first = cb->args[IPSET_CB_ARG0];
+	void *incomplete;
+	int i;
+
+	atd = ipset_nest_start(skb, IPSET_ATTR_ADT);
+	if (!atd)
+		return -EMSGSIZE;
+
+	rcu_read_lock_bh();
+	t = rcu_dereference_bh(h->table);
+	for (; cb->args[IPSET_CB_ARG0] < ahash_size(t->htable_bits);
+	     cb->args[IPSET_CB_ARG0]++) {
+		incomplete = skb_tail_pointer(skb);
+		n = rcu_dereference_bh(t->bucket[cb->args[IPSET_CB_ARG0]]);
+		for (i = 0; n && i < n->size; i++) {
+			e = ahash_elem(h, n, i);
+			if (ahash_elem_expired(h, e))
+				continue;
+			nested = ipset_nest_start(skb, IPSET_ATTR_DATA);
+			if (!nested)
+				goto nla_put_failure;
+			if (h->data_list(skb, e))
+				goto nla_put_failure;
+			if (with_timeout(h->timeout))
+				NLA_PUT_NET32(skb, IPSET_ATTR_TIMEOUT,
+				    htonl(ip_set_timeout_get(ahash_timeout(h, e))));
+			ipset_nest_end(skb, nested);
+		}
+	}
+	rcu_read_unlock_bh();
+	ipset_nest_end(skb, atd);
+
+	/* Set listing finished */
+	cb->args[IPSET_CB_ARG0] = 0;
+	return 0;
+
+nla_put_failure:
+	rcu_read_unlock_bh();
+	nlmsg_trim(skb, incomplete);
+	ipset_nest_end(skb, atd);
+	if (unlikely(first == cb->args[IPSET_CB_ARG0])) {
+		/* Not even a single bucket fits into a message */
+		pr_warning("Can't list set %s: one bucket does not fit into "
+			   "a message. Please report it!\n", set->name);
+		cb->args[IPSET_CB_ARG0] = 0;
+		return -ENOSPC;
+	}
+	return -EMSGSIZE;
+}
+
+static bool
+ahash_same_set(const struct ip_set *a, const struct ip_set *b)
+{
+	const struct ip_set_hash *x = a->data;
+	const struct ip_set_hash *y = b->data;
+
+	/* Resizing changes htable_bits, so we ignore it */
+	return x->maxelem == y->maxelem &&
+	       x->timeout == y->timeout &&
+	       x->dsize == y->dsize;
+}
+
+static void
+ahash_gc(unsigned long ul_set)
+{
+	struct ip_set *set = (struct ip_set *) ul_set;
+	struct ip_set_hash *h = set->data;
+
+	pr_debug("called\n");
+	spin_lock_bh(&set->lock);
+	ahash_expire(h);
+	spin_unlock_bh(&set->lock);
+
+	h->gc.expires = jiffies + IPSET_GC_PERIOD(h->timeout) * HZ;
+	add_timer(&h->gc);
+}
+
+static void
+ahash_gc_init(struct ip_set *set)
+{
+	struct ip_set_hash *h = set->data;
+
+	init_timer(&h->gc);
+	h->gc.data = (unsigned long) set;
+	h->gc.function = ahash_gc;
+	h->gc.expires = jiffies + IPSET_GC_PERIOD(h->timeout) * HZ;
+	add_timer(&h->gc);
+	pr_debug("gc initialized, run in every %u\n",
+		 IPSET_GC_PERIOD(h->timeout));
+}
+
+/* Create the generic part of a hash set.  dsize is the size of the key,
+ * with_nets tells whether the first byte of the key is a prefix length
+ * to be accounted.
+ */
+static int
+ahash_create(struct ip_set *set, struct nlattr *tb[], u8 dsize,
+	     bool with_nets, const struct ip_set_type_variant *variant,
+	     int (*data_list)(struct sk_buff *skb, const void *data))
+{
+	u32 hashsize = IPSET_DEFAULT_HASHSIZE, maxelem = IPSET_DEFAULT_MAXELEM;
+	struct ip_set_hash *h;
+	struct htable *t;
+	u8 htable_bits;
+
+	if (!(set->family == NFPROTO_IPV4 || set->family == NFPROTO_IPV6))
+		return -IPSET_ERR_INVALID_FAMILY;
+
+	if (unlikely(!ip_set_optattr_netorder(tb, IPSET_ATTR_HASHSIZE) ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_MAXELEM) ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_TIMEOUT)))
+		return -IPSET_ERR_PROTOCOL;
+
+	if (tb[IPSET_ATTR_HASHSIZE]) {
+		hashsize = ip_set_get_h32(tb[IPSET_ATTR_HASHSIZE]);
+		if (hashsize < IPSET_MINIMAL_HASHSIZE)
+			hashsize = IPSET_MINIMAL_HASHSIZE;
+	}
+
+	if (tb[IPSET_ATTR_MAXELEM])
+		maxelem = ip_set_get_h32(tb[IPSET_ATTR_MAXELEM]);
+
+	h = kzalloc(sizeof(*h), GFP_KERNEL);
+	if (!h)
+		return -ENOMEM;
+
+	if (with_nets) {
+		h->nets = kzalloc((set->family == NFPROTO_IPV4 ? 33 : 129) *
+				  sizeof(u32), GFP_KERNEL);
+		if (!h->nets) {
+			kfree(h);
+			return -ENOMEM;
+		}
+	}
+
+	h->maxelem = maxelem;
+	get_random_bytes(&h->initval, sizeof(h->initval));
+	h->dsize = dsize;
+	h->tofs = ALIGN(dsize, sizeof(unsigned long));
+	h->esize = h->tofs;
+	h->timeout = IPSET_NO_TIMEOUT;
+	if (tb[IPSET_ATTR_TIMEOUT]) {
+		h->timeout = ip_set_timeout_uget(tb[IPSET_ATTR_TIMEOUT]);
+		h->esize += sizeof(unsigned long);
+	}
+	h->data_list = data_list;
+
+	htable_bits = min(get_count_order(hashsize), AHASH_MAX_BITS);
+	t = ip_set_alloc(sizeof(*t) +
+			 ahash_size(htable_bits) * sizeof(struct hbucket *));
+	if (!t) {
+		kfree(h->nets);
+		kfree(h);
+		return -ENOMEM;
+	}
+	t->htable_bits = htable_bits;
+	RCU_INIT_POINTER(h->table, t);
+
+	set->data = h;
+	set->variant = variant;
+
+	if (with_timeout(h->timeout))
+		ahash_gc_init(set);
+
+	pr_debug("create %s hashsize %u (%u) maxelem %u: %p(%p)\n",
+		 set->name, ahash_size(t->htable_bits),
+		 t->htable_bits, h->maxelem, set->data, t);
+
+	return 0;
+}
+
+#endif /* _IP_SET_AHASH_H */
@@ -0,0 +1,153 @@
+#ifndef _LINUX_NF_TABLES_H
+#define _LINUX_NF_TABLES_H
+
+/* nf_tables: packet classification by a small register machine.
+ *
+ * Userspace compiles a ruleset into chains of rules, each rule being a
+ * sequence of expressions that load packet data into registers, transform
+ * and compare it, and finally issue a verdict.  The whole ruleset of an
+ * address family is sent in one NFT_MSG_NEWRULESET message and replaces
+ * the previous one atomically.
+ *
+ * All integer attributes are in network byte order.
+ */
+
+#define NFT_REG_SIZE		16	/* bytes per data register */
+#define NFT_JUMP_STACK_SIZE	16	/* maximal chain nesting */
+#define NFT_RULE_MAXEXPRS	128	/* maximal expressions per rule */
+
+enum nft_registers {
+	NFT_REG_1,
+	NFT_REG_2,
+	NFT_REG_3,
+	NFT_REG_4,
+	__NFT_REG_MAX
+};
+#define NFT_REG_MAX		(__NFT_REG_MAX - 1)
+
+/* Verdicts besides the NF_* ones (NF_DROP and NF_ACCEPT) */
+enum nft_verdicts {
+	NFT_CONTINUE	= -1,	/* go on with the next rule */
+	NFT_BREAK	= -2,	/* internal: rule did not match */
+	NFT_JUMP	= -3,	/* call a chain, come back on return */
+	NFT_GOTO	= -4,	/* continue in a chain, do not come back */
+	NFT_RETURN	= -5,	/* return to the calling chain */
+};
+
+enum nf_tables_msg_types {
+	NFT_MSG_NEWRULESET,
+	NFT_MSG_GETRULESET,
+	NFT_MSG_DELRULESET,
+	NFT_MSG_MAX
+};
+
+/* Lists are nests of NFTA_LIST_ELEM attributes */
+enum nft_list_attributes {
+	NFTA_LIST_UNSPEC,
+	NFTA_LIST_ELEM,
+	__NFTA_LIST_MAX
+};
+#define NFTA_LIST_MAX		(__NFTA_LIST_MAX - 1)
+
+enum nft_ruleset_attributes {
+	NFTA_RULESET_UNSPEC,
+	NFTA_RULESET_SETS,		/* list of sets, referred to by index */
+	NFTA_RULESET_CHAINS,		/* list of chains, referred to by index */
+	NFTA_RULESET_GENERATION,	/* u32, replies only */
+	NFTA_RULESET_NCHAINS,		/* u32, replies only */
+	NFTA_RULESET_NRULES,		/* u32, replies only */
+	__NFTA_RULESET_MAX
+};
+#define NFTA_RULESET_MAX	(__NFTA_RULESET_MAX - 1)
+
+enum nft_set_attributes {
+	NFTA_SET_UNSPEC,
+	NFTA_SET_KEY_LEN,		/* u32: 1..NFT_REG_SIZE */
+	NFTA_SET_ELEMENTS,		/* list of binary keys */
+	__NFTA_SET_MAX
+};
+#define NFTA_SET_MAX		(__NFTA_SET_MAX - 1)
+
+enum nft_chain_attributes {
+	NFTA_CHAIN_UNSPEC,
+	NFTA_CHAIN_HOOK,		/* u32: NF_INET_*, base chains only */
+	NFTA_CHAIN_POLICY,		/* u32: NF_ACCEPT/NF_DROP, base chains */
+	NFTA_CHAIN_RULES,		/* list of rules */
+	__NFTA_CHAIN_MAX
+};
+#define NFTA_CHAIN_MAX		(__NFTA_CHAIN_MAX - 1)
+
+enum nft_rule_attributes {
+	NFTA_RULE_UNSPEC,
+	NFTA_RULE_EXPRESSIONS,		/* list of expressions */
+	__NFTA_RULE_MAX
+};
+#define NFTA_RULE_MAX		(__NFTA_RULE_MAX - 1)
+
+/* Expressions.  A rule stops matching as soon as a cmp or lookup fails
+ * or a payload/meta load is not possible for the packet.
+ */
+enum nft_expr_ops {
+	NFT_EXPR_IMMEDIATE,	/* dreg <- data */
+	NFT_EXPR_PAYLOAD,	/* dreg <- len bytes at base + offset */
+	NFT_EXPR_META,		/* dreg <- packet meta data selected by key */
+	NFT_EXPR_CMP,		/* sreg <cmp_op> data, len bytes */
+	NFT_EXPR_BITWISE,	/* dreg <- (sreg & mask) ^ xor, len bytes */
+	NFT_EXPR_LOOKUP,	/* sreg in set (cmp_op EQ) or not in set (NEQ) */
+	NFT_EXPR_VERDICT,	/* verdict, chain for NFT_JUMP/NFT_GOTO */
+	__NFT_EXPR_MAX
+};
+#define NFT_EXPR_MAX		(__NFT_EXPR_MAX - 1)
+
+enum nft_expr_attributes {
+	NFTA_EXPR_UNSPEC,
+	NFTA_EXPR_OP,			/* u32: NFT_EXPR_* */
+	NFTA_EXPR_SREG,			/* u32: NFT_REG_* */
+	NFTA_EXPR_DREG,			/* u32: NFT_REG_* */
+	NFTA_EXPR_LEN,			/* u32: 1..NFT_REG_SIZE */
+	NFTA_EXPR_BASE,			/* u32: NFT_PAYLOAD_* */
+	NFTA_EXPR_OFFSET,		/* u32 */
+	NFTA_EXPR_KEY,			/* u32: NFT_META_* */
+	NFTA_EXPR_CMP_OP,		/* u32: NFT_CMP_* */
+	NFTA_EXPR_DATA,			/* binary, len bytes */
+	NFTA_EXPR_MASK,			/* binary, len bytes */
+	NFTA_EXPR_XOR,			/* binary, len bytes */
+	NFTA_EXPR_SET,			/* u32: set index */
+	NFTA_EXPR_VERDICT,		/* u32: NF_* or NFT_* verdict */
+	NFTA_EXPR_CHAIN,		/* u32: chain index */
+	__NFTA_EXPR_MAX
+};
+#define NFTA_EXPR_MAX		(__NFTA_EXPR_MAX - 1)
+
+enum nft_payload_bases {
+	NFT_PAYLOAD_LL_HEADER,
+	NFT_PAYLOAD_NETWORK_HEADER,
+	NFT_PAYLOAD_TRANSPORT_HEADER,
+};
+
+/* Meta data is loaded in network byte order, so that cmp can order it */
+enum nft_meta_keys {
+	NFT_META_LEN,		/* u32 */
+	NFT_META_PROTOCOL,	/* be16 skb->protocol */
+	NFT_META_L4PROTO,	/* u8 */
+	NFT_META_PRIORITY,	/* u32 */
+	NFT_META_MARK,		/* u32 */
+	NFT_META_IIF,		/* u32 ifindex */
+	NFT_META_OIF,		/* u32 ifindex */
+	NFT_META_IIFNAME,	/* IFNAMSIZ bytes */
+	NFT_META_OIFNAME,	/* IFNAMSIZ bytes */
+	__NFT_META_MAX
+};
+#define NFT_META_MAX		(__NFT_META_MAX - 1)
+
+/* Comparisons are done with memcmp() on data in network byte order */
+enum nft_cmp_ops {
+	NFT_CMP_EQ,
+	NFT_CMP_NEQ,
+	NFT_CMP_LT,
+	NFT_CMP_LTE,
+	NFT_CMP_GT,
+	NFT_CMP_GTE,
+};
+
+#endif /* _LINUX_NF_TABLES_H */
@@ -0,0 +1,25 @@
+#ifndef _XT_SET_H
+#define _XT_SET_H
+
+#include <linux/types.h>
+#include <linux/netfilter/ipset/ip_set.h>
+
+/* Revision 0 interface */
+
+struct xt_set_info {
+	ip_set_id_t index;
+	__u8 dim;	/* number of address/port parts of the element */
+	__u8 flags;	/* IPSET_INV_MATCH and IPSET_DIM_*_SRC bits */
+};
+
+/* match and target infos */
+struct xt_set_info_match {
+	struct xt_set_info match_set;
+};
+
+struct xt_set_info_target {
+	struct xt_set_info add_set;
+	struct xt_set_info del_set;
+};
+
+#endif /*_XT_SET_H*/
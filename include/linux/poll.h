@@ -25,6 +25,11 @@ extern struct ctl_table epoll_table[]; /* for sysctl */
 
 #define DEFAULT_POLLMASK (POLLIN | POLLOUT | POLLRDNORM | POLLWRNORM)
 
+/* Set in the poll_table key by select/poll to ask sockets to busy poll
+ * their NAPI context, and returned by sockets that can do so.
+ */
+#define POLL_BUSY_LOOP	0x8000
+
 struct poll_table_struct;
 
 /* 
@@ -39,7 +44,7 @@ typedef struct poll_table_struct {
 
 static inline void poll_wait(struct file * filp, wait_queue_head_t * wait_address, poll_table *p)
 {
-	if (p && wait_address)
+	if (p && p->qproc && wait_address)
 		p->qproc(filp, wait_address, p);
 }
 
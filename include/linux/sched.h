@@ -1143,6 +1143,8 @@ struct sched_class {
 	void (*enqueue_task) (struct rq *rq, struct task_struct *p, int flags);
 	void (*dequeue_task) (struct rq *rq, struct task_struct *p, int flags);
 	void (*yield_task) (struct rq *rq);
+	bool (*yield_to_task) (struct rq *rq, struct task_struct *p,
+			       bool preempt);
 	long (*wait_interval) (struct task_struct *p, struct timespec *rqtp,
 			       struct timespec __user *rmtp);
 
@@ -2156,6 +2158,7 @@ extern struct task_struct *curr_task(int cpu);
 extern void set_curr_task(int cpu, struct task_struct *p);
 
 void yield(void);
+bool yield_to(struct task_struct *p, bool preempt);
 
 /*
  * The default (Linux) execution domain.
@@ -181,6 +181,28 @@ enum {
 
 	/* ensure the originating sk reference is available on driver level */
 	SKBTX_DRV_NEEDS_SK_REF = 1 << 3,
+
+	/* frags are user space pages, destructor_arg is a struct ubuf_info */
+	SKBTX_DEV_ZEROCOPY = 1 << 4,
+};
+
+/*
+ * The callback notifies userspace to release buffers when skb DMA is done in
+ * lower device, the skb last reference should be 0 when calling this.
+ * The desc is used to track userspace buffer index.
+ *
+ * MSG_ZEROCOPY buffers (callback sock_zerocopy_callback) live in the cb of
+ * the notification skb and are shared by all skbs holding their pages:
+ * each of them owns a reference in refcnt, and id is the number of the
+ * send call reported to the socket error queue once the last one is gone.
+ */
+struct ubuf_info {
+	void (*callback)(void *);
+	void *arg;
+	unsigned long desc;
+	atomic_t refcnt;
+	u32 id;
+	u8 zerocopy;
 };
 
 /* This data is invariant across clones and lives at
@@ -203,7 +225,8 @@ struct skb_shared_info {
 	atomic_t	dataref;
 
 	/* Intermediate layers must ensure that destructor_arg
-	 * remains valid until skb destructor */
+	 * remains valid until skb destructor.  With SKBTX_DEV_ZEROCOPY
+	 * set it points to the struct ubuf_info of the user pages. */
 	void *		destructor_arg;
 	/* must be last field, see pskb_expand_head() */
 	skb_frag_t	frags[MAX_SKB_FRAGS];
@@ -305,6 +328,8 @@ typedef unsigned char *sk_buff_data_t;
  *	@tc_index: Traffic control index
  *	@tc_verd: traffic control verdict
  *	@ndisc_nodetype: router type (from link layer)
+ *	@head_frag: head is a page fragment, see build_skb()
+ *	@napi_id: id of the NAPI struct this skb came from
  *	@dma_cookie: a cookie to one of several possible DMA operations
  *		done by skb DMA functions
  *	@secmark: security marking
@@ -382,16 +407,21 @@ struct sk_buff {
 	__u16			queue_mapping:16;
 #ifdef CONFIG_IPV6_NDISC_NODETYPE
 	__u8			ndisc_nodetype:2,
-				deliver_no_wcard:1;
+				deliver_no_wcard:1,
+				head_frag:1;
 #else
-	__u8			deliver_no_wcard:1;
+	__u8			deliver_no_wcard:1,
+				head_frag:1;
 #endif
 	kmemcheck_bitfield_end(flags2);
 
-	/* 0/14 bit hole */
+	/* 0/13 bit hole */
 
-#ifdef CONFIG_NET_DMA
-	dma_cookie_t		dma_cookie;
+#if defined(CONFIG_NET_DMA) || defined(CONFIG_NET_RX_BUSY_POLL)
+	union {
+		unsigned int	napi_id;
+		dma_cookie_t	dma_cookie;
+	};
 #endif
 #ifdef CONFIG_NETWORK_SECMARK
 	__u32			secmark;
@@ -479,6 +509,7 @@ static inline struct rtable *skb_rtable(const struct sk_buff *skb)
 extern void kfree_skb(struct sk_buff *skb);
 extern void consume_skb(struct sk_buff *skb);
 extern void	       __kfree_skb(struct sk_buff *skb);
+extern struct sk_buff *build_skb(void *data, unsigned int frag_size);
 extern struct sk_buff *__alloc_skb(unsigned int size,
 				   gfp_t priority, int fclone, int node);
 static inline struct sk_buff *alloc_skb(unsigned int size,
@@ -1480,6 +1511,102 @@ static inline void skb_orphan(struct sk_buff *skb)
 	skb->sk		= NULL;
 }
 
+extern int skb_copy_ubufs(struct sk_buff *skb, gfp_t gfp_mask);
+
+extern struct ubuf_info *sock_zerocopy_alloc(struct sock *sk);
+extern void sock_zerocopy_callback(void *arg);
+extern void sock_zerocopy_put(struct ubuf_info *uarg);
+extern void sock_zerocopy_put_abort(struct ubuf_info *uarg);
+
+static inline struct ubuf_info *skb_zcopy_uarg(struct sk_buff *skb)
+{
+	return skb_shinfo(skb)->destructor_arg;
+}
+
+static inline bool skb_zcopy(struct sk_buff *skb)
+{
+	return skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY;
+}
+
+static inline bool skb_zcopy_refcounted(struct sk_buff *skb)
+{
+	return skb_zcopy(skb) &&
+	       skb_zcopy_uarg(skb)->callback == sock_zerocopy_callback;
+}
+
+/**
+ *	skb_zcopy_set - attach a MSG_ZEROCOPY buffer to an skb
+ *	@skb: buffer that is about to hold pages of @uarg
+ *	@uarg: refcounted ubuf from sock_zerocopy_alloc()
+ *
+ *	The caller must make sure @skb is not attached to another ubuf.
+ */
+static inline void skb_zcopy_set(struct sk_buff *skb, struct ubuf_info *uarg)
+{
+	if (!skb_zcopy(skb)) {
+		atomic_inc(&uarg->refcnt);
+		skb_shinfo(skb)->destructor_arg = uarg;
+		skb_shinfo(skb)->tx_flags |= SKBTX_DEV_ZEROCOPY;
+	}
+}
+
+/**
+ *	skb_zerocopy_clone - share the ubuf of an skb with a new one
+ *	@nskb: buffer that got (some of) the frags of @orig
+ *	@orig: original buffer
+ *
+ *	Only refcounted ubufs are left in place by skb_orphan_frags(), so
+ *	this is a no-op unless @orig holds MSG_ZEROCOPY pages.
+ */
+static inline void skb_zerocopy_clone(struct sk_buff *nskb,
+				      struct sk_buff *orig)
+{
+	if (skb_zcopy_refcounted(orig))
+		skb_zcopy_set(nskb, skb_zcopy_uarg(orig));
+}
+
+/**
+ *	skb_orphan_frags - orphan the frags contained in a buffer
+ *	@skb: buffer to orphan frags from
+ *	@gfp_mask: allocation mask for replacement pages
+ *
+ *	For each frag in the SKB which needs a destructor (i.e. has an
+ *	owner) create a copy of that frag and release the original
+ *	page by calling the destructor.  Needed before the buffer is
+ *	handed to a path that may hold on to it indefinitely.
+ */
+static inline int skb_orphan_frags(struct sk_buff *skb, gfp_t gfp_mask)
+{
+	if (likely(!(skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY)))
+		return 0;
+	/* refcounted ubufs stay valid for as long as any holder needs them */
+	if (skb_zcopy_refcounted(skb))
+		return 0;
+	return skb_copy_ubufs(skb, gfp_mask);
+}
+
+/**
+ *	skb_orphan_frags_rx - orphan the frags before local delivery
+ *	@skb: buffer to orphan frags from
+ *	@gfp_mask: allocation mask for replacement pages
+ *
+ *	Like skb_orphan_frags(), but MSG_ZEROCOPY pages are copied as well:
+ *	a local receiver may keep the buffer in a queue indefinitely, which
+ *	would hold the user pages and the completion notification with it.
+ *	A cloned buffer gets its own head first, so that the other holders
+ *	keep the user pages.
+ */
+static inline int skb_orphan_frags_rx(struct sk_buff *skb, gfp_t gfp_mask)
+{
+	if (likely(!(skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY)))
+		return 0;
+	if (skb_zcopy_refcounted(skb) && skb_cloned(skb)) {
+		if (skb_shared(skb) || pskb_expand_head(skb, 0, 0, gfp_mask))
+			return -EINVAL;
+	}
+	return skb_copy_ubufs(skb, gfp_mask);
+}
+
 /**
  *	__skb_queue_purge - empty a list
  *	@list: list to empty
@@ -1519,6 +1646,8 @@ static inline struct sk_buff *__dev_alloc_skb(unsigned int length,
 
 extern struct sk_buff *dev_alloc_skb(unsigned int length);
 
+extern void *netdev_alloc_frag(unsigned int fragsz);
+
 extern struct sk_buff *__netdev_alloc_skb(struct net_device *dev,
 		unsigned int length, gfp_t gfp_mask);
 
@@ -26,6 +26,12 @@
 
 struct rpc_inode;
 
+/*
+ * Maximum number of transports a single client may spread its
+ * requests over (see rpc_create_args.nconnect).
+ */
+#define RPC_MAX_XPRTS		16
+
 /*
  * The high-level client handle
  */
@@ -35,6 +41,9 @@ struct rpc_clnt {
 	struct list_head	cl_tasks;	/* List of tasks */
 	spinlock_t		cl_lock;	/* spinlock */
 	struct rpc_xprt *	cl_xprt;	/* transport */
+	struct rpc_xprt *	cl_xprts[RPC_MAX_XPRTS]; /* all transports */
+	unsigned int		cl_nr_xprts;	/* entries in cl_xprts */
+	atomic_t		cl_xprt_rr;	/* round-robin cursor */
 	struct rpc_procinfo *	cl_procinfo;	/* procedure info */
 	u32			cl_prog,	/* RPC program number */
 				cl_vers,	/* RPC version number */
@@ -116,6 +125,7 @@ struct rpc_create_args {
 	unsigned long		flags;
 	char			*client_name;
 	struct svc_xprt		*bc_xprt;	/* NFSv4.1 backchannel */
+	unsigned int		nconnect;	/* number of transports */
 };
 
 /* Values for "flags" field */
@@ -10,6 +10,7 @@ extern void unix_inflight(struct file *fp);
 extern void unix_notinflight(struct file *fp);
 extern void unix_gc(void);
 extern void wait_for_unix_gc(void);
+extern void unix_gc_flush(void);
 
 #define UNIX_HASH_SIZE	256
 
@@ -48,6 +49,7 @@ struct unix_sock {
 	struct unix_address     *addr;
 	struct dentry		*dentry;
 	struct vfsmount		*mnt;
+	struct inode		*inode;	/* of dentry, for RCU lookups */
 	struct mutex		readlock;
 	struct sock		*peer;
 	struct sock		*other;
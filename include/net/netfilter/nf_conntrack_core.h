@@ -74,6 +74,18 @@ print_tuple(struct seq_file *s, const struct nf_conntrack_tuple *tuple,
             const struct nf_conntrack_l3proto *l3proto,
             const struct nf_conntrack_l4proto *proto);
 
-extern spinlock_t nf_conntrack_lock ;
+/* The conntrack hash is protected by an array of spinlocks, bucket i
+ * being covered by nf_conntrack_locks[i % CONNTRACK_LOCKS].  Take them
+ * through nf_conntrack_lock(), never with spin_lock() directly, so that
+ * a hash resize can exclude every bucket at once.  Expectations and
+ * helper data are protected by nf_conntrack_expect_lock, which nests
+ * inside the bucket locks.
+ */
+#define CONNTRACK_LOCKS 1024
+
+extern spinlock_t nf_conntrack_locks[CONNTRACK_LOCKS];
+extern void nf_conntrack_lock(spinlock_t *lock);
+
+extern spinlock_t nf_conntrack_expect_lock;
 
 #endif /* _NF_CONNTRACK_CORE_H */
@@ -0,0 +1,126 @@
+#ifndef _NET_NF_TABLES_H
+#define _NET_NF_TABLES_H
+
+#include <linux/list.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+#include <linux/rcupdate.h>
+#include <linux/skbuff.h>
+
+/* Per packet state, filled in once by the address family hook */
+struct nft_pktinfo {
+	struct sk_buff			*skb;
+	const struct net_device		*in;
+	const struct net_device		*out;
+	u8				hooknum;
+	u8				family;
+	u8				l4proto;
+	int				thoff;	/* < 0: no transport header */
+};
+
+static inline void nft_set_pktinfo(struct nft_pktinfo *pkt,
+				   unsigned int hooknum, u8 family,
+				   struct sk_buff *skb,
+				   const struct net_device *in,
+				   const struct net_device *out)
+{
+	pkt->skb = skb;
+	pkt->in = in;
+	pkt->out = out;
+	pkt->hooknum = hooknum;
+	pkt->family = family;
+	pkt->l4proto = 0;
+	pkt->thoff = -1;
+}
+
+/**
+ *	struct nft_af_info - nf_tables address family
+ *
+ *	@list: used internally
+ *	@family: NFPROTO_* family
+ *	@hooks: bitmask of the NF_INET_* hooks base chains may attach to
+ *	@hook: hook function, builds an nft_pktinfo and calls nft_do_chain_pkt
+ *	@owner: module owner
+ *	@ops: used internally, one per hook
+ *	@hook_use: used internally, number of rulesets using each hook
+ */
+struct nft_af_info {
+	struct list_head		list;
+	u8				family;
+	unsigned int			hooks;
+	nf_hookfn			*hook;
+	struct module			*owner;
+
+	struct nf_hook_ops		ops[NF_INET_NUMHOOKS];
+	unsigned int			hook_use[NF_INET_NUMHOOKS];
+};
+
+extern int nft_register_afinfo(struct nft_af_info *afi);
+extern void nft_unregister_afinfo(struct nft_af_info *afi);
+
+extern unsigned int nft_do_chain_pkt(const struct nft_pktinfo *pkt);
+
+#define MODULE_ALIAS_NFT_FAMILY(family)	\
+	MODULE_ALIAS("nft-afinfo-" __stringify(family))
+
+/*
+ * Compiled ruleset, private to nf_tables.
+ */
+
+#define NFT_REG_WORDS	(NFT_REG_SIZE / sizeof(u32))
+
+/* First instruction of every rule; not visible to userspace */
+#define NFT_OP_RULE	(NFT_EXPR_MAX + 1)
+
+struct nft_set {
+	unsigned int			klen;
+	unsigned int			nelems;
+	u8				*elems;	/* sorted, nelems * klen */
+};
+
+struct nft_insn {
+	u8				op;
+	u8				sreg;
+	u8				dreg;
+	u8				len;
+	u8				cmp_op;
+	union {
+		struct {
+			u8		base;
+			u16		offset;
+		} payload;
+		u32			key;	/* meta */
+		u32			next;	/* NFT_OP_RULE */
+		const struct nft_set	*set;	/* lookup */
+		struct {
+			int		code;
+			u32		chain;
+		} verdict;
+	} u;
+	u32				data[NFT_REG_WORDS];
+	u32				xor[NFT_REG_WORDS];
+};
+
+struct nft_chain {
+	struct nft_insn			*insns;
+	unsigned int			ninsns;
+	int				hook;	/* < 0: not a base chain */
+	unsigned int			policy;
+};
+
+struct nft_ruleset {
+	struct nft_af_info		*afi;
+	u32				generation;
+	unsigned int			nrules;
+	unsigned int			nchains;
+	struct nft_chain		*chains;
+	unsigned int			nsets;
+	struct nft_set			*sets;
+	struct nft_chain		*base[NF_INET_NUMHOOKS];
+};
+
+extern unsigned int nft_do_chain(const struct nft_ruleset *rs,
+				 const struct nft_chain *chain,
+				 const struct nft_pktinfo *pkt);
+
+#endif /* _NET_NF_TABLES_H */
@@ -75,6 +75,9 @@ extern void tcp_time_wait(struct sock *sk, int state, int timeo);
 /* Maximal number of ACKs sent quickly to accelerate slow-start. */
 #define TCP_MAX_QUICKACKS	16U
 
+/* Smaller MSG_ZEROCOPY sends are copied, pinning pages costs more. */
+#define TCP_ZEROCOPY_COPYBREAK	16384
+
 /* urg_data states */
 #define TCP_URG_VALID	0x0100
 #define TCP_URG_NOTYET	0x0200
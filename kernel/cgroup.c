@@ -2863,6 +2863,49 @@ err:
 	return ret;
 }
 
+/**
+ * cgroupstats_has_task - check whether a task belongs to a cgroup
+ * @dentry: A dentry entry belonging to the cgroup to check
+ * @tsk: the task in question
+ *
+ * Used by the taskstats dump to restrict its output to the tasks of
+ * one cgroup. Returns 1 if @tsk is attached to the cgroup itself (not
+ * one of its descendants), 0 if it is not, and -EINVAL if @dentry is
+ * not a cgroup directory.
+ */
+int cgroupstats_has_task(struct dentry *dentry, struct task_struct *tsk)
+{
+	struct cgroup *cgrp;
+	struct css_set *css;
+	struct cg_cgroup_link *link;
+	int ret = 0;
+
+	if (dentry->d_sb->s_op != &cgroup_ops ||
+	    !S_ISDIR(dentry->d_inode->i_mode))
+		return -EINVAL;
+
+	cgrp = dentry->d_fsdata;
+
+	/*
+	 * Holding css_set_lock keeps the css_set alive even if the task
+	 * is moved to another cgroup under us.
+	 */
+	read_lock(&css_set_lock);
+	css = tsk->cgroups;
+	if (css == &init_css_set) {
+		ret = (cgrp == &cgrp->root->top_cgroup);
+	} else {
+		list_for_each_entry(link, &css->cg_links, cg_link_list) {
+			if (link->cgrp == cgrp) {
+				ret = 1;
+				break;
+			}
+		}
+	}
+	read_unlock(&css_set_lock);
+	return ret;
+}
+
 
 /*
  * seq_file methods for the tasks/procs files. The seq_file position is the
@@ -791,6 +791,9 @@ static void __clear_buddies(struct cfs_rq *cfs_rq, struct sched_entity *se)
 
 	if (!se || cfs_rq->next == se)
 		cfs_rq->next = NULL;
+
+	if (!se || cfs_rq->skip == se)
+		cfs_rq->skip = NULL;
 }
 
 static void clear_buddies(struct cfs_rq *cfs_rq, struct sched_entity *se)
@@ -915,8 +918,21 @@ static struct sched_entity *pick_next_entity(struct cfs_rq *cfs_rq)
 	struct sched_entity *se = __pick_next_entity(cfs_rq);
 	struct sched_entity *left = se;
 
-	if (cfs_rq->next && wakeup_preempt_entity(cfs_rq->next, left) < 1)
-		se = cfs_rq->next;
+	/*
+	 * Avoid running the skip buddy, if running something else can
+	 * be done without getting too unfair.
+	 */
+	if (cfs_rq->skip == se) {
+		struct rb_node *second = rb_next(&se->run_node);
+
+		if (second) {
+			struct sched_entity *s = rb_entry(second,
+					struct sched_entity, run_node);
+
+			if (wakeup_preempt_entity(s, left) < 1)
+				se = s;
+		}
+	}
 
 	/*
 	 * Prefer last buddy, try to return the CPU to a preempted task.
@@ -924,6 +940,12 @@ static struct sched_entity *pick_next_entity(struct cfs_rq *cfs_rq)
 	if (cfs_rq->last && wakeup_preempt_entity(cfs_rq->last, left) < 1)
 		se = cfs_rq->last;
 
+	/*
+	 * Someone really wants this to run. If it's not unfair, run it.
+	 */
+	if (cfs_rq->next && wakeup_preempt_entity(cfs_rq->next, left) < 1)
+		se = cfs_rq->next;
+
 	clear_buddies(cfs_rq, se);
 
 	return se;
@@ -1644,6 +1666,42 @@ static void set_next_buddy(struct sched_entity *se)
 	}
 }
 
+static void set_skip_buddy(struct sched_entity *se)
+{
+	if (likely(task_of(se)->policy != SCHED_IDLE)) {
+		for_each_sched_entity(se)
+			cfs_rq_of(se)->skip = se;
+	}
+}
+
+/*
+ * Directed yield: run p next, if that is not too unfair, and do not
+ * pick the yielding task again before something else ran.
+ */
+static bool yield_to_task_fair(struct rq *rq, struct task_struct *p,
+			       bool preempt)
+{
+	struct sched_entity *se = &p->se;
+
+	if (!se->on_rq)
+		return false;
+
+	/* Tell the scheduler that we'd really like pse to run next. */
+	set_next_buddy(se);
+
+	yield_task_fair(rq);
+
+	/*
+	 * Make sure the yielding task is not picked right back.  This must
+	 * follow yield_task_fair(), whose clear_buddies() resets the skip
+	 * buddy of the current task.
+	 */
+	if (rq->cfs.nr_running > 1)
+		set_skip_buddy(&rq->curr->se);
+
+	return true;
+}
+
 /*
  * Preempt the current task with a newly woken task if needed:
  */
@@ -3915,6 +3973,7 @@ static const struct sched_class fair_sched_class = {
 	.enqueue_task		= enqueue_task_fair,
 	.dequeue_task		= dequeue_task_fair,
 	.yield_task		= yield_task_fair,
+	.yield_to_task		= yield_to_task_fair,
 
 	.check_preempt_curr	= check_preempt_wakeup,
 
@@ -27,6 +27,7 @@
 #include <linux/cgroup.h>
 #include <linux/fs.h>
 #include <linux/file.h>
+#include <linux/pid_namespace.h>
 #include <net/genetlink.h>
 #include <asm/atomic.h>
 
@@ -36,6 +37,11 @@
  */
 #define TASKSTATS_CPUMASK_MAXLEN	(100+6*NR_CPUS)
 
+/*
+ * Number of tasks looked up per RCU read-side section while dumping
+ */
+#define TASKSTATS_DUMP_BATCH		32
+
 static DEFINE_PER_CPU(__u32, taskstats_seqnum);
 static int family_registered;
 struct kmem_cache *taskstats_cache;
@@ -51,7 +57,8 @@ static const struct nla_policy taskstats_cmd_get_policy[TASKSTATS_CMD_ATTR_MAX+1
 	[TASKSTATS_CMD_ATTR_PID]  = { .type = NLA_U32 },
 	[TASKSTATS_CMD_ATTR_TGID] = { .type = NLA_U32 },
 	[TASKSTATS_CMD_ATTR_REGISTER_CPUMASK] = { .type = NLA_STRING },
-	[TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK] = { .type = NLA_STRING },};
+	[TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK] = { .type = NLA_STRING },
+	[TASKSTATS_CMD_ATTR_CGROUP_FD] = { .type = NLA_U32 },};
 
 static const struct nla_policy cgroupstats_cmd_get_policy[CGROUPSTATS_CMD_ATTR_MAX+1] = {
 	[CGROUPSTATS_CMD_ATTR_FD] = { .type = NLA_U32 },
@@ -530,6 +537,113 @@ static int taskstats_user_cmd(struct sk_buff *skb, struct genl_info *info)
 		return -EINVAL;
 }
 
+static int taskstats_dump_one(struct sk_buff *skb, struct netlink_callback *cb,
+			      struct task_struct *tsk, pid_t pid)
+{
+	struct taskstats *stats;
+	void *reply;
+
+	reply = genlmsg_put(skb, NETLINK_CB(cb->skb).pid, cb->nlh->nlmsg_seq,
+			    &family, NLM_F_MULTI, TASKSTATS_CMD_NEW);
+	if (!reply)
+		return -EMSGSIZE;
+
+	stats = mk_reply(skb, TASKSTATS_TYPE_PID, pid);
+	if (!stats) {
+		genlmsg_cancel(skb, reply);
+		return -EMSGSIZE;
+	}
+
+	fill_stats(tsk, stats);
+	return genlmsg_end(skb, reply);
+}
+
+/*
+ * TASKSTATS_CMD_GET with NLM_F_DUMP: stream the per-pid stats of every
+ * task in the caller's pid namespace, or only of the tasks attached to
+ * the cgroup given by TASKSTATS_CMD_ATTR_CGROUP_FD.
+ *
+ * Tasks are walked in pid order so the dump can resume from cb->args[0]
+ * (the next pid to look at) when the skb fills up. They are looked up
+ * in batches under rcu_read_lock(), pinned, and filled in afterwards
+ * because collecting the extended accounting fields may sleep.
+ */
+static int taskstats_user_dump(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	struct nlattr *attrs[TASKSTATS_CMD_ATTR_MAX + 1];
+	struct pid_namespace *ns = task_active_pid_ns(current);
+	struct task_struct *tasks[TASKSTATS_DUMP_BATCH];
+	pid_t pids[TASKSTATS_DUMP_BATCH];
+	struct file *file = NULL;
+	int fput_needed = 0;
+	pid_t nr = cb->args[0];
+	int i, n, rc, full = 0;
+
+	rc = nlmsg_parse(cb->nlh, GENL_HDRLEN + family.hdrsize, attrs,
+			 TASKSTATS_CMD_ATTR_MAX, taskstats_cmd_get_policy);
+	if (rc < 0)
+		return rc;
+
+	if (attrs[TASKSTATS_CMD_ATTR_CGROUP_FD]) {
+		file = fget_light(nla_get_u32(attrs[TASKSTATS_CMD_ATTR_CGROUP_FD]),
+				  &fput_needed);
+		if (!file)
+			return -EBADF;
+	}
+
+	while (!full) {
+		n = 0;
+		rcu_read_lock();
+		while (n < TASKSTATS_DUMP_BATCH) {
+			struct task_struct *tsk;
+			struct pid *pid;
+
+			pid = find_ge_pid(nr, ns);
+			if (!pid)
+				break;
+			nr = pid_nr_ns(pid, ns) + 1;
+
+			tsk = pid_task(pid, PIDTYPE_PID);
+			if (!tsk)
+				continue;
+			if (file) {
+				rc = cgroupstats_has_task(file->f_dentry, tsk);
+				if (rc < 0) {
+					rcu_read_unlock();
+					goto out;
+				}
+				if (!rc)
+					continue;
+			}
+
+			get_task_struct(tsk);
+			pids[n] = nr - 1;
+			tasks[n++] = tsk;
+		}
+		rcu_read_unlock();
+
+		if (!n)
+			break;
+
+		for (i = 0; i < n; i++) {
+			if (!full && taskstats_dump_one(skb, cb, tasks[i],
+							pids[i]) < 0) {
+				/* resume from this task on the next call */
+				cb->args[0] = pids[i];
+				full = 1;
+			}
+			put_task_struct(tasks[i]);
+		}
+		if (!full)
+			cb->args[0] = nr;
+	}
+	rc = skb->len;
+out:
+	if (file)
+		fput_light(file, fput_needed);
+	return rc;
+}
+
 static struct taskstats *taskstats_tgid_alloc(struct task_struct *tsk)
 {
 	struct signal_struct *sig = tsk->signal;
@@ -617,6 +731,7 @@ err:
 static struct genl_ops taskstats_ops = {
 	.cmd		= TASKSTATS_CMD_GET,
 	.doit		= taskstats_user_cmd,
+	.dumpit		= taskstats_user_dump,
 	.policy		= taskstats_cmd_get_policy,
 };
 
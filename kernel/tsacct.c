@@ -93,6 +93,8 @@ void xacct_add_tsk(struct taskstats *stats, struct task_struct *p)
 		/* adjust to KB unit */
 		stats->hiwater_rss   = get_mm_hiwater_rss(mm) * PAGE_SIZE / KB;
 		stats->hiwater_vm    = get_mm_hiwater_vm(mm)  * PAGE_SIZE / KB;
+		stats->rss	     = get_mm_rss(mm) * PAGE_SIZE / KB;
+		stats->vm	     = mm->total_vm * PAGE_SIZE / KB;
 		mmput(mm);
 	}
 	stats->read_char	= p->ioac.rchar;
@@ -165,6 +165,7 @@ int __get_user_pages(struct task_struct *tsk, struct mm_struct *mm,
 finish_or_fault:
 	return i ? : -EFAULT;
 }
+EXPORT_SYMBOL(__get_user_pages);
 
 /*
  * get a list of pages in an address range belonging to the specified process
@@ -132,6 +132,7 @@
 #include <trace/events/skb.h>
 #include <linux/pci.h>
 #include <linux/inetdevice.h>
+#include <net/busy_poll.h>
 
 #include "net-sysfs.h"
 
@@ -1482,6 +1483,13 @@ static inline void net_timestamp_check(struct sk_buff *skb)
  */
 int dev_forward_skb(struct net_device *dev, struct sk_buff *skb)
 {
+	/* a local receiver may hold on to the user pages indefinitely */
+	if (skb_orphan_frags_rx(skb, GFP_ATOMIC)) {
+		atomic_long_inc(&dev->rx_dropped);
+		kfree_skb(skb);
+		return NET_RX_DROP;
+	}
+
 	skb_orphan(skb);
 	nf_reset(skb);
 
@@ -1545,6 +1553,12 @@ static void dev_queue_xmit_nit(struct sk_buff *skb, struct net_device *dev)
 
 			skb2->transport_header = skb2->network_header;
 			skb2->pkt_type = PACKET_OUTGOING;
+
+			/* taps may queue the clone for as long as they like */
+			if (unlikely(skb_orphan_frags_rx(skb2, GFP_ATOMIC))) {
+				kfree_skb(skb2);
+				break;
+			}
 			ptype->func(skb2, skb->dev, ptype, skb->dev);
 		}
 	}
@@ -2716,6 +2730,8 @@ static inline int deliver_skb(struct sk_buff *skb,
 			      struct packet_type *pt_prev,
 			      struct net_device *orig_dev)
 {
+	if (unlikely(skb_orphan_frags_rx(skb, GFP_ATOMIC)))
+		return -ENOMEM;
 	atomic_inc(&skb->users);
 	return pt_prev->func(skb, skb->dev, pt_prev, orig_dev);
 }
@@ -2887,8 +2903,18 @@ int __skb_bond_should_drop(struct sk_buff *skb, struct net_device *master)
 }
 EXPORT_SYMBOL(__skb_bond_should_drop);
 
-static int __netif_receive_skb(struct sk_buff *skb)
+/*
+ * Run everything up to the last matching packet handler, which is
+ * returned in *ppt_prev together with the skb and the orig_dev it has to
+ * be passed.  Handlers before the last one have already been given their
+ * own reference.  *ppt_prev is left NULL if the skb was consumed.
+ * Called under rcu_read_lock(), which protects *ppt_prev.
+ */
+static int __netif_receive_skb_core(struct sk_buff **pskb,
+				    struct packet_type **ppt_prev,
+				    struct net_device **porig_dev)
 {
+	struct sk_buff *skb = *pskb;
 	struct packet_type *ptype, *pt_prev;
 	rx_handler_func_t *rx_handler;
 	struct net_device *orig_dev;
@@ -2937,8 +2963,6 @@ static int __netif_receive_skb(struct sk_buff *skb)
 
 	pt_prev = NULL;
 
-	rcu_read_lock();
-
 #ifdef CONFIG_NET_CLS_ACT
 	if (skb->tc_verd & TC_NCLS) {
 		skb->tc_verd = CLR_TC_NCLS(skb->tc_verd);
@@ -2980,8 +3004,9 @@ ncls:
 			pt_prev = NULL;
 		}
 		if (vlan_hwaccel_do_receive(&skb)) {
-			ret = __netif_receive_skb(skb);
-			goto out;
+			*pskb = skb;
+			return __netif_receive_skb_core(pskb, ppt_prev,
+							porig_dev);
 		} else if (unlikely(!skb))
 			goto out;
 	}
@@ -3011,8 +3036,13 @@ ncls:
 	}
 
 	if (pt_prev) {
-		ret = pt_prev->func(skb, skb->dev, pt_prev, orig_dev);
+		if (unlikely(skb_orphan_frags_rx(skb, GFP_ATOMIC)))
+			goto drop;
+		*pskb = skb;
+		*ppt_prev = pt_prev;
+		*porig_dev = orig_dev;
 	} else {
+drop:
 		atomic_long_inc(&skb->dev->rx_dropped);
 		kfree_skb(skb);
 		/* Jamal, now you will not able to escape explaining
@@ -3022,10 +3052,72 @@ ncls:
 	}
 
 out:
+	return ret;
+}
+
+static int __netif_receive_skb(struct sk_buff *skb)
+{
+	struct packet_type *pt_prev = NULL;
+	struct net_device *orig_dev;
+	int ret;
+
+	rcu_read_lock();
+	ret = __netif_receive_skb_core(&skb, &pt_prev, &orig_dev);
+	if (pt_prev)
+		ret = pt_prev->func(skb, skb->dev, pt_prev, orig_dev);
 	rcu_read_unlock();
 	return ret;
 }
 
+static void __netif_receive_skb_list_ptype(struct sk_buff_head *list,
+					   struct packet_type *pt_prev,
+					   struct net_device *orig_dev)
+{
+	struct sk_buff *skb;
+
+	if (pt_prev->list_func) {
+		pt_prev->list_func(list, pt_prev, orig_dev);
+		return;
+	}
+	while ((skb = __skb_dequeue(list)) != NULL)
+		pt_prev->func(skb, skb->dev, pt_prev, orig_dev);
+}
+
+/*
+ * Consecutive skbs that end up at the same packet handler with the same
+ * orig_dev are handed to it as one sublist; the order of the skbs is
+ * kept.  Taps, ingress classification and rx_handlers still see one skb
+ * at a time.
+ */
+static void __netif_receive_skb_list(struct sk_buff_head *list)
+{
+	struct packet_type *pt_curr = NULL, *pt_prev;
+	struct net_device *od_curr = NULL, *orig_dev;
+	struct sk_buff_head sublist;
+	struct sk_buff *skb;
+
+	__skb_queue_head_init(&sublist);
+
+	rcu_read_lock();
+	while ((skb = __skb_dequeue(list)) != NULL) {
+		pt_prev = NULL;
+		__netif_receive_skb_core(&skb, &pt_prev, &orig_dev);
+		if (!pt_prev)
+			continue;
+		if (pt_curr != pt_prev || od_curr != orig_dev) {
+			if (!skb_queue_empty(&sublist))
+				__netif_receive_skb_list_ptype(&sublist,
+							       pt_curr, od_curr);
+			pt_curr = pt_prev;
+			od_curr = orig_dev;
+		}
+		__skb_queue_tail(&sublist, skb);
+	}
+	if (!skb_queue_empty(&sublist))
+		__netif_receive_skb_list_ptype(&sublist, pt_curr, od_curr);
+	rcu_read_unlock();
+}
+
 /**
  *	netif_receive_skb - process receive buffer from network
  *	@skb: buffer to process
@@ -3074,6 +3166,56 @@ int netif_receive_skb(struct sk_buff *skb)
 }
 EXPORT_SYMBOL(netif_receive_skb);
 
+/**
+ *	netif_receive_skb_list - process many receive buffers from network
+ *	@list: list of skbs to process, empty on return
+ *
+ *	Like netif_receive_skb() for each skb on @list, but protocol handlers
+ *	that provide a list_func get whole runs of consecutive skbs at once,
+ *	which lets them share per-packet work such as hook and route lookups
+ *	and keeps their code hot in the instruction cache.  NAPI drivers
+ *	should collect the skbs of one poll into a private list and pass it
+ *	here before returning.
+ *
+ *	This function may only be called from softirq context and interrupts
+ *	should be enabled.
+ */
+void netif_receive_skb_list(struct sk_buff_head *list)
+{
+	struct sk_buff_head sublist;
+	struct sk_buff *skb;
+
+	__skb_queue_head_init(&sublist);
+
+	while ((skb = __skb_dequeue(list)) != NULL) {
+		if (netdev_tstamp_prequeue)
+			net_timestamp_check(skb);
+
+		if (skb_defer_rx_timestamp(skb))
+			continue;
+
+#ifdef CONFIG_RPS
+		{
+			struct rps_dev_flow voidflow, *rflow = &voidflow;
+			int cpu;
+
+			rcu_read_lock();
+			cpu = get_rps_cpu(skb->dev, skb, &rflow);
+			if (cpu >= 0) {
+				enqueue_to_backlog(skb, cpu, &rflow->last_qtail);
+				rcu_read_unlock();
+				continue;
+			}
+			rcu_read_unlock();
+		}
+#endif
+		__skb_queue_tail(&sublist, skb);
+	}
+
+	__netif_receive_skb_list(&sublist);
+}
+EXPORT_SYMBOL(netif_receive_skb_list);
+
 /* Network device is going away, flush any packets still pending
  * Called with irqs disabled.
  */
@@ -3300,6 +3442,7 @@ EXPORT_SYMBOL(skb_gro_reset_offset);
 
 gro_result_t napi_gro_receive(struct napi_struct *napi, struct sk_buff *skb)
 {
+	skb_mark_napi_id(skb, napi);
 	skb_gro_reset_offset(skb);
 
 	return napi_skb_finish(__napi_gro_receive(napi, skb), skb);
@@ -3399,6 +3542,7 @@ gro_result_t napi_gro_frags(struct napi_struct *napi)
 	if (!skb)
 		return GRO_DROP;
 
+	skb_mark_napi_id(skb, napi);
 	return napi_frags_finish(napi, skb, __napi_gro_receive(napi, skb));
 }
 EXPORT_SYMBOL(napi_gro_frags);
@@ -3509,7 +3653,15 @@ void __napi_complete(struct napi_struct *n)
 	BUG_ON(!test_bit(NAPI_STATE_SCHED, &n->state));
 	BUG_ON(n->gro_list);
 
-	list_del(&n->poll_list);
+	/*
+	 * A busy poller keeps the context until busy_poll_stop(), whichever
+	 * of napi_complete() and __napi_complete() the driver uses.
+	 */
+	if (unlikely(test_bit(NAPI_STATE_IN_BUSY_POLL, &n->state)))
+		return;
+
+	/* init: a busy poller runs ->poll() without listing the context */
+	list_del_init(&n->poll_list);
 	smp_mb__before_clear_bit();
 	clear_bit(NAPI_STATE_SCHED, &n->state);
 }
@@ -3527,12 +3679,189 @@ void napi_complete(struct napi_struct *n)
 		return;
 
 	napi_gro_flush(n);
+
 	local_irq_save(flags);
 	__napi_complete(n);
 	local_irq_restore(flags);
 }
 EXPORT_SYMBOL(napi_complete);
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+
+#define NAPI_HASH_SIZE		256
+#define BUSY_POLL_BUDGET	8
+
+/* NAPI contexts by napi_id, for sockets to find theirs */
+static struct hlist_head napi_hash[NAPI_HASH_SIZE];
+static DEFINE_SPINLOCK(napi_hash_lock);
+static unsigned int napi_gen_id;
+
+/* must be called under rcu_read_lock() or napi_hash_lock */
+static struct napi_struct *napi_by_id(unsigned int napi_id)
+{
+	struct napi_struct *napi;
+	struct hlist_node *node;
+
+	hlist_for_each_entry_rcu(napi, node, &napi_hash[napi_id % NAPI_HASH_SIZE],
+				 napi_hash_node)
+		if (napi->napi_id == napi_id)
+			return napi;
+
+	return NULL;
+}
+
+static void napi_hash_add(struct napi_struct *napi)
+{
+	if (test_and_set_bit(NAPI_STATE_HASHED, &napi->state))
+		return;
+
+	spin_lock(&napi_hash_lock);
+
+	/* 0 is "no context" for skbs and sockets */
+	do {
+		if (unlikely(++napi_gen_id == 0))
+			napi_gen_id = 1;
+	} while (napi_by_id(napi_gen_id));
+	napi->napi_id = napi_gen_id;
+
+	hlist_add_head_rcu(&napi->napi_hash_node,
+			   &napi_hash[napi->napi_id % NAPI_HASH_SIZE]);
+
+	spin_unlock(&napi_hash_lock);
+}
+
+/* The caller must wait for an RCU grace period before freeing @napi if
+ * this returns true.
+ */
+static bool napi_hash_del(struct napi_struct *napi)
+{
+	if (!test_and_clear_bit(NAPI_STATE_HASHED, &napi->state))
+		return false;
+
+	spin_lock(&napi_hash_lock);
+	hlist_del_rcu(&napi->napi_hash_node);
+	napi->napi_id = 0;
+	spin_unlock(&napi_hash_lock);
+	return true;
+}
+
+static void busy_poll_stop(struct napi_struct *napi, void *have_poll_lock)
+{
+	int rc;
+
+	clear_bit(NAPI_STATE_IN_BUSY_POLL, &napi->state);
+
+	local_bh_disable();
+
+	/* Nothing left to hand back if the context got completed anyway */
+	if (unlikely(!test_bit(NAPI_STATE_SCHED, &napi->state))) {
+		netpoll_poll_unlock(have_poll_lock);
+		local_bh_enable();
+		return;
+	}
+
+	/* The driver's napi completions were no-ops while we owned the
+	 * context.  Poll once more so that it completes for real and the
+	 * device interrupt gets re-armed, or hand the context over to the
+	 * softirq if there is still work.
+	 */
+	rc = napi->poll(napi, BUSY_POLL_BUDGET);
+	trace_napi_poll(napi);
+	netpoll_poll_unlock(have_poll_lock);
+	if (rc == BUSY_POLL_BUDGET)
+		__napi_schedule(napi);
+	local_bh_enable();
+}
+
+/**
+ *	napi_busy_loop - run a NAPI poll routine from process context
+ *	@napi_id: context to poll, as recorded in the socket
+ *	@loop_end: returns true once the caller has what it waits for or
+ *		   its time is up; NULL to poll only once
+ *	@loop_end_arg: argument for @loop_end
+ *
+ *	The context is taken over only if it is idle: if the softirq or
+ *	another busy poller already polls it, this just spins until
+ *	@loop_end says so.
+ */
+void napi_busy_loop(unsigned int napi_id,
+		    bool (*loop_end)(void *, unsigned long),
+		    void *loop_end_arg)
+{
+	unsigned long start_time = loop_end ? busy_loop_current_time() : 0;
+	void *have_poll_lock = NULL;
+	struct napi_struct *napi;
+	bool owned;
+
+restart:
+	owned = false;
+
+	rcu_read_lock();
+
+	napi = napi_by_id(napi_id);
+	if (!napi)
+		goto out;
+
+	preempt_disable();
+	for (;;) {
+		local_bh_disable();
+		if (!owned) {
+			unsigned long val = ACCESS_ONCE(napi->state);
+
+			/* avoid dirtying napi->state while others own it */
+			if (val & ((1UL << NAPI_STATE_DISABLE) |
+				   (1UL << NAPI_STATE_SCHED) |
+				   (1UL << NAPI_STATE_IN_BUSY_POLL)))
+				goto count;
+			if (cmpxchg(&napi->state, val,
+				    val | (1UL << NAPI_STATE_IN_BUSY_POLL) |
+					  (1UL << NAPI_STATE_SCHED)) != val)
+				goto count;
+			have_poll_lock = netpoll_poll_lock(napi);
+			owned = true;
+		}
+		napi->poll(napi, BUSY_POLL_BUDGET);
+		trace_napi_poll(napi);
+count:
+		local_bh_enable();
+
+		if (!loop_end || loop_end(loop_end_arg, start_time) ||
+		    napi_disable_pending(napi))
+			break;
+
+		if (unlikely(need_resched())) {
+			if (owned)
+				busy_poll_stop(napi, have_poll_lock);
+			preempt_enable();
+			rcu_read_unlock();
+			cond_resched();
+			if (loop_end(loop_end_arg, start_time))
+				return;
+			goto restart;
+		}
+		cpu_relax();
+	}
+	if (owned)
+		busy_poll_stop(napi, have_poll_lock);
+	preempt_enable();
+out:
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL(napi_busy_loop);
+
+#else /* CONFIG_NET_RX_BUSY_POLL */
+
+static inline void napi_hash_add(struct napi_struct *napi)
+{
+}
+
+static inline bool napi_hash_del(struct napi_struct *napi)
+{
+	return false;
+}
+
+#endif /* CONFIG_NET_RX_BUSY_POLL */
+
 void netif_napi_add(struct net_device *dev, struct napi_struct *napi,
 		    int (*poll)(struct napi_struct *, int), int weight)
 {
@@ -3549,6 +3878,7 @@ void netif_napi_add(struct net_device *dev, struct napi_struct *napi,
 	napi->poll_owner = -1;
 #endif
 	set_bit(NAPI_STATE_SCHED, &napi->state);
+	napi_hash_add(napi);
 }
 EXPORT_SYMBOL(netif_napi_add);
 
@@ -3556,6 +3886,11 @@ void netif_napi_del(struct napi_struct *napi)
 {
 	struct sk_buff *skb, *next;
 
+	might_sleep();
+	/* busy pollers may still look at it */
+	if (napi_hash_del(napi))
+		synchronize_net();
+
 	list_del_init(&napi->dev_list);
 	napi_free_frags(napi);
 
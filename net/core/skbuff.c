@@ -231,6 +231,141 @@ nodata:
 }
 EXPORT_SYMBOL(__alloc_skb);
 
+/**
+ *	build_skb - build a network buffer around already filled data
+ *	@data: data buffer provided by caller
+ *	@frag_size: size of the fragment @data was taken from, or 0 if
+ *		@data was allocated with kmalloc()
+ *
+ *	Allocate a new &sk_buff whose head is @data instead of a freshly
+ *	allocated buffer, so that a driver can let the NIC write a frame
+ *	into a buffer and hand that buffer to the stack without a copy.
+ *	The end of @data must leave room for a struct skb_shared_info,
+ *	SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) bytes of it.
+ *	A @frag_size that is not 0 means @data comes from
+ *	netdev_alloc_frag() and is released with put_page().
+ *
+ *	The returned skb has no headroom and no data: the caller reserves
+ *	and puts what the NIC wrote.  %NULL is returned if there is no
+ *	free memory, @data is then still owned by the caller.
+ */
+struct sk_buff *build_skb(void *data, unsigned int frag_size)
+{
+	struct skb_shared_info *shinfo;
+	struct sk_buff *skb;
+	unsigned int size = frag_size ? : ksize(data);
+
+	skb = kmem_cache_alloc(skbuff_head_cache, GFP_ATOMIC);
+	if (!skb)
+		return NULL;
+
+	size -= SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+
+	memset(skb, 0, offsetof(struct sk_buff, tail));
+	skb->truesize = size + sizeof(struct sk_buff);
+	skb->head_frag = frag_size != 0;
+	atomic_set(&skb->users, 1);
+	skb->head = data;
+	skb->data = data;
+	skb_reset_tail_pointer(skb);
+	skb->end = skb->tail + size;
+#ifdef NET_SKBUFF_DATA_USES_OFFSET
+	skb->mac_header = ~0U;
+#endif
+
+	/* make sure we initialize shinfo sequentially */
+	shinfo = skb_shinfo(skb);
+	memset(shinfo, 0, offsetof(struct skb_shared_info, dataref));
+	atomic_set(&shinfo->dataref, 1);
+
+	return skb;
+}
+EXPORT_SYMBOL(build_skb);
+
+/*
+ * Receive buffers are carved out of a per-cpu page of up to 32KB.  Every
+ * fragment holds a reference on the page, which is freed when the last
+ * skb using it is.  To avoid an atomic operation per fragment, the page
+ * count is raised once to a large bias when the page is allocated and
+ * the fragments handed out are subtracted from the bias instead.
+ */
+struct netdev_alloc_cache {
+	struct page	*page;
+	unsigned int	size;
+	unsigned int	offset;
+	unsigned int	pagecnt_bias;
+};
+static DEFINE_PER_CPU(struct netdev_alloc_cache, netdev_alloc_cache);
+
+#define NETDEV_FRAG_PAGE_MAX_ORDER	get_order(32768)
+#define NETDEV_FRAG_PAGE_MAX_SIZE	(PAGE_SIZE << NETDEV_FRAG_PAGE_MAX_ORDER)
+#define NETDEV_PAGECNT_MAX_BIAS		NETDEV_FRAG_PAGE_MAX_SIZE
+
+static void *__netdev_alloc_frag(unsigned int fragsz, gfp_t gfp_mask)
+{
+	struct netdev_alloc_cache *nc;
+	void *data = NULL;
+	unsigned long flags;
+	int order;
+
+	local_irq_save(flags);
+	nc = &__get_cpu_var(netdev_alloc_cache);
+	if (unlikely(!nc->page)) {
+refill:
+		/* fall back to a single page if higher orders are short */
+		for (order = NETDEV_FRAG_PAGE_MAX_ORDER; ; order--) {
+			gfp_t gfp = gfp_mask;
+
+			if (order)
+				gfp |= __GFP_COMP | __GFP_NOWARN | __GFP_NORETRY;
+			nc->page = alloc_pages(gfp, order);
+			if (likely(nc->page))
+				break;
+			if (order == 0)
+				goto end;
+		}
+		nc->size = PAGE_SIZE << order;
+recycle:
+		atomic_set(&nc->page->_count, NETDEV_PAGECNT_MAX_BIAS);
+		nc->pagecnt_bias = NETDEV_PAGECNT_MAX_BIAS;
+		nc->offset = 0;
+	}
+
+	if (nc->offset + fragsz > nc->size) {
+		/* All fragments released already: reuse the page as is */
+		if (atomic_read(&nc->page->_count) == nc->pagecnt_bias ||
+		    atomic_sub_and_test(nc->pagecnt_bias, &nc->page->_count))
+			goto recycle;
+		goto refill;
+	}
+
+	data = page_address(nc->page) + nc->offset;
+	nc->offset += fragsz;
+	nc->pagecnt_bias--;
+end:
+	local_irq_restore(flags);
+	return data;
+}
+
+/**
+ *	netdev_alloc_frag - allocate a page fragment for a receive buffer
+ *	@fragsz: fragment size, at most PAGE_SIZE
+ *
+ *	Allocate @fragsz bytes out of a per-cpu page, to be filled by the
+ *	NIC and turned into an skb with build_skb(@data, @fragsz).  The
+ *	fragment is released with put_page(virt_to_head_page(@data)).
+ *
+ *	%NULL is returned if there is no free memory.  Can be called from
+ *	any context.
+ */
+void *netdev_alloc_frag(unsigned int fragsz)
+{
+	if (WARN_ON_ONCE(fragsz > PAGE_SIZE))
+		return NULL;
+	return __netdev_alloc_frag(fragsz, GFP_ATOMIC | __GFP_COLD);
+}
+EXPORT_SYMBOL(netdev_alloc_frag);
+
 /**
  *	__netdev_alloc_skb - allocate an skbuff for rx on a specific device
  *	@dev: network device to receive on
@@ -316,6 +451,14 @@ static void skb_clone_fraglist(struct sk_buff *skb)
 		skb_get(list);
 }
 
+static void skb_free_head(struct sk_buff *skb)
+{
+	if (skb->head_frag)
+		put_page(virt_to_head_page(skb->head));
+	else
+		kfree(skb->head);
+}
+
 static void skb_release_data(struct sk_buff *skb)
 {
 	if (!skb->cloned ||
@@ -327,10 +470,22 @@ static void skb_release_data(struct sk_buff *skb)
 				put_page(skb_shinfo(skb)->frags[i].page);
 		}
 
+		/*
+		 * If skb buf is from userspace, we need to notify the caller
+		 * the lower device DMA has done;
+		 */
+		if (skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY) {
+			struct ubuf_info *uarg;
+
+			uarg = skb_shinfo(skb)->destructor_arg;
+			if (uarg->callback)
+				uarg->callback(uarg);
+		}
+
 		if (skb_has_frag_list(skb))
 			skb_drop_fraglist(skb);
 
-		kfree(skb->head);
+		skb_free_head(skb);
 	}
 }
 
@@ -477,7 +632,8 @@ bool skb_recycle_check(struct sk_buff *skb, int skb_size)
 	if (irqs_disabled())
 		return false;
 
-	if (skb_is_nonlinear(skb) || skb->fclone != SKB_FCLONE_UNAVAILABLE)
+	if (skb_is_nonlinear(skb) || skb->fclone != SKB_FCLONE_UNAVAILABLE ||
+	    skb->head_frag)
 		return false;
 
 	skb_size = SKB_DATA_ALIGN(skb_size + NET_SKB_PAD);
@@ -539,6 +695,9 @@ static void __copy_skb_header(struct sk_buff *new, const struct sk_buff *old)
 #endif
 #endif
 	new->vlan_tci		= old->vlan_tci;
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	new->napi_id		= old->napi_id;
+#endif
 
 	skb_copy_secmark(new, old);
 }
@@ -565,6 +724,7 @@ static struct sk_buff *__skb_clone(struct sk_buff *n, struct sk_buff *skb)
 	C(tail);
 	C(end);
 	C(head);
+	C(head_frag);
 	C(data);
 	C(truesize);
 	atomic_set(&n->users, 1);
@@ -607,10 +767,77 @@ EXPORT_SYMBOL_GPL(skb_morph);
  *	%GFP_ATOMIC.
  */
 
+/**
+ *	skb_copy_ubufs	-	copy userspace skb frags buffers to kernel
+ *	@skb: the skb to modify
+ *	@gfp_mask: allocation priority
+ *
+ *	This must be called on SKBTX_DEV_ZEROCOPY skb.
+ *	It will copy all frags into kernel and drop the reference
+ *	to userspace pages.
+ *
+ *	If this function is called from an interrupt gfp_mask() must be
+ *	%GFP_ATOMIC.
+ *
+ *	Returns 0 on success or a negative error code on failure
+ *	to allocate kernel memory to copy to.
+ */
+int skb_copy_ubufs(struct sk_buff *skb, gfp_t gfp_mask)
+{
+	int i;
+	int num_frags = skb_shinfo(skb)->nr_frags;
+	struct page *page, *head = NULL;
+	struct ubuf_info *uarg = skb_shinfo(skb)->destructor_arg;
+
+	for (i = 0; i < num_frags; i++) {
+		u8 *vaddr;
+		skb_frag_t *f = &skb_shinfo(skb)->frags[i];
+
+		page = alloc_page(gfp_mask);
+		if (!page) {
+			while (head) {
+				struct page *next = (struct page *)head->private;
+				put_page(head);
+				head = next;
+			}
+			return -ENOMEM;
+		}
+		vaddr = kmap_skb_frag(f);
+		memcpy(page_address(page), vaddr + f->page_offset, f->size);
+		kunmap_skb_frag(vaddr);
+		page->private = (unsigned long)head;
+		head = page;
+	}
+
+	/* skb frags release userspace buffers */
+	for (i = 0; i < num_frags; i++)
+		put_page(skb_shinfo(skb)->frags[i].page);
+
+	/* report the send as copied, see sock_zerocopy_callback() */
+	if (skb_zcopy_refcounted(skb))
+		uarg->zerocopy = 0;
+	uarg->callback(uarg);
+
+	/* skb frags point to kernel buffers */
+	for (i = num_frags - 1; i >= 0; i--) {
+		skb_shinfo(skb)->frags[i].page_offset = 0;
+		skb_shinfo(skb)->frags[i].page = head;
+		head = (struct page *)head->private;
+	}
+
+	skb_shinfo(skb)->tx_flags &= ~SKBTX_DEV_ZEROCOPY;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(skb_copy_ubufs);
+
 struct sk_buff *skb_clone(struct sk_buff *skb, gfp_t gfp_mask)
 {
 	struct sk_buff *n;
 
+	/* clones share the frags, which must not outlive the ubuf */
+	if (skb_orphan_frags(skb, gfp_mask))
+		return NULL;
+
 	n = skb + 1;
 	if (skb->fclone == SKB_FCLONE_ORIG &&
 	    n->fclone == SKB_FCLONE_UNAVAILABLE) {
@@ -709,8 +936,12 @@ EXPORT_SYMBOL(skb_copy);
 struct sk_buff *pskb_copy(struct sk_buff *skb, gfp_t gfp_mask)
 {
 	unsigned int size = skb_end_pointer(skb) - skb->head;
-	struct sk_buff *n = alloc_skb(size, gfp_mask);
+	struct sk_buff *n;
+
+	if (skb_orphan_frags(skb, gfp_mask))
+		return NULL;
 
+	n = alloc_skb(size, gfp_mask);
 	if (!n)
 		goto out;
 
@@ -733,6 +964,7 @@ struct sk_buff *pskb_copy(struct sk_buff *skb, gfp_t gfp_mask)
 			get_page(skb_shinfo(n)->frags[i].page);
 		}
 		skb_shinfo(n)->nr_frags = i;
+		skb_zerocopy_clone(n, skb);
 	}
 
 	if (skb_has_frag_list(skb)) {
@@ -803,10 +1035,16 @@ int pskb_expand_head(struct sk_buff *skb, int nhead, int ntail,
 	}
 
 	if (fastpath) {
-		kfree(skb->head);
+		skb_free_head(skb);
 	} else {
+		/* copy this zero copy skb frags */
+		if (skb_orphan_frags(skb, gfp_mask))
+			goto nofrags;
 		for (i = 0; i < skb_shinfo(skb)->nr_frags; i++)
 			get_page(skb_shinfo(skb)->frags[i].page);
+		/* the copied shared info holds its own ubuf reference */
+		if (skb_zcopy_refcounted(skb))
+			atomic_inc(&skb_zcopy_uarg(skb)->refcnt);
 
 		if (skb_has_frag_list(skb))
 			skb_clone_fraglist(skb);
@@ -816,6 +1054,7 @@ int pskb_expand_head(struct sk_buff *skb, int nhead, int ntail,
 	off = (data + nhead) - skb->head;
 
 	skb->head     = data;
+	skb->head_frag = 0;
 	skb->data    += off;
 #ifdef NET_SKBUFF_DATA_USES_OFFSET
 	skb->end      = size;
@@ -838,6 +1077,8 @@ int pskb_expand_head(struct sk_buff *skb, int nhead, int ntail,
 	atomic_set(&skb_shinfo(skb)->dataref, 1);
 	return 0;
 
+nofrags:
+	kfree(data);
 nodata:
 	return -ENOMEM;
 }
@@ -2066,6 +2307,7 @@ void skb_split(struct sk_buff *skb, struct sk_buff *skb1, const u32 len)
 {
 	int pos = skb_headlen(skb);
 
+	skb_zerocopy_clone(skb1, skb);
 	if (len < pos)	/* Split line is inside header. */
 		skb_split_inside_header(skb, skb1, len, pos);
 	else		/* Second chunk has no header, nothing to copy. */
@@ -2108,6 +2350,10 @@ int skb_shift(struct sk_buff *tgt, struct sk_buff *skb, int shiftlen)
 	BUG_ON(shiftlen > skb->len);
 	BUG_ON(skb_headlen(skb));	/* Would corrupt stream */
 
+	/* frags cannot move between ubufs */
+	if (skb_zcopy(tgt) || skb_zcopy(skb))
+		return 0;
+
 	todo = shiftlen;
 	from = 0;
 	to = skb_shinfo(tgt)->nr_frags;
@@ -2499,6 +2745,10 @@ struct sk_buff *skb_segment(struct sk_buff *skb, int features)
 	int i = 0;
 	int pos;
 
+	/* segments share a MSG_ZEROCOPY ubuf, any other one is copied */
+	if (unlikely(skb_orphan_frags(skb, GFP_ATOMIC)))
+		return ERR_PTR(-ENOMEM);
+
 	__skb_push(skb, doffset);
 	headroom = skb_headroom(skb);
 	pos = skb_headlen(skb);
@@ -2581,6 +2831,7 @@ struct sk_buff *skb_segment(struct sk_buff *skb, int features)
 		}
 
 		frag = skb_shinfo(nskb)->frags;
+		skb_zerocopy_clone(nskb, skb);
 
 		skb_copy_from_linear_data_offset(skb, offset,
 						 skb_put(nskb, hsize), hsize);
@@ -3024,6 +3275,146 @@ void skb_tstamp_tx(struct sk_buff *orig_skb,
 }
 EXPORT_SYMBOL_GPL(skb_tstamp_tx);
 
+/*
+ * MSG_ZEROCOPY: the ubuf_info shared by all skbs holding the pages of one
+ * send call lives in the cb of the skb that later carries its completion
+ * notification to the socket error queue.
+ */
+static inline struct sk_buff *skb_from_uarg(struct ubuf_info *uarg)
+{
+	return container_of((void *)uarg, struct sk_buff, cb);
+}
+
+/**
+ *	sock_zerocopy_alloc - allocate a MSG_ZEROCOPY completion tracker
+ *	@sk: sending socket, must be locked by the caller
+ *
+ *	The caller owns the initial reference and must drop it with
+ *	sock_zerocopy_put() or sock_zerocopy_put_abort().
+ */
+struct ubuf_info *sock_zerocopy_alloc(struct sock *sk)
+{
+	struct ubuf_info *uarg;
+	struct sk_buff *skb;
+
+	BUILD_BUG_ON(sizeof(*uarg) > sizeof(skb->cb));
+
+	skb = alloc_skb(0, sk->sk_allocation);
+	if (!skb)
+		return NULL;
+
+	uarg = (struct ubuf_info *)skb->cb;
+	uarg->callback = sock_zerocopy_callback;
+	uarg->arg = sk;
+	uarg->desc = 0;
+	atomic_set(&uarg->refcnt, 1);
+	uarg->id = sk->sk_zckey++;
+	uarg->zerocopy = 1;
+	sock_hold(sk);
+
+	return uarg;
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_alloc);
+
+/* Merge into the notification at the tail of the queue if ids follow */
+static bool skb_zerocopy_notify_extend(struct sk_buff *tail, u32 id, u8 code)
+{
+	struct sock_exterr_skb *serr;
+
+	if (!tail)
+		return false;
+
+	serr = SKB_EXT_ERR(tail);
+	if (serr->ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY ||
+	    serr->ee.ee_code != code || serr->ee.ee_data + 1 != id)
+		return false;
+
+	serr->ee.ee_data = id;
+	return true;
+}
+
+void sock_zerocopy_callback(void *arg)
+{
+	struct ubuf_info *uarg = arg;
+	struct sk_buff *skb = skb_from_uarg(uarg);
+	struct sock *sk = uarg->arg;
+	struct sk_buff_head *q = &sk->sk_error_queue;
+	struct sock_exterr_skb *serr;
+	unsigned long flags;
+	u32 id;
+	u8 code;
+
+	if (!atomic_dec_and_test(&uarg->refcnt))
+		return;
+
+	if (sock_flag(sk, SOCK_DEAD)) {
+		consume_skb(skb);
+		goto out;
+	}
+
+	id = uarg->id;
+	code = uarg->zerocopy ? 0 : SO_EE_CODE_ZEROCOPY_COPIED;
+
+	serr = SKB_EXT_ERR(skb);
+	memset(serr, 0, sizeof(*serr));
+	serr->ee.ee_origin = SO_EE_ORIGIN_ZEROCOPY;
+	serr->ee.ee_code = code;
+	serr->ee.ee_info = id;
+	serr->ee.ee_data = id;
+
+	spin_lock_irqsave(&q->lock, flags);
+	if (skb_zerocopy_notify_extend(skb_peek_tail(q), id, code)) {
+		spin_unlock_irqrestore(&q->lock, flags);
+		consume_skb(skb);
+	} else {
+		/* not charged against sk_rcvbuf: notifications are bounded
+		 * by the send buffer and must not be lost
+		 */
+		skb->sk = sk;
+		skb->destructor = sock_rmem_free;
+		atomic_add(skb->truesize, &sk->sk_rmem_alloc);
+		__skb_queue_tail(q, skb);
+		spin_unlock_irqrestore(&q->lock, flags);
+	}
+	sk->sk_error_report(sk);
+out:
+	sock_put(sk);
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_callback);
+
+void sock_zerocopy_put(struct ubuf_info *uarg)
+{
+	if (uarg)
+		sock_zerocopy_callback(uarg);
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_put);
+
+/**
+ *	sock_zerocopy_put_abort - drop a tracker after a failed send
+ *	@uarg: tracker from sock_zerocopy_alloc(), may be NULL
+ *
+ *	If no skb took the pages, the send never happened: give the id back
+ *	and do not notify.  Called with the socket locked.
+ */
+void sock_zerocopy_put_abort(struct ubuf_info *uarg)
+{
+	struct sock *sk;
+
+	if (!uarg)
+		return;
+
+	if (atomic_read(&uarg->refcnt) != 1) {
+		sock_zerocopy_put(uarg);
+		return;
+	}
+
+	sk = uarg->arg;
+	sk->sk_zckey--;
+	kfree_skb(skb_from_uarg(uarg));
+	sock_put(sk);
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_put_abort);
+
 
 /**
  * skb_partial_csum_set - set up and verify partial csum values for packet
@@ -314,7 +314,8 @@ drop:
 	return -1;
 }
 
-static int ip_rcv_finish(struct sk_buff *skb)
+/* Route the packet and process its options; frees it on failure */
+static int ip_rcv_finish_core(struct sk_buff *skb)
 {
 	const struct iphdr *iph = ip_hdr(skb);
 	struct rtable *rt;
@@ -362,17 +363,27 @@ static int ip_rcv_finish(struct sk_buff *skb)
 		IP_UPD_PO_STATS_BH(dev_net(rt->dst.dev), IPSTATS_MIB_INBCAST,
 				skb->len);
 
-	return dst_input(skb);
+	return NET_RX_SUCCESS;
 
 drop:
 	kfree_skb(skb);
 	return NET_RX_DROP;
 }
 
+static int ip_rcv_finish(struct sk_buff *skb)
+{
+	int ret = ip_rcv_finish_core(skb);
+
+	if (ret == NET_RX_DROP)
+		return ret;
+	return dst_input(skb);
+}
+
 /*
- * 	Main IP Receive routine.
+ * 	Sanity checks common to ip_rcv() and ip_list_rcv().  Returns the
+ * 	skb ready for the PRE_ROUTING hook, or NULL if it was dropped.
  */
-int ip_rcv(struct sk_buff *skb, struct net_device *dev, struct packet_type *pt, struct net_device *orig_dev)
+static struct sk_buff *ip_rcv_core(struct sk_buff *skb, struct net_device *dev)
 {
 	struct iphdr *iph;
 	u32 len;
@@ -440,13 +451,97 @@ int ip_rcv(struct sk_buff *skb, struct net_device *dev, struct packet_type *pt,
 	/* Must drop socket now because of tproxy. */
 	skb_orphan(skb);
 
-	return NF_HOOK(NFPROTO_IPV4, NF_INET_PRE_ROUTING, skb, dev, NULL,
-		       ip_rcv_finish);
+	return skb;
 
 inhdr_error:
 	IP_INC_STATS_BH(dev_net(dev), IPSTATS_MIB_INHDRERRORS);
 drop:
 	kfree_skb(skb);
 out:
-	return NET_RX_DROP;
+	return NULL;
+}
+
+/*
+ * 	Main IP Receive routine.
+ */
+int ip_rcv(struct sk_buff *skb, struct net_device *dev, struct packet_type *pt, struct net_device *orig_dev)
+{
+	skb = ip_rcv_core(skb, dev);
+	if (skb == NULL)
+		return NET_RX_DROP;
+
+	return NF_HOOK(NFPROTO_IPV4, NF_INET_PRE_ROUTING, skb, dev, NULL,
+		       ip_rcv_finish);
+}
+
+static void ip_sublist_rcv_finish(struct sk_buff_head *list)
+{
+	struct sk_buff *skb;
+
+	while ((skb = __skb_dequeue(list)) != NULL)
+		dst_input(skb);
+}
+
+static void ip_list_rcv_finish(struct sk_buff_head *list)
+{
+	struct dst_entry *curr_dst = NULL;
+	struct sk_buff_head sublist;
+	struct sk_buff *skb;
+
+	__skb_queue_head_init(&sublist);
+
+	while ((skb = __skb_dequeue(list)) != NULL) {
+		struct dst_entry *dst;
+
+		if (ip_rcv_finish_core(skb) == NET_RX_DROP)
+			continue;
+
+		dst = skb_dst(skb);
+		if (curr_dst != dst) {
+			/* dispatch the packets routed the same way so far */
+			ip_sublist_rcv_finish(&sublist);
+			curr_dst = dst;
+		}
+		__skb_queue_tail(&sublist, skb);
+	}
+	ip_sublist_rcv_finish(&sublist);
+}
+
+static void ip_sublist_rcv(struct sk_buff_head *list, struct net_device *dev)
+{
+	NF_HOOK_LIST(NFPROTO_IPV4, NF_INET_PRE_ROUTING, list, dev, NULL,
+		     ip_rcv_finish);
+	ip_list_rcv_finish(list);
+}
+
+/*
+ * 	Receive a list of IP packets, see netif_receive_skb_list().  The
+ * 	packets go through the PRE_ROUTING hook and routing in runs that
+ * 	share the input device, so that every step works on a batch.
+ */
+void ip_list_rcv(struct sk_buff_head *list, struct packet_type *pt,
+		 struct net_device *orig_dev)
+{
+	struct net_device *curr_dev = NULL;
+	struct sk_buff_head sublist;
+	struct sk_buff *skb;
+
+	__skb_queue_head_init(&sublist);
+
+	while ((skb = __skb_dequeue(list)) != NULL) {
+		struct net_device *dev = skb->dev;
+
+		skb = ip_rcv_core(skb, dev);
+		if (skb == NULL)
+			continue;
+
+		if (curr_dev != dev) {
+			if (!skb_queue_empty(&sublist))
+				ip_sublist_rcv(&sublist, curr_dev);
+			curr_dev = dev;
+		}
+		__skb_queue_tail(&sublist, skb);
+	}
+	if (!skb_queue_empty(&sublist))
+		ip_sublist_rcv(&sublist, curr_dev);
 }
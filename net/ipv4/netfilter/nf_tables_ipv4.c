@@ -0,0 +1,67 @@
+/*
+ * nf_tables IPv4 address family
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/ip.h>
+#include <linux/netfilter_ipv4.h>
+#include <net/ip.h>
+#include <net/netfilter/nf_tables.h>
+
+static unsigned int
+nft_ipv4_hook(unsigned int hooknum, struct sk_buff *skb,
+	      const struct net_device *in, const struct net_device *out,
+	      int (*okfn)(struct sk_buff *))
+{
+	const struct iphdr *iph;
+	struct nft_pktinfo pkt;
+
+	if (hooknum == NF_INET_LOCAL_OUT &&
+	    (skb->len < sizeof(struct iphdr) ||
+	     ip_hdrlen(skb) < sizeof(struct iphdr)))
+		/* root is playing with raw sockets. */
+		return NF_ACCEPT;
+
+	nft_set_pktinfo(&pkt, hooknum, NFPROTO_IPV4, skb, in, out);
+
+	iph = ip_hdr(skb);
+	pkt.l4proto = iph->protocol;
+	/* Fragments other than the first one carry no transport header */
+	if (!(iph->frag_off & htons(IP_OFFSET)))
+		pkt.thoff = skb_network_offset(skb) + ip_hdrlen(skb);
+
+	return nft_do_chain_pkt(&pkt);
+}
+
+static struct nft_af_info nft_af_ipv4 __read_mostly = {
+	.family		= NFPROTO_IPV4,
+	.hooks		= (1 << NF_INET_LOCAL_IN) |
+			  (1 << NF_INET_LOCAL_OUT) |
+			  (1 << NF_INET_FORWARD) |
+			  (1 << NF_INET_PRE_ROUTING) |
+			  (1 << NF_INET_POST_ROUTING),
+	.hook		= nft_ipv4_hook,
+	.owner		= THIS_MODULE,
+};
+
+static int __init nf_tables_ipv4_init(void)
+{
+	return nft_register_afinfo(&nft_af_ipv4);
+}
+
+static void __exit nf_tables_ipv4_exit(void)
+{
+	nft_unregister_afinfo(&nft_af_ipv4);
+}
+
+module_init(nf_tables_ipv4_init);
+module_exit(nf_tables_ipv4_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("nf_tables IPv4 support");
+MODULE_ALIAS_NFT_FAMILY(AF_INET);
@@ -273,6 +273,7 @@
 #include <net/ip.h>
 #include <net/netdma.h>
 #include <net/sock.h>
+#include <net/busy_poll.h>
 
 #include <asm/uaccess.h>
 #include <asm/ioctls.h>
@@ -457,7 +458,7 @@ unsigned int tcp_poll(struct file *file, struct socket *sock, poll_table *wait)
 	}
 	/* This barrier is coupled with smp_wmb() in tcp_reset() */
 	smp_rmb();
-	if (sk->sk_err)
+	if (sk->sk_err || !skb_queue_empty(&sk->sk_error_queue))
 		mask |= POLLERR;
 
 	return mask;
@@ -904,15 +905,61 @@ static inline int select_size(struct sock *sk, int sg)
 	return tmp;
 }
 
+/* MSG_ZEROCOPY only pays off for large sends leaving the host */
+static bool tcp_zerocopy_ok(struct sock *sk, size_t size)
+{
+	struct dst_entry *dst = __sk_dst_get(sk);
+
+	if (size < TCP_ZEROCOPY_COPYBREAK)
+		return false;
+	if (!(sk->sk_route_caps & NETIF_F_SG) ||
+	    !(sk->sk_route_caps & NETIF_F_ALL_CSUM))
+		return false;
+	/* a local receiver could hold on to the user pages indefinitely */
+	if (!dst || !dst->dev || (dst->dev->flags & IFF_LOOPBACK))
+		return false;
+	return true;
+}
+
+/* Pin the user page at @from and attach @copy bytes of it to @skb.
+ * The caller makes sure the range does not cross a page boundary.
+ */
+static int tcp_zerocopy_add_page(struct sock *sk, struct sk_buff *skb,
+				 unsigned char __user *from, int copy)
+{
+	int i = skb_shinfo(skb)->nr_frags;
+	int off = (unsigned long)from & ~PAGE_MASK;
+	struct page *page;
+
+	if (get_user_pages_fast((unsigned long)from, 1, 0, &page) != 1)
+		return -EFAULT;
+
+	if (skb_can_coalesce(skb, i, page, off)) {
+		skb_shinfo(skb)->frags[i - 1].size += copy;
+		put_page(page);
+	} else
+		skb_fill_page_desc(skb, i, page, off, copy);
+
+	/* charged like copied data: the pages are held just as long */
+	skb->len	     += copy;
+	skb->data_len	     += copy;
+	skb->truesize	     += copy;
+	sk->sk_wmem_queued   += copy;
+	sk_mem_charge(sk, copy);
+	return 0;
+}
+
 int tcp_sendmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 		size_t size)
 {
 	struct iovec *iov;
 	struct tcp_sock *tp = tcp_sk(sk);
+	struct ubuf_info *uarg = NULL;
 	struct sk_buff *skb;
 	int iovlen, flags;
 	int mss_now, size_goal;
 	int sg, err, copied;
+	bool zc = false;
 	long timeo;
 
 	lock_sock(sk);
@@ -942,6 +989,17 @@ int tcp_sendmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 
 	sg = sk->sk_route_caps & NETIF_F_SG;
 
+	/* MSG_ZEROCOPY is ignored unless the socket opted in */
+	if ((flags & MSG_ZEROCOPY) && size && sock_flag(sk, SOCK_ZEROCOPY)) {
+		err = -ENOBUFS;
+		uarg = sock_zerocopy_alloc(sk);
+		if (!uarg)
+			goto out_err;
+		zc = tcp_zerocopy_ok(sk, size);
+		if (!zc)
+			uarg->zerocopy = 0;
+	}
+
 	while (--iovlen >= 0) {
 		size_t seglen = iov->iov_len;
 		unsigned char __user *from = iov->iov_base;
@@ -968,7 +1026,7 @@ new_segment:
 					goto wait_for_sndbuf;
 
 				skb = sk_stream_alloc_skb(sk,
-							  select_size(sk, sg),
+							  zc ? 0 : select_size(sk, sg),
 							  sk->sk_allocation);
 				if (!skb)
 					goto wait_for_memory;
@@ -995,6 +1053,26 @@ new_segment:
 					copy = skb_tailroom(skb);
 				if ((err = skb_add_data(skb, from, copy)) != 0)
 					goto do_fault;
+			} else if (zc && skb->ip_summed == CHECKSUM_PARTIAL) {
+				int off = (unsigned long)from & ~PAGE_MASK;
+
+				/* the frags of an skb belong to a single ubuf */
+				if ((skb_zcopy(skb) && skb_zcopy_uarg(skb) != uarg) ||
+				    skb_shinfo(skb)->nr_frags == MAX_SKB_FRAGS) {
+					tcp_mark_push(tp, skb);
+					goto new_segment;
+				}
+
+				if (copy > PAGE_SIZE - off)
+					copy = PAGE_SIZE - off;
+
+				if (!sk_wmem_schedule(sk, copy))
+					goto wait_for_memory;
+
+				err = tcp_zerocopy_add_page(sk, skb, from, copy);
+				if (err)
+					goto do_fault;
+				skb_zcopy_set(skb, uarg);
 			} else {
 				int merge = 0;
 				int i = skb_shinfo(skb)->nr_frags;
@@ -1104,6 +1182,7 @@ wait_for_memory:
 out:
 	if (copied)
 		tcp_push(sk, flags, mss_now, tp->nonagle);
+	sock_zerocopy_put(uarg);
 	TCP_CHECK_TIMER(sk);
 	release_sock(sk);
 	return copied;
@@ -1122,6 +1201,7 @@ do_error:
 	if (copied)
 		goto out;
 out_err:
+	sock_zerocopy_put_abort(uarg);
 	err = sk_stream_error(sk, flags, err);
 	TCP_CHECK_TIMER(sk);
 	release_sock(sk);
@@ -1413,6 +1493,14 @@ int tcp_recvmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 	struct sk_buff *skb;
 	u32 urg_hole = 0;
 
+	/* MSG_ZEROCOPY completions; IPv6 sockets handle this themselves */
+	if (unlikely(flags & MSG_ERRQUEUE))
+		return ip_recv_error(sk, msg, len);
+
+	if (sk_can_busy_loop(sk) && skb_queue_empty(&sk->sk_receive_queue) &&
+	    sk->sk_state == TCP_ESTABLISHED)
+		sk_busy_loop(sk, nonblock);
+
 	lock_sock(sk);
 
 	TCP_CHECK_TIMER(sk);
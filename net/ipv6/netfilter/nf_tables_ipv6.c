@@ -0,0 +1,70 @@
+/*
+ * nf_tables IPv6 address family
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/ipv6.h>
+#include <linux/netfilter_ipv6.h>
+#include <net/ipv6.h>
+#include <net/netfilter/nf_tables.h>
+
+static unsigned int
+nft_ipv6_hook(unsigned int hooknum, struct sk_buff *skb,
+	      const struct net_device *in, const struct net_device *out,
+	      int (*okfn)(struct sk_buff *))
+{
+	struct nft_pktinfo pkt;
+	u8 nexthdr;
+	int thoff;
+
+	/* root is playing with raw sockets. */
+	if (hooknum == NF_INET_LOCAL_OUT &&
+	    skb->len < sizeof(struct ipv6hdr))
+		return NF_ACCEPT;
+
+	nft_set_pktinfo(&pkt, hooknum, NFPROTO_IPV6, skb, in, out);
+
+	nexthdr = ipv6_hdr(skb)->nexthdr;
+	thoff = ipv6_skip_exthdr(skb, skb_network_offset(skb) +
+				 sizeof(struct ipv6hdr), &nexthdr);
+	/* Non-first fragments stop at the fragment header */
+	if (thoff >= 0 && nexthdr != NEXTHDR_FRAGMENT) {
+		pkt.l4proto = nexthdr;
+		pkt.thoff = thoff;
+	}
+
+	return nft_do_chain_pkt(&pkt);
+}
+
+static struct nft_af_info nft_af_ipv6 __read_mostly = {
+	.family		= NFPROTO_IPV6,
+	.hooks		= (1 << NF_INET_LOCAL_IN) |
+			  (1 << NF_INET_LOCAL_OUT) |
+			  (1 << NF_INET_FORWARD) |
+			  (1 << NF_INET_PRE_ROUTING) |
+			  (1 << NF_INET_POST_ROUTING),
+	.hook		= nft_ipv6_hook,
+	.owner		= THIS_MODULE,
+};
+
+static int __init nf_tables_ipv6_init(void)
+{
+	return nft_register_afinfo(&nft_af_ipv6);
+}
+
+static void __exit nf_tables_ipv6_exit(void)
+{
+	nft_unregister_afinfo(&nft_af_ipv6);
+}
+
+module_init(nf_tables_ipv6_init);
+module_exit(nf_tables_ipv6_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("nf_tables IPv6 support");
+MODULE_ALIAS_NFT_FAMILY(AF_INET6);
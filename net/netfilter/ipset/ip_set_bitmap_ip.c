@@ -0,0 +1,424 @@
+/* Kernel module implementing an IP set type: the bitmap:ip type
+ *
+ * The set covers a range of at most 65536 IPv4 addresses and keeps one
+ * bit per address, so testing an address costs a subtraction and a
+ * test_bit().  When a timeout is given at create time, every address
+ * gets its own expiry time too.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/ip.h>
+#include <linux/skbuff.h>
+#include <linux/errno.h>
+#include <linux/bitops.h>
+#include <linux/spinlock.h>
+#include <linux/netlink.h>
+#include <linux/jiffies.h>
+#include <linux/timer.h>
+#include <net/netlink.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/ipset/ip_set.h>
+#include <linux/netfilter/ipset/ip_set_bitmap.h>
+#include <linux/netfilter/ipset/ip_set_timeout.h>
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("bitmap:ip type of IP sets");
+MODULE_ALIAS("ip_set_bitmap:ip");
+
+/* Type structure */
+struct bitmap_ip {
+	unsigned long *members;	/* the set members */
+	unsigned long *timeouts; /* expiry of the members, if enabled */
+	u32 first_ip;		/* host byte order, included in range */
+	u32 last_ip;		/* host byte order, included in range */
+	u32 elements;		/* number of addresses in the range */
+	size_t memsize;		/* members size */
+	u32 timeout;		/* timeout parameter */
+	struct timer_list gc;	/* garbage collection */
+};
+
+static inline bool
+bitmap_ip_member(const struct bitmap_ip *map, u32 id)
+{
+	return test_bit(id, map->members) &&
+	       (!with_timeout(map->timeout) ||
+		ip_set_timeout_test(map->timeouts[id]));
+}
+
+static int
+bitmap_ip_adt(struct ip_set *set, u32 id, enum ipset_adt adt,
+	      u32 timeout, u32 flags)
+{
+	struct bitmap_ip *map = set->data;
+
+	switch (adt) {
+	case IPSET_TEST:
+		return bitmap_ip_member(map, id);
+	case IPSET_ADD:
+		if (bitmap_ip_member(map, id)) {
+			if (with_timeout(map->timeout) &&
+			    (flags & IPSET_FLAG_EXIST))
+				map->timeouts[id] = ip_set_timeout_set(timeout);
+			return -IPSET_ERR_EXIST;
+		}
+		if (with_timeout(map->timeout)) {
+			map->timeouts[id] = ip_set_timeout_set(timeout);
+			/* The expiry must be visible before the bit */
+			smp_wmb();
+		}
+		set_bit(id, map->members);
+		return 0;
+	case IPSET_DEL:
+		if (!bitmap_ip_member(map, id))
+			return -IPSET_ERR_EXIST;
+		clear_bit(id, map->members);
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int
+bitmap_ip_kadt(struct ip_set *set, const struct sk_buff *skb,
+	       enum ipset_adt adt, u8 pf, u8 dim, u8 flags)
+{
+	const struct bitmap_ip *map = set->data;
+	__be32 addr;
+	u32 ip;
+
+	ip4addrptr(skb, flags & IPSET_DIM_ONE_SRC, &addr);
+	ip = ntohl(addr);
+	if (ip < map->first_ip || ip > map->last_ip)
+		return -IPSET_ERR_BITMAP_RANGE;
+
+	return bitmap_ip_adt(set, ip - map->first_ip, adt, map->timeout, 0);
+}
+
+static int
+bitmap_ip_uadt(struct ip_set *set, struct nlattr *tb[],
+	       enum ipset_adt adt, u32 flags, bool retried)
+{
+	const struct bitmap_ip *map = set->data;
+	u32 ip, ip_to, timeout = map->timeout;
+	__be32 addr;
+	int ret;
+
+	if (unlikely(!tb[IPSET_ATTR_IP] ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_TIMEOUT)))
+		return -IPSET_ERR_PROTOCOL;
+
+	ret = ip_set_get_ipaddr4(tb[IPSET_ATTR_IP], &addr);
+	if (ret)
+		return ret;
+	ip = ntohl(addr);
+
+	if (ip < map->first_ip || ip > map->last_ip)
+		return -IPSET_ERR_BITMAP_RANGE;
+
+	if (tb[IPSET_ATTR_TIMEOUT]) {
+		if (!with_timeout(map->timeout))
+			return -IPSET_ERR_TIMEOUT;
+		timeout = ip_set_timeout_uget(tb[IPSET_ATTR_TIMEOUT]);
+	}
+
+	if (adt == IPSET_TEST)
+		return bitmap_ip_adt(set, ip - map->first_ip, adt, 0, 0);
+
+	if (tb[IPSET_ATTR_IP_TO]) {
+		ret = ip_set_get_ipaddr4(tb[IPSET_ATTR_IP_TO], &addr);
+		if (ret)
+			return ret;
+		ip_to = ntohl(addr);
+		if (ip > ip_to) {
+			swap(ip, ip_to);
+			if (ip < map->first_ip)
+				return -IPSET_ERR_BITMAP_RANGE;
+		}
+	} else if (tb[IPSET_ATTR_CIDR]) {
+		u8 cidr = nla_get_u8(tb[IPSET_ATTR_CIDR]);
+
+		if (!cidr || cidr > 32)
+			return -IPSET_ERR_INVALID_CIDR;
+		ip &= ntohl(ip_set_netmask(cidr));
+		ip_to = ip | ~ntohl(ip_set_netmask(cidr));
+		if (ip < map->first_ip)
+			return -IPSET_ERR_BITMAP_RANGE;
+	} else
+		ip_to = ip;
+
+	if (ip_to > map->last_ip)
+		return -IPSET_ERR_BITMAP_RANGE;
+
+	for (;;) {
+		ret = bitmap_ip_adt(set, ip - map->first_ip, adt,
+				    timeout, flags);
+		if (ret && !ip_set_eexist(ret, flags))
+			return ret;
+		if (ip++ == ip_to)
+			break;
+	}
+	return 0;
+}
+
+static void
+bitmap_ip_destroy(struct ip_set *set)
+{
+	struct bitmap_ip *map = set->data;
+
+	if (with_timeout(map->timeout)) {
+		del_timer_sync(&map->gc);
+		ip_set_free(map->timeouts);
+	}
+	ip_set_free(map->members);
+	kfree(map);
+
+	set->data = NULL;
+}
+
+static void
+bitmap_ip_flush(struct ip_set *set)
+{
+	struct bitmap_ip *map = set->data;
+
+	memset(map->members, 0, map->memsize);
+}
+
+static int
+bitmap_ip_head(struct ip_set *set, struct sk_buff *skb)
+{
+	const struct bitmap_ip *map = set->data;
+	struct nlattr *nested;
+	size_t memsize = sizeof(*map) + map->memsize;
+
+	if (with_timeout(map->timeout))
+		memsize += map->elements * sizeof(unsigned long);
+
+	nested = ipset_nest_start(skb, IPSET_ATTR_DATA);
+	if (!nested)
+		goto nla_put_failure;
+	NLA_PUT_IPADDR4(skb, IPSET_ATTR_IP, htonl(map->first_ip));
+	NLA_PUT_IPADDR4(skb, IPSET_ATTR_IP_TO, htonl(map->last_ip));
+	NLA_PUT_NET32(skb, IPSET_ATTR_REFERENCES, htonl(set->ref - 1));
+	NLA_PUT_NET32(skb, IPSET_ATTR_MEMSIZE, htonl(memsize));
+	if (with_timeout(map->timeout))
+		NLA_PUT_NET32(skb, IPSET_ATTR_TIMEOUT, htonl(map->timeout));
+	ipset_nest_end(skb, nested);
+
+	return 0;
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+/* The next address to dump is kept in cb->args[IPSET_CB_ARG0] */
+static int
+bitmap_ip_list(const struct ip_set *set,
+	       struct sk_buff *skb, struct netlink_callback *cb)
+{
+	const struct bitmap_ip *map = set->data;
+	struct nlattr *atd, *nested;
+	u32 id, first = cb->args[IPSET_CB_ARG0];
+	void *incomplete;
+
+	atd = ipset_nest_start(skb, IPSET_ATTR_ADT);
+	if (!atd)
+		return -EMSGSIZE;
+	for (; cb->args[IPSET_CB_ARG0] < map->elements;
+	     cb->args[IPSET_CB_ARG0]++) {
+		id = cb->args[IPSET_CB_ARG0];
+		if (!bitmap_ip_member(map, id))
+			continue;
+		incomplete = skb_tail_pointer(skb);
+		nested = ipset_nest_start(skb, IPSET_ATTR_DATA);
+		if (!nested)
+			goto nla_put_failure;
+		NLA_PUT_IPADDR4(skb, IPSET_ATTR_IP,
+				htonl(map->first_ip + id));
+		if (with_timeout(map->timeout))
+			NLA_PUT_NET32(skb, IPSET_ATTR_TIMEOUT,
+			    htonl(ip_set_timeout_get(map->timeouts[id])));
+		ipset_nest_end(skb, nested);
+	}
+	ipset_nest_end(skb, atd);
+	/* Set listing finished */
+	cb->args[IPSET_CB_ARG0] = 0;
+	return 0;
+
+nla_put_failure:
+	nlmsg_trim(skb, incomplete);
+	ipset_nest_end(skb, atd);
+	if (unlikely(id == first)) {
+		/* Not even a single element fits into a message */
+		cb->args[IPSET_CB_ARG0] = 0;
+		return -ENOSPC;
+	}
+	return -EMSGSIZE;
+}
+
+static bool
+bitmap_ip_same_set(const struct ip_set *a, const struct ip_set *b)
+{
+	const struct bitmap_ip *x = a->data;
+	const struct bitmap_ip *y = b->data;
+
+	return x->first_ip == y->first_ip &&
+	       x->last_ip == y->last_ip &&
+	       x->timeout == y->timeout;
+}
+
+static const struct ip_set_type_variant bitmap_ip_variant = {
+	.kadt	= bitmap_ip_kadt,
+	.uadt	= bitmap_ip_uadt,
+	.destroy = bitmap_ip_destroy,
+	.flush	= bitmap_ip_flush,
+	.head	= bitmap_ip_head,
+	.list	= bitmap_ip_list,
+	.same_set = bitmap_ip_same_set,
+};
+
+static void
+bitmap_ip_gc(unsigned long ul_set)
+{
+	struct ip_set *set = (struct ip_set *) ul_set;
+	struct bitmap_ip *map = set->data;
+	u32 id;
+
+	spin_lock_bh(&set->lock);
+	for (id = 0; id < map->elements; id++)
+		if (test_bit(id, map->members) &&
+		    ip_set_timeout_expired(map->timeouts[id]))
+			clear_bit(id, map->members);
+	spin_unlock_bh(&set->lock);
+
+	map->gc.expires = jiffies + IPSET_GC_PERIOD(map->timeout) * HZ;
+	add_timer(&map->gc);
+}
+
+static void
+bitmap_ip_gc_init(struct ip_set *set)
+{
+	struct bitmap_ip *map = set->data;
+
+	init_timer(&map->gc);
+	map->gc.data = (unsigned long) set;
+	map->gc.function = bitmap_ip_gc;
+	map->gc.expires = jiffies + IPSET_GC_PERIOD(map->timeout) * HZ;
+	add_timer(&map->gc);
+}
+
+static int
+bitmap_ip_create(struct ip_set *set, struct nlattr *tb[], u32 flags)
+{
+	struct bitmap_ip *map;
+	u32 first_ip, last_ip;
+	__be32 addr;
+	int ret;
+
+	if (unlikely(!tb[IPSET_ATTR_IP] ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_TIMEOUT)))
+		return -IPSET_ERR_PROTOCOL;
+
+	ret = ip_set_get_ipaddr4(tb[IPSET_ATTR_IP], &addr);
+	if (ret)
+		return ret;
+	first_ip = ntohl(addr);
+
+	if (tb[IPSET_ATTR_IP_TO]) {
+		ret = ip_set_get_ipaddr4(tb[IPSET_ATTR_IP_TO], &addr);
+		if (ret)
+			return ret;
+		last_ip = ntohl(addr);
+		if (first_ip > last_ip)
+			swap(first_ip, last_ip);
+	} else if (tb[IPSET_ATTR_CIDR]) {
+		u8 cidr = nla_get_u8(tb[IPSET_ATTR_CIDR]);
+
+		if (cidr > 32)
+			return -IPSET_ERR_INVALID_CIDR;
+		first_ip &= ntohl(ip_set_netmask(cidr));
+		last_ip = first_ip | ~ntohl(ip_set_netmask(cidr));
+	} else
+		return -IPSET_ERR_PROTOCOL;
+
+	if (last_ip - first_ip > IPSET_BITMAP_MAX_RANGE)
+		return -IPSET_ERR_BITMAP_RANGE_SIZE;
+
+	map = kzalloc(sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return -ENOMEM;
+
+	map->first_ip = first_ip;
+	map->last_ip = last_ip;
+	map->elements = last_ip - first_ip + 1;
+	map->memsize = BITS_TO_LONGS(map->elements) * sizeof(unsigned long);
+	map->timeout = IPSET_NO_TIMEOUT;
+
+	map->members = ip_set_alloc(map->memsize);
+	if (!map->members)
+		goto out;
+
+	if (tb[IPSET_ATTR_TIMEOUT]) {
+		map->timeouts = ip_set_alloc(map->elements *
+					     sizeof(unsigned long));
+		if (!map->timeouts)
+			goto out;
+		map->timeout = ip_set_timeout_uget(tb[IPSET_ATTR_TIMEOUT]);
+	}
+
+	set->data = map;
+	set->variant = &bitmap_ip_variant;
+
+	if (with_timeout(map->timeout))
+		bitmap_ip_gc_init(set);
+
+	return 0;
+
+out:
+	if (map->members)
+		ip_set_free(map->members);
+	kfree(map);
+	return -ENOMEM;
+}
+
+static struct ip_set_type bitmap_ip_type __read_mostly = {
+	.name		= "bitmap:ip",
+	.protocol	= IPSET_PROTOCOL,
+	.features	= IPSET_TYPE_IP,
+	.dimension	= IPSET_DIM_ONE,
+	.family		= NFPROTO_IPV4,
+	.revision	= 0,
+	.create		= bitmap_ip_create,
+	.create_policy	= {
+		[IPSET_ATTR_IP]		= { .type = NLA_NESTED },
+		[IPSET_ATTR_IP_TO]	= { .type = NLA_NESTED },
+		[IPSET_ATTR_CIDR]	= { .type = NLA_U8 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+	},
+	.adt_policy	= {
+		[IPSET_ATTR_IP]		= { .type = NLA_NESTED },
+		[IPSET_ATTR_IP_TO]	= { .type = NLA_NESTED },
+		[IPSET_ATTR_CIDR]	= { .type = NLA_U8 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+		[IPSET_ATTR_LINENO]	= { .type = NLA_U32 },
+	},
+	.me		= THIS_MODULE,
+};
+
+static int __init
+bitmap_ip_init(void)
+{
+	return ip_set_type_register(&bitmap_ip_type);
+}
+
+static void __exit
+bitmap_ip_fini(void)
+{
+	ip_set_type_unregister(&bitmap_ip_type);
+}
+
+module_init(bitmap_ip_init);
+module_exit(bitmap_ip_fini);
@@ -0,0 +1,219 @@
+/* Kernel module implementing an IP set type: the hash:ip type
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/ip.h>
+#include <linux/skbuff.h>
+#include <linux/errno.h>
+#include <linux/netlink.h>
+#include <linux/rcupdate.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+#include <net/netlink.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/ipset/ip_set.h>
+#include <linux/netfilter/ipset/ip_set_hash.h>
+#include <linux/netfilter/ipset/ip_set_ahash.h>
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("hash:ip type of IP sets");
+MODULE_ALIAS("ip_set_hash:ip");
+
+/* The key is the bare address: 4 bytes for IPv4, 16 for IPv6 */
+
+static int
+hash_ip4_data_list(struct sk_buff *skb, const void *data)
+{
+	const union nf_inet_addr *e = data;
+
+	NLA_PUT_IPADDR4(skb, IPSET_ATTR_IP, e->ip);
+	return 0;
+
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+static int
+hash_ip6_data_list(struct sk_buff *skb, const void *data)
+{
+	const union nf_inet_addr *e = data;
+
+	NLA_PUT_IPADDR6(skb, IPSET_ATTR_IP, &e->in6);
+	return 0;
+
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+static int
+hash_ip_adt(struct ip_set *set, const union nf_inet_addr *e,
+	    enum ipset_adt adt, u32 timeout, u32 flags)
+{
+	switch (adt) {
+	case IPSET_TEST:
+		return ahash_test(set, e);
+	case IPSET_ADD:
+		return ahash_add(set, e, timeout, flags);
+	case IPSET_DEL:
+		return ahash_del(set, e);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int
+hash_ip_kadt(struct ip_set *set, const struct sk_buff *skb,
+	     enum ipset_adt adt, u8 pf, u8 dim, u8 flags)
+{
+	const struct ip_set_hash *h = set->data;
+	union nf_inet_addr e = {};
+
+	if (pf == NFPROTO_IPV4)
+		ip4addrptr(skb, flags & IPSET_DIM_ONE_SRC, &e.ip);
+	else
+		ip6addrptr(skb, flags & IPSET_DIM_ONE_SRC, &e.in6);
+
+	return hash_ip_adt(set, &e, adt, h->timeout, 0);
+}
+
+static int
+hash_ip_uadt(struct ip_set *set, struct nlattr *tb[],
+	     enum ipset_adt adt, u32 flags, bool retried)
+{
+	struct ip_set_hash *h = set->data;
+	union nf_inet_addr e = {};
+	u32 ip, ip_to, timeout = h->timeout;
+	int ret;
+
+	if (unlikely(!tb[IPSET_ATTR_IP] ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_TIMEOUT)))
+		return -IPSET_ERR_PROTOCOL;
+
+	if (tb[IPSET_ATTR_TIMEOUT]) {
+		if (!with_timeout(h->timeout))
+			return -IPSET_ERR_TIMEOUT;
+		timeout = ip_set_timeout_uget(tb[IPSET_ATTR_TIMEOUT]);
+	}
+
+	if (set->family == NFPROTO_IPV6) {
+		if (tb[IPSET_ATTR_IP_TO] || tb[IPSET_ATTR_CIDR])
+			return -IPSET_ERR_PROTOCOL;
+		ret = ip_set_get_ipaddr6(tb[IPSET_ATTR_IP], &e);
+		if (ret)
+			return ret;
+		if (ipv6_addr_any(&e.in6))
+			return -IPSET_ERR_HASH_ELEM;
+
+		return hash_ip_adt(set, &e, adt, timeout, flags);
+	}
+
+	ret = ip_set_get_ipaddr4(tb[IPSET_ATTR_IP], &e.ip);
+	if (ret)
+		return ret;
+
+	if (adt == IPSET_TEST ||
+	    !(tb[IPSET_ATTR_IP_TO] || tb[IPSET_ATTR_CIDR])) {
+		if (!e.ip)
+			return -IPSET_ERR_HASH_ELEM;
+		return hash_ip_adt(set, &e, adt, timeout, flags);
+	}
+
+	ip = ntohl(e.ip);
+	if (tb[IPSET_ATTR_IP_TO]) {
+		ret = ip_set_get_ipaddr4(tb[IPSET_ATTR_IP_TO], &e.ip);
+		if (ret)
+			return ret;
+		ip_to = ntohl(e.ip);
+		if (ip > ip_to)
+			swap(ip, ip_to);
+	} else {
+		u8 cidr = nla_get_u8(tb[IPSET_ATTR_CIDR]);
+
+		if (!cidr || cidr > 32)
+			return -IPSET_ERR_INVALID_CIDR;
+		ip &= ntohl(ip_set_netmask(cidr));
+		ip_to = ip | ~ntohl(ip_set_netmask(cidr));
+	}
+	if (!ip)
+		return -IPSET_ERR_HASH_ELEM;
+
+	if (retried)
+		ip = h->next_ip;
+	for (;;) {
+		e.ip = htonl(ip);
+		ret = hash_ip_adt(set, &e, adt, timeout, flags);
+		if (ret == -EAGAIN)
+			h->next_ip = ip;
+		if (ret && !ip_set_eexist(ret, flags))
+			return ret;
+		if (ip++ == ip_to)
+			break;
+	}
+	return 0;
+}
+
+static const struct ip_set_type_variant hash_ip_variant = {
+	.kadt	= hash_ip_kadt,
+	.uadt	= hash_ip_uadt,
+	.resize	= ahash_resize,
+	.destroy = ahash_destroy,
+	.flush	= ahash_flush,
+	.head	= ahash_head,
+	.list	= ahash_list,
+	.same_set = ahash_same_set,
+};
+
+static int
+hash_ip_create(struct ip_set *set, struct nlattr *tb[], u32 flags)
+{
+	if (set->family == NFPROTO_IPV4)
+		return ahash_create(set, tb, sizeof(__be32), false,
+				    &hash_ip_variant, hash_ip4_data_list);
+	return ahash_create(set, tb, sizeof(struct in6_addr), false,
+			    &hash_ip_variant, hash_ip6_data_list);
+}
+
+static struct ip_set_type hash_ip_type __read_mostly = {
+	.name		= "hash:ip",
+	.protocol	= IPSET_PROTOCOL,
+	.features	= IPSET_TYPE_IP,
+	.dimension	= IPSET_DIM_ONE,
+	.family		= NFPROTO_UNSPEC,
+	.revision	= 0,
+	.create		= hash_ip_create,
+	.create_policy	= {
+		[IPSET_ATTR_HASHSIZE]	= { .type = NLA_U32 },
+		[IPSET_ATTR_MAXELEM]	= { .type = NLA_U32 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+	},
+	.adt_policy	= {
+		[IPSET_ATTR_IP]		= { .type = NLA_NESTED },
+		[IPSET_ATTR_IP_TO]	= { .type = NLA_NESTED },
+		[IPSET_ATTR_CIDR]	= { .type = NLA_U8 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+		[IPSET_ATTR_LINENO]	= { .type = NLA_U32 },
+	},
+	.me		= THIS_MODULE,
+};
+
+static int __init
+hash_ip_init(void)
+{
+	return ip_set_type_register(&hash_ip_type);
+}
+
+static void __exit
+hash_ip_fini(void)
+{
+	ip_set_type_unregister(&hash_ip_type);
+	/* Wait for the buckets freed by call_rcu_bh() */
+	rcu_barrier_bh();
+}
+
+module_init(hash_ip_init);
+module_exit(hash_ip_fini);
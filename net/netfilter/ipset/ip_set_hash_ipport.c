@@ -0,0 +1,283 @@
+/* Kernel module implementing an IP set type: the hash:ip,port type
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/ip.h>
+#include <linux/skbuff.h>
+#include <linux/errno.h>
+#include <linux/netlink.h>
+#include <linux/rcupdate.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+#include <net/netlink.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/ipset/ip_set.h>
+#include <linux/netfilter/ipset/ip_set_getport.h>
+#include <linux/netfilter/ipset/ip_set_hash.h>
+#include <linux/netfilter/ipset/ip_set_ahash.h>
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("hash:ip,port type of IP sets");
+MODULE_ALIAS("ip_set_hash:ip,port");
+
+/* The key: port and protocol, followed by the address.  For ICMP and
+ * ICMPv6 the "port" holds the type and code of the message.
+ */
+struct hash_ipport_elem {
+	__be16 port;
+	u8 proto;
+	u8 padding;
+	union nf_inet_addr ip;
+};
+
+#define hash_ipport_dsize(family)					\
+	(offsetof(struct hash_ipport_elem, ip) +			\
+	 ((family) == NFPROTO_IPV4 ? sizeof(__be32) : sizeof(struct in6_addr)))
+
+static int
+hash_ipport4_data_list(struct sk_buff *skb, const void *data)
+{
+	const struct hash_ipport_elem *e = data;
+
+	NLA_PUT_IPADDR4(skb, IPSET_ATTR_IP, e->ip.ip);
+	NLA_PUT_NET16(skb, IPSET_ATTR_PORT, e->port);
+	NLA_PUT_U8(skb, IPSET_ATTR_PROTO, e->proto);
+	return 0;
+
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+static int
+hash_ipport6_data_list(struct sk_buff *skb, const void *data)
+{
+	const struct hash_ipport_elem *e = data;
+
+	NLA_PUT_IPADDR6(skb, IPSET_ATTR_IP, &e->ip.in6);
+	NLA_PUT_NET16(skb, IPSET_ATTR_PORT, e->port);
+	NLA_PUT_U8(skb, IPSET_ATTR_PROTO, e->proto);
+	return 0;
+
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+static int
+hash_ipport_adt(struct ip_set *set, const struct hash_ipport_elem *e,
+		enum ipset_adt adt, u32 timeout, u32 flags)
+{
+	switch (adt) {
+	case IPSET_TEST:
+		return ahash_test(set, e);
+	case IPSET_ADD:
+		return ahash_add(set, e, timeout, flags);
+	case IPSET_DEL:
+		return ahash_del(set, e);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int
+hash_ipport_kadt(struct ip_set *set, const struct sk_buff *skb,
+		 enum ipset_adt adt, u8 pf, u8 dim, u8 flags)
+{
+	const struct ip_set_hash *h = set->data;
+	struct hash_ipport_elem e = {};
+
+	if (pf == NFPROTO_IPV4) {
+		if (!ip_set_get_ip4_port(skb, flags & IPSET_DIM_TWO_SRC,
+					 &e.port, &e.proto))
+			return -EINVAL;
+		ip4addrptr(skb, flags & IPSET_DIM_ONE_SRC, &e.ip.ip);
+	} else {
+		if (!ip_set_get_ip6_port(skb, flags & IPSET_DIM_TWO_SRC,
+					 &e.port, &e.proto))
+			return -EINVAL;
+		ip6addrptr(skb, flags & IPSET_DIM_ONE_SRC, &e.ip.in6);
+	}
+
+	return hash_ipport_adt(set, &e, adt, h->timeout, 0);
+}
+
+static int
+hash_ipport_uadt(struct ip_set *set, struct nlattr *tb[],
+		 enum ipset_adt adt, u32 flags, bool retried)
+{
+	struct ip_set_hash *h = set->data;
+	struct hash_ipport_elem e = {};
+	u32 ip, ip_to, port, port_to, p;
+	u32 timeout = h->timeout;
+	bool with_ports;
+	int ret;
+
+	if (unlikely(!tb[IPSET_ATTR_IP] ||
+		     !ip_set_attr_netorder(tb, IPSET_ATTR_PORT) ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_PORT_TO) ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_TIMEOUT)))
+		return -IPSET_ERR_PROTOCOL;
+
+	if (set->family == NFPROTO_IPV4)
+		ret = ip_set_get_ipaddr4(tb[IPSET_ATTR_IP], &e.ip.ip);
+	else
+		ret = ip_set_get_ipaddr6(tb[IPSET_ATTR_IP], &e.ip);
+	if (ret)
+		return ret;
+
+	e.port = nla_get_be16(tb[IPSET_ATTR_PORT]);
+
+	if (!tb[IPSET_ATTR_PROTO])
+		return -IPSET_ERR_MISSING_PROTO;
+	e.proto = nla_get_u8(tb[IPSET_ATTR_PROTO]);
+	if (e.proto == 0)
+		return -IPSET_ERR_INVALID_PROTO;
+
+	with_ports = ip_set_proto_with_ports(e.proto);
+	switch (e.proto) {
+	case IPPROTO_ICMP:
+		if (set->family != NFPROTO_IPV4)
+			return -IPSET_ERR_INVALID_PROTO;
+		break;
+	case IPPROTO_ICMPV6:
+		if (set->family != NFPROTO_IPV6)
+			return -IPSET_ERR_INVALID_PROTO;
+		break;
+	default:
+		if (!with_ports)
+			e.port = 0;
+		break;
+	}
+
+	if (tb[IPSET_ATTR_TIMEOUT]) {
+		if (!with_timeout(h->timeout))
+			return -IPSET_ERR_TIMEOUT;
+		timeout = ip_set_timeout_uget(tb[IPSET_ATTR_TIMEOUT]);
+	}
+
+	if (adt == IPSET_TEST ||
+	    !(tb[IPSET_ATTR_IP_TO] || tb[IPSET_ATTR_CIDR] ||
+	      tb[IPSET_ATTR_PORT_TO]))
+		return hash_ipport_adt(set, &e, adt, timeout, flags);
+
+	/* Address ranges are supported for IPv4 only */
+	if ((set->family == NFPROTO_IPV6 &&
+	     (tb[IPSET_ATTR_IP_TO] || tb[IPSET_ATTR_CIDR])) ||
+	    (tb[IPSET_ATTR_PORT_TO] && !with_ports))
+		return -IPSET_ERR_PROTOCOL;
+
+	ip = ip_to = set->family == NFPROTO_IPV4 ? ntohl(e.ip.ip) : 0;
+	if (tb[IPSET_ATTR_IP_TO]) {
+		ret = ip_set_get_ipaddr4(tb[IPSET_ATTR_IP_TO], &e.ip.ip);
+		if (ret)
+			return ret;
+		ip_to = ntohl(e.ip.ip);
+		if (ip > ip_to)
+			swap(ip, ip_to);
+	} else if (tb[IPSET_ATTR_CIDR]) {
+		u8 cidr = nla_get_u8(tb[IPSET_ATTR_CIDR]);
+
+		if (!cidr || cidr > 32)
+			return -IPSET_ERR_INVALID_CIDR;
+		ip &= ntohl(ip_set_netmask(cidr));
+		ip_to = ip | ~ntohl(ip_set_netmask(cidr));
+	}
+
+	port = port_to = ntohs(e.port);
+	if (with_ports && tb[IPSET_ATTR_PORT_TO]) {
+		port_to = ip_set_get_h16(tb[IPSET_ATTR_PORT_TO]);
+		if (port > port_to)
+			swap(port, port_to);
+	}
+
+	p = port;
+	if (retried) {
+		ip = h->next_ip;
+		p = h->next_port;
+	}
+	for (;;) {
+		if (set->family == NFPROTO_IPV4)
+			e.ip.ip = htonl(ip);
+		for (; p <= port_to; p++) {
+			e.port = htons(p);
+			ret = hash_ipport_adt(set, &e, adt, timeout, flags);
+			if (ret == -EAGAIN) {
+				h->next_ip = ip;
+				h->next_port = p;
+			}
+			if (ret && !ip_set_eexist(ret, flags))
+				return ret;
+		}
+		if (ip++ == ip_to)
+			break;
+		p = port;
+	}
+	return 0;
+}
+
+static const struct ip_set_type_variant hash_ipport_variant = {
+	.kadt	= hash_ipport_kadt,
+	.uadt	= hash_ipport_uadt,
+	.resize	= ahash_resize,
+	.destroy = ahash_destroy,
+	.flush	= ahash_flush,
+	.head	= ahash_head,
+	.list	= ahash_list,
+	.same_set = ahash_same_set,
+};
+
+static int
+hash_ipport_create(struct ip_set *set, struct nlattr *tb[], u32 flags)
+{
+	return ahash_create(set, tb, hash_ipport_dsize(set->family), false,
+			    &hash_ipport_variant,
+			    set->family == NFPROTO_IPV4 ?
+			    hash_ipport4_data_list : hash_ipport6_data_list);
+}
+
+static struct ip_set_type hash_ipport_type __read_mostly = {
+	.name		= "hash:ip,port",
+	.protocol	= IPSET_PROTOCOL,
+	.features	= IPSET_TYPE_IP | IPSET_TYPE_PORT,
+	.dimension	= IPSET_DIM_TWO,
+	.family		= NFPROTO_UNSPEC,
+	.revision	= 0,
+	.create		= hash_ipport_create,
+	.create_policy	= {
+		[IPSET_ATTR_HASHSIZE]	= { .type = NLA_U32 },
+		[IPSET_ATTR_MAXELEM]	= { .type = NLA_U32 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+	},
+	.adt_policy	= {
+		[IPSET_ATTR_IP]		= { .type = NLA_NESTED },
+		[IPSET_ATTR_IP_TO]	= { .type = NLA_NESTED },
+		[IPSET_ATTR_CIDR]	= { .type = NLA_U8 },
+		[IPSET_ATTR_PORT]	= { .type = NLA_U16 },
+		[IPSET_ATTR_PORT_TO]	= { .type = NLA_U16 },
+		[IPSET_ATTR_PROTO]	= { .type = NLA_U8 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+		[IPSET_ATTR_LINENO]	= { .type = NLA_U32 },
+	},
+	.me		= THIS_MODULE,
+};
+
+static int __init
+hash_ipport_init(void)
+{
+	return ip_set_type_register(&hash_ipport_type);
+}
+
+static void __exit
+hash_ipport_fini(void)
+{
+	ip_set_type_unregister(&hash_ipport_type);
+	/* Wait for the buckets freed by call_rcu_bh() */
+	rcu_barrier_bh();
+}
+
+module_init(hash_ipport_init);
+module_exit(hash_ipport_fini);
@@ -0,0 +1,231 @@
+/* Kernel module implementing an IP set type: the hash:net type
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/ip.h>
+#include <linux/skbuff.h>
+#include <linux/errno.h>
+#include <linux/netlink.h>
+#include <linux/rcupdate.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+#include <net/netlink.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/ipset/ip_set.h>
+#include <linux/netfilter/ipset/ip_set_hash.h>
+#include <linux/netfilter/ipset/ip_set_ahash.h>
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("hash:net type of IP sets");
+MODULE_ALIAS("ip_set_hash:net");
+
+/* The key is the prefix length followed by the masked address.  The
+ * prefix length comes first so that the hash engine can keep track of
+ * the number of elements per prefix length in h->nets.
+ */
+struct hash_net_elem {
+	u8 cidr;
+	u8 padding[3];
+	union nf_inet_addr ip;
+};
+
+#define hash_net_dsize(family)						\
+	(offsetof(struct hash_net_elem, ip) +				\
+	 ((family) == NFPROTO_IPV4 ? sizeof(__be32) : sizeof(struct in6_addr)))
+
+#define hash_net_maxcidr(family)	((family) == NFPROTO_IPV4 ? 32 : 128)
+
+static inline void
+hash_net_netmask(struct hash_net_elem *e, u8 family, u8 cidr)
+{
+	e->cidr = cidr;
+	if (family == NFPROTO_IPV4)
+		e->ip.ip &= ip_set_netmask(cidr);
+	else
+		ip6_netmask(&e->ip, cidr);
+}
+
+static int
+hash_net4_data_list(struct sk_buff *skb, const void *data)
+{
+	const struct hash_net_elem *e = data;
+
+	NLA_PUT_IPADDR4(skb, IPSET_ATTR_IP, e->ip.ip);
+	NLA_PUT_U8(skb, IPSET_ATTR_CIDR, e->cidr);
+	return 0;
+
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+static int
+hash_net6_data_list(struct sk_buff *skb, const void *data)
+{
+	const struct hash_net_elem *e = data;
+
+	NLA_PUT_IPADDR6(skb, IPSET_ATTR_IP, &e->ip.in6);
+	NLA_PUT_U8(skb, IPSET_ATTR_CIDR, e->cidr);
+	return 0;
+
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+/* Test the address against the stored networks, from the most
+ * specific prefix length to the least specific one.  Only the prefix
+ * lengths having elements in the set are tried.
+ */
+static int
+hash_net_test(struct ip_set *set, const union nf_inet_addr *ip)
+{
+	const struct ip_set_hash *h = set->data;
+	struct hash_net_elem e = {};
+	int cidr;
+
+	for (cidr = hash_net_maxcidr(set->family); cidr > 0; cidr--) {
+		if (!h->nets[cidr])
+			continue;
+		e.ip = *ip;
+		hash_net_netmask(&e, set->family, cidr);
+		if (ahash_test(set, &e))
+			return 1;
+	}
+	return 0;
+}
+
+static int
+hash_net_kadt(struct ip_set *set, const struct sk_buff *skb,
+	      enum ipset_adt adt, u8 pf, u8 dim, u8 flags)
+{
+	const struct ip_set_hash *h = set->data;
+	struct hash_net_elem e = {};
+
+	if (pf == NFPROTO_IPV4)
+		ip4addrptr(skb, flags & IPSET_DIM_ONE_SRC, &e.ip.ip);
+	else
+		ip6addrptr(skb, flags & IPSET_DIM_ONE_SRC, &e.ip.in6);
+
+	if (adt == IPSET_TEST)
+		return hash_net_test(set, &e.ip);
+
+	/* Packets are added/deleted as host entries */
+	e.cidr = hash_net_maxcidr(set->family);
+	if (adt == IPSET_ADD)
+		return ahash_add(set, &e, h->timeout, 0);
+	return ahash_del(set, &e);
+}
+
+static int
+hash_net_uadt(struct ip_set *set, struct nlattr *tb[],
+	      enum ipset_adt adt, u32 flags, bool retried)
+{
+	const struct ip_set_hash *h = set->data;
+	struct hash_net_elem e = {};
+	u32 timeout = h->timeout;
+	u8 cidr = hash_net_maxcidr(set->family);
+	int ret;
+
+	if (unlikely(!tb[IPSET_ATTR_IP] ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_TIMEOUT)))
+		return -IPSET_ERR_PROTOCOL;
+
+	if (set->family == NFPROTO_IPV4)
+		ret = ip_set_get_ipaddr4(tb[IPSET_ATTR_IP], &e.ip.ip);
+	else
+		ret = ip_set_get_ipaddr6(tb[IPSET_ATTR_IP], &e.ip);
+	if (ret)
+		return ret;
+
+	if (tb[IPSET_ATTR_CIDR]) {
+		cidr = nla_get_u8(tb[IPSET_ATTR_CIDR]);
+		if (!cidr || cidr > hash_net_maxcidr(set->family))
+			return -IPSET_ERR_INVALID_CIDR;
+	}
+	hash_net_netmask(&e, set->family, cidr);
+
+	if (tb[IPSET_ATTR_TIMEOUT]) {
+		if (!with_timeout(h->timeout))
+			return -IPSET_ERR_TIMEOUT;
+		timeout = ip_set_timeout_uget(tb[IPSET_ATTR_TIMEOUT]);
+	}
+
+	switch (adt) {
+	case IPSET_TEST:
+		/* A network is tested as itself, an address as any
+		 * network containing it
+		 */
+		if (tb[IPSET_ATTR_CIDR])
+			return ahash_test(set, &e);
+		return hash_net_test(set, &e.ip);
+	case IPSET_ADD:
+		return ahash_add(set, &e, timeout, flags);
+	case IPSET_DEL:
+		return ahash_del(set, &e);
+	default:
+		return -EINVAL;
+	}
+}
+
+static const struct ip_set_type_variant hash_net_variant = {
+	.kadt	= hash_net_kadt,
+	.uadt	= hash_net_uadt,
+	.resize	= ahash_resize,
+	.destroy = ahash_destroy,
+	.flush	= ahash_flush,
+	.head	= ahash_head,
+	.list	= ahash_list,
+	.same_set = ahash_same_set,
+};
+
+static int
+hash_net_create(struct ip_set *set, struct nlattr *tb[], u32 flags)
+{
+	return ahash_create(set, tb, hash_net_dsize(set->family), true,
+			    &hash_net_variant,
+			    set->family == NFPROTO_IPV4 ?
+			    hash_net4_data_list : hash_net6_data_list);
+}
+
+static struct ip_set_type hash_net_type __read_mostly = {
+	.name		= "hash:net",
+	.protocol	= IPSET_PROTOCOL,
+	.features	= IPSET_TYPE_IP,
+	.dimension	= IPSET_DIM_ONE,
+	.family		= NFPROTO_UNSPEC,
+	.revision	= 0,
+	.create		= hash_net_create,
+	.create_policy	= {
+		[IPSET_ATTR_HASHSIZE]	= { .type = NLA_U32 },
+		[IPSET_ATTR_MAXELEM]	= { .type = NLA_U32 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+	},
+	.adt_policy	= {
+		[IPSET_ATTR_IP]		= { .type = NLA_NESTED },
+		[IPSET_ATTR_CIDR]	= { .type = NLA_U8 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+		[IPSET_ATTR_LINENO]	= { .type = NLA_U32 },
+	},
+	.me		= THIS_MODULE,
+};
+
+static int __init
+hash_net_init(void)
+{
+	return ip_set_type_register(&hash_net_type);
+}
+
+static void __exit
+hash_net_fini(void)
+{
+	ip_set_type_unregister(&hash_net_type);
+	/* Wait for the buckets freed by call_rcu_bh() */
+	rcu_barrier_bh();
+}
+
+module_init(hash_net_init);
+module_exit(hash_net_fini);
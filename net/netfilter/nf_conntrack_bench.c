@@ -0,0 +1,182 @@
+/*
+ * Connection tracking setup rate benchmark.
+ *
+ * Feeds nflows UDP packets with distinct tuples through nf_conntrack_in()
+ * and nf_conntrack_confirm(), as the PRE_ROUTING and POST_ROUTING hooks
+ * would, then kills all the resulting conntracks and reports the cost of
+ * both phases.  Loading the module runs the benchmark once and fails with
+ * -EAGAIN so it does not stay resident, e.g.
+ *
+ *	modprobe nf_conntrack_bench nflows=200000; dmesg | tail -2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/skbuff.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/vmalloc.h>
+#include <linux/sched.h>
+#include <linux/netfilter.h>
+#include <net/net_namespace.h>
+#include <net/ip.h>
+
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_core.h>
+#include <net/netfilter/ipv4/nf_conntrack_ipv4.h>
+
+static unsigned int nflows __read_mostly = 100000;
+module_param(nflows, uint, 0400);
+MODULE_PARM_DESC(nflows, "number of connections to set up (default 100000)");
+
+/* Source addresses come from the 198.18.0.0/15 benchmarking range. */
+#define BENCH_SADDR	0xc6120000	/* 198.18.0.0 */
+#define BENCH_DADDR	0xc6130001	/* 198.19.0.1 */
+#define BENCH_PORTS	16384
+
+static struct sk_buff *nf_ct_bench_alloc_skb(void)
+{
+	struct sk_buff *skb;
+	struct iphdr *iph;
+	struct udphdr *uh;
+
+	skb = alloc_skb(sizeof(*iph) + sizeof(*uh), GFP_KERNEL);
+	if (skb == NULL)
+		return NULL;
+
+	skb_reset_network_header(skb);
+	iph = (struct iphdr *)skb_put(skb, sizeof(*iph));
+	iph->version	= 4;
+	iph->ihl	= sizeof(*iph) >> 2;
+	iph->tos	= 0;
+	iph->tot_len	= htons(sizeof(*iph) + sizeof(*uh));
+	iph->id		= 0;
+	iph->frag_off	= htons(IP_DF);
+	iph->ttl	= 64;
+	iph->protocol	= IPPROTO_UDP;
+	iph->daddr	= htonl(BENCH_DADDR);
+
+	skb_set_transport_header(skb, skb->len);
+	uh = (struct udphdr *)skb_put(skb, sizeof(*uh));
+	uh->dest	= htons(9);
+	uh->len		= htons(sizeof(*uh));
+	uh->check	= 0;
+
+	skb->protocol	= htons(ETH_P_IP);
+	skb->ip_summed	= CHECKSUM_UNNECESSARY;
+	return skb;
+}
+
+/* Rewrite the source of the template packet to describe flow n. */
+static void nf_ct_bench_set_flow(struct sk_buff *skb, unsigned int n)
+{
+	struct iphdr *iph = ip_hdr(skb);
+
+	iph->saddr = htonl(BENCH_SADDR + n / BENCH_PORTS);
+	iph->check = 0;
+	iph->check = ip_fast_csum((unsigned char *)iph, iph->ihl);
+	udp_hdr(skb)->source = htons(1024 + n % BENCH_PORTS);
+}
+
+/* Returns the confirmed conntrack for the packet, holding a reference. */
+static struct nf_conn *nf_ct_bench_setup(struct sk_buff *skb)
+{
+	struct nf_conn *ct = NULL;
+
+	rcu_read_lock();
+	local_bh_disable();
+	if (nf_conntrack_in(&init_net, PF_INET, NF_INET_PRE_ROUTING,
+			    skb) == NF_ACCEPT &&
+	    nf_conntrack_confirm(skb) == NF_ACCEPT)
+		ct = (struct nf_conn *)skb->nfct;
+	local_bh_enable();
+	rcu_read_unlock();
+
+	/* steal the packet's reference, the template skb gets reused */
+	if (ct == NULL)
+		nf_conntrack_put(skb->nfct);
+	skb->nfct = NULL;
+	return ct;
+}
+
+static void nf_ct_bench_report(const char *what, unsigned int n, s64 ns)
+{
+	u64 rate = 0;
+
+	if (ns > 0)
+		rate = div64_u64((u64)n * NSEC_PER_SEC, ns);
+	printk(KERN_INFO "nf_conntrack_bench: %s %u flows in %lld ns, "
+	       "%lld ns/flow, %llu flows/s\n", what, n, ns,
+	       n ? div64_s64(ns, n) : 0, rate);
+}
+
+static int __init nf_conntrack_bench_init(void)
+{
+	struct nf_conn **cts;
+	struct sk_buff *skb;
+	unsigned int i, n;
+	ktime_t start;
+	s64 ns;
+
+	need_ipv4_conntrack();
+
+	if (nflows == 0)
+		return -EINVAL;
+
+	cts = vmalloc(nflows * sizeof(*cts));
+	if (cts == NULL)
+		return -ENOMEM;
+
+	skb = nf_ct_bench_alloc_skb();
+	if (skb == NULL) {
+		vfree(cts);
+		return -ENOMEM;
+	}
+
+	start = ktime_get();
+	for (n = 0; n < nflows; n++) {
+		nf_ct_bench_set_flow(skb, n);
+		cts[n] = nf_ct_bench_setup(skb);
+		if (cts[n] == NULL)
+			break;
+		if ((n & 1023) == 1023)
+			cond_resched();
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	kfree_skb(skb);
+
+	if (n < nflows)
+		printk(KERN_WARNING "nf_conntrack_bench: flow %u not "
+		       "confirmed, is nf_conntrack_max too low?\n", n);
+	nf_ct_bench_report("set up", n, ns);
+
+	start = ktime_get();
+	for (i = 0; i < n; i++) {
+		nf_ct_kill(cts[i]);
+		nf_ct_put(cts[i]);
+		if ((i & 1023) == 1023)
+			cond_resched();
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	nf_ct_bench_report("tore down", n, ns);
+
+	vfree(cts);
+	return -EAGAIN;
+}
+
+static void __exit nf_conntrack_bench_exit(void)
+{
+}
+
+module_init(nf_conntrack_bench_init);
+module_exit(nf_conntrack_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Connection tracking setup rate benchmark");
@@ -0,0 +1,935 @@
+/*
+ * nf_tables netlink interface: loading, validating and replacing rulesets
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * A ruleset is compiled in userspace and sent as a whole.  It is checked
+ * here once, translated into the flat instruction arrays the interpreter
+ * in nf_tables_core.c runs, and then published with a single pointer
+ * update per address family and network namespace.  Packets in flight
+ * keep using the old ruleset until the RCU grace period ends.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/list.h>
+#include <linux/skbuff.h>
+#include <linux/netdevice.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+#include <net/netlink.h>
+#include <net/net_namespace.h>
+#include <net/sock.h>
+#include <net/netns/generic.h>
+#include <net/netfilter/nf_tables.h>
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("nf_tables packet classification engine");
+MODULE_ALIAS_NFNL_SUBSYS(NFNL_SUBSYS_NFTABLES);
+
+struct nft_net {
+	struct nft_ruleset __rcu	*ruleset[NFPROTO_NUMPROTO];
+	u32				generation;
+};
+
+static int nft_net_id __read_mostly;
+
+/* Registered address families, protected by the nfnetlink mutex */
+static LIST_HEAD(nft_afinfo);
+
+int nft_register_afinfo(struct nft_af_info *afi)
+{
+	unsigned int h;
+
+	for (h = 0; h < NF_INET_NUMHOOKS; h++) {
+		afi->ops[h].hook	= afi->hook;
+		afi->ops[h].owner	= afi->owner;
+		afi->ops[h].pf		= afi->family;
+		afi->ops[h].hooknum	= h;
+		afi->ops[h].priority	= NF_IP_PRI_FILTER;
+		afi->hook_use[h]	= 0;
+	}
+
+	nfnl_lock();
+	list_add_tail(&afi->list, &nft_afinfo);
+	nfnl_unlock();
+	return 0;
+}
+EXPORT_SYMBOL_GPL(nft_register_afinfo);
+
+void nft_unregister_afinfo(struct nft_af_info *afi)
+{
+	nfnl_lock();
+	list_del(&afi->list);
+	nfnl_unlock();
+}
+EXPORT_SYMBOL_GPL(nft_unregister_afinfo);
+
+static struct nft_af_info *nft_afinfo_lookup(u8 family)
+{
+	struct nft_af_info *afi;
+
+	list_for_each_entry(afi, &nft_afinfo, list) {
+		if (afi->family == family)
+			return afi;
+	}
+	return NULL;
+}
+
+/* Called with the nfnetlink mutex held.  On success a reference to the
+ * family module is taken, it is dropped when the ruleset is destroyed.
+ */
+static struct nft_af_info *nft_afinfo_get(u8 family)
+{
+	struct nft_af_info *afi;
+
+	afi = nft_afinfo_lookup(family);
+	if (afi == NULL) {
+#ifdef CONFIG_MODULES
+		nfnl_unlock();
+		request_module("nft-afinfo-%u", family);
+		nfnl_lock();
+		if (nft_afinfo_lookup(family) != NULL)
+			return ERR_PTR(-EAGAIN);
+#endif
+		return ERR_PTR(-EAFNOSUPPORT);
+	}
+	if (!try_module_get(afi->owner))
+		return ERR_PTR(-EAFNOSUPPORT);
+	return afi;
+}
+
+unsigned int nft_do_chain_pkt(const struct nft_pktinfo *pkt)
+{
+	const struct net_device *dev = pkt->in ? pkt->in : pkt->out;
+	const struct nft_net *nn = net_generic(dev_net(dev), nft_net_id);
+	const struct nft_ruleset *rs;
+	const struct nft_chain *chain;
+
+	rs = rcu_dereference(nn->ruleset[pkt->family]);
+	if (rs == NULL)
+		return NF_ACCEPT;
+	chain = rs->base[pkt->hooknum];
+	if (chain == NULL)
+		return NF_ACCEPT;
+	return nft_do_chain(rs, chain, pkt);
+}
+EXPORT_SYMBOL_GPL(nft_do_chain_pkt);
+
+/*
+ * Ruleset memory.  Large chains and sets may not fit into a kmalloc()
+ * area, fall back to vmalloc() for those.
+ */
+
+static void *nft_alloc(size_t size)
+{
+	void *p;
+
+	if (size <= PAGE_SIZE << PAGE_ALLOC_COSTLY_ORDER) {
+		p = kzalloc(size, GFP_KERNEL | __GFP_NOWARN);
+		if (p != NULL)
+			return p;
+	}
+	return vzalloc(size);
+}
+
+static void nft_free(void *p)
+{
+	if (is_vmalloc_addr(p))
+		vfree(p);
+	else
+		kfree(p);
+}
+
+static void nft_ruleset_destroy(struct nft_ruleset *rs)
+{
+	unsigned int i;
+
+	if (rs->chains != NULL) {
+		for (i = 0; i < rs->nchains; i++)
+			nft_free(rs->chains[i].insns);
+		kfree(rs->chains);
+	}
+	if (rs->sets != NULL) {
+		for (i = 0; i < rs->nsets; i++)
+			nft_free(rs->sets[i].elems);
+		kfree(rs->sets);
+	}
+	module_put(rs->afi->owner);
+	kfree(rs);
+}
+
+static unsigned int nft_ruleset_hooks(const struct nft_ruleset *rs)
+{
+	unsigned int h, hooks = 0;
+
+	for (h = 0; h < NF_INET_NUMHOOKS; h++) {
+		if (rs->base[h] != NULL)
+			hooks |= 1 << h;
+	}
+	return hooks;
+}
+
+/*
+ * The hooks of a family are shared by the rulesets of all namespaces,
+ * they stay registered as long as one ruleset has a base chain there.
+ */
+
+static void nft_unbind_hooks(struct nft_af_info *afi, unsigned int hooks)
+{
+	unsigned int h;
+
+	for (h = 0; h < NF_INET_NUMHOOKS; h++) {
+		if (!(hooks & (1 << h)))
+			continue;
+		if (--afi->hook_use[h] == 0)
+			nf_unregister_hook(&afi->ops[h]);
+	}
+}
+
+static int nft_bind_hooks(struct nft_af_info *afi, unsigned int hooks)
+{
+	unsigned int h;
+	int err;
+
+	for (h = 0; h < NF_INET_NUMHOOKS; h++) {
+		if (!(hooks & (1 << h)))
+			continue;
+		if (afi->hook_use[h]++ > 0)
+			continue;
+		err = nf_register_hook(&afi->ops[h]);
+		if (err < 0) {
+			afi->hook_use[h]--;
+			nft_unbind_hooks(afi, hooks & ((1 << h) - 1));
+			return err;
+		}
+	}
+	return 0;
+}
+
+/* Called with the nfnetlink mutex held */
+static int nft_replace_ruleset(struct net *net, u8 family,
+			       struct nft_ruleset *rs)
+{
+	struct nft_net *nn = net_generic(net, nft_net_id);
+	struct nft_ruleset *old;
+	int err;
+
+	old = rcu_dereference_protected(nn->ruleset[family], 1);
+	if (rs != NULL) {
+		err = nft_bind_hooks(rs->afi, nft_ruleset_hooks(rs));
+		if (err < 0)
+			return err;
+		rs->generation = ++nn->generation;
+	}
+
+	rcu_assign_pointer(nn->ruleset[family], rs);
+
+	if (old != NULL) {
+		synchronize_rcu();
+		nft_unbind_hooks(old->afi, nft_ruleset_hooks(old));
+		nft_ruleset_destroy(old);
+	}
+	return 0;
+}
+
+/*
+ * Ruleset parsing
+ */
+
+static const struct nla_policy nft_ruleset_policy[NFTA_RULESET_MAX + 1] = {
+	[NFTA_RULESET_SETS]	= { .type = NLA_NESTED },
+	[NFTA_RULESET_CHAINS]	= { .type = NLA_NESTED },
+};
+
+static const struct nla_policy nft_set_policy[NFTA_SET_MAX + 1] = {
+	[NFTA_SET_KEY_LEN]	= { .type = NLA_U32 },
+	[NFTA_SET_ELEMENTS]	= { .type = NLA_NESTED },
+};
+
+static const struct nla_policy nft_chain_policy[NFTA_CHAIN_MAX + 1] = {
+	[NFTA_CHAIN_HOOK]	= { .type = NLA_U32 },
+	[NFTA_CHAIN_POLICY]	= { .type = NLA_U32 },
+	[NFTA_CHAIN_RULES]	= { .type = NLA_NESTED },
+};
+
+static const struct nla_policy nft_rule_policy[NFTA_RULE_MAX + 1] = {
+	[NFTA_RULE_EXPRESSIONS]	= { .type = NLA_NESTED },
+};
+
+static const struct nla_policy nft_expr_policy[NFTA_EXPR_MAX + 1] = {
+	[NFTA_EXPR_OP]		= { .type = NLA_U32 },
+	[NFTA_EXPR_SREG]	= { .type = NLA_U32 },
+	[NFTA_EXPR_DREG]	= { .type = NLA_U32 },
+	[NFTA_EXPR_LEN]		= { .type = NLA_U32 },
+	[NFTA_EXPR_BASE]	= { .type = NLA_U32 },
+	[NFTA_EXPR_OFFSET]	= { .type = NLA_U32 },
+	[NFTA_EXPR_KEY]		= { .type = NLA_U32 },
+	[NFTA_EXPR_CMP_OP]	= { .type = NLA_U32 },
+	[NFTA_EXPR_DATA]	= { .type = NLA_BINARY, .len = NFT_REG_SIZE },
+	[NFTA_EXPR_MASK]	= { .type = NLA_BINARY, .len = NFT_REG_SIZE },
+	[NFTA_EXPR_XOR]		= { .type = NLA_BINARY, .len = NFT_REG_SIZE },
+	[NFTA_EXPR_SET]		= { .type = NLA_U32 },
+	[NFTA_EXPR_VERDICT]	= { .type = NLA_U32 },
+	[NFTA_EXPR_CHAIN]	= { .type = NLA_U32 },
+};
+
+/* Number of NFTA_LIST_ELEM attributes in a list, -EINVAL on garbage */
+static int nft_list_count(const struct nlattr *list)
+{
+	const struct nlattr *attr;
+	int rem, n = 0;
+
+	if (list == NULL)
+		return 0;
+	nla_for_each_nested(attr, list, rem) {
+		if (nla_type(attr) != NFTA_LIST_ELEM)
+			return -EINVAL;
+		n++;
+	}
+	return n;
+}
+
+/* Per rule parser state: the number of valid bytes in each register */
+struct nft_ctx {
+	struct nft_ruleset	*rs;
+	u8			reglen[NFT_REG_MAX + 1];
+};
+
+static int nft_get_u32(const struct nlattr *attr, u32 *val)
+{
+	if (attr == NULL)
+		return -EINVAL;
+	*val = ntohl(nla_get_be32(attr));
+	return 0;
+}
+
+static int nft_get_reg(const struct nlattr *attr, u8 *reg)
+{
+	u32 val;
+
+	if (nft_get_u32(attr, &val) < 0 || val > NFT_REG_MAX)
+		return -EINVAL;
+	*reg = val;
+	return 0;
+}
+
+static int nft_get_sreg(const struct nft_ctx *ctx, const struct nlattr *attr,
+			struct nft_insn *insn)
+{
+	if (nft_get_reg(attr, &insn->sreg) < 0)
+		return -EINVAL;
+	/* Registers are not preserved across rules */
+	if (ctx->reglen[insn->sreg] < insn->len)
+		return -EINVAL;
+	return 0;
+}
+
+static int nft_get_data(const struct nlattr *attr, u32 *data, unsigned int len)
+{
+	if (attr == NULL || nla_len(attr) != len)
+		return -EINVAL;
+	memcpy(data, nla_data(attr), len);
+	return 0;
+}
+
+static const u8 nft_meta_len[NFT_META_MAX + 1] = {
+	[NFT_META_LEN]		= sizeof(u32),
+	[NFT_META_PROTOCOL]	= sizeof(__be16),
+	[NFT_META_L4PROTO]	= sizeof(u8),
+	[NFT_META_PRIORITY]	= sizeof(u32),
+	[NFT_META_MARK]		= sizeof(u32),
+	[NFT_META_IIF]		= sizeof(u32),
+	[NFT_META_OIF]		= sizeof(u32),
+	[NFT_META_IIFNAME]	= IFNAMSIZ,
+	[NFT_META_OIFNAME]	= IFNAMSIZ,
+};
+
+static int nft_verdict_init(const struct nft_ctx *ctx, struct nft_insn *insn,
+			    struct nlattr * const tb[])
+{
+	u32 code, chain;
+
+	if (nft_get_u32(tb[NFTA_EXPR_VERDICT], &code) < 0)
+		return -EINVAL;
+
+	switch ((int)code) {
+	case NF_ACCEPT:
+	case NF_DROP:
+	case NFT_CONTINUE:
+	case NFT_RETURN:
+		break;
+	case NFT_JUMP:
+	case NFT_GOTO:
+		/* Base chains are checked once all chains are known */
+		if (nft_get_u32(tb[NFTA_EXPR_CHAIN], &chain) < 0 ||
+		    chain >= ctx->rs->nchains)
+			return -EINVAL;
+		insn->u.verdict.chain = chain;
+		break;
+	default:
+		return -EINVAL;
+	}
+	insn->u.verdict.code = code;
+	return 0;
+}
+
+static int nft_expr_init(struct nft_ctx *ctx, struct nft_insn *insn,
+			 const struct nlattr *attr)
+{
+	struct nlattr *tb[NFTA_EXPR_MAX + 1];
+	u32 val, set;
+	int err;
+
+	err = nla_parse_nested(tb, NFTA_EXPR_MAX, attr, nft_expr_policy);
+	if (err < 0)
+		return err;
+
+	if (nft_get_u32(tb[NFTA_EXPR_OP], &val) < 0)
+		return -EINVAL;
+	if (val > NFT_EXPR_MAX)
+		return -EOPNOTSUPP;
+	insn->op = val;
+
+	if (tb[NFTA_EXPR_LEN] != NULL) {
+		val = ntohl(nla_get_be32(tb[NFTA_EXPR_LEN]));
+		if (val == 0 || val > NFT_REG_SIZE)
+			return -EINVAL;
+		insn->len = val;
+	}
+
+	switch (insn->op) {
+	case NFT_EXPR_IMMEDIATE:
+		if (nft_get_reg(tb[NFTA_EXPR_DREG], &insn->dreg) < 0 ||
+		    nft_get_data(tb[NFTA_EXPR_DATA], insn->data, insn->len) < 0)
+			return -EINVAL;
+		break;
+	case NFT_EXPR_PAYLOAD:
+		if (nft_get_reg(tb[NFTA_EXPR_DREG], &insn->dreg) < 0 ||
+		    insn->len == 0)
+			return -EINVAL;
+		if (nft_get_u32(tb[NFTA_EXPR_BASE], &val) < 0 ||
+		    val > NFT_PAYLOAD_TRANSPORT_HEADER)
+			return -EINVAL;
+		insn->u.payload.base = val;
+		if (nft_get_u32(tb[NFTA_EXPR_OFFSET], &val) < 0 ||
+		    val > 0xffff)
+			return -EINVAL;
+		insn->u.payload.offset = val;
+		break;
+	case NFT_EXPR_META:
+		if (nft_get_reg(tb[NFTA_EXPR_DREG], &insn->dreg) < 0)
+			return -EINVAL;
+		if (nft_get_u32(tb[NFTA_EXPR_KEY], &val) < 0)
+			return -EINVAL;
+		if (val > NFT_META_MAX)
+			return -EOPNOTSUPP;
+		if (tb[NFTA_EXPR_LEN] != NULL && insn->len != nft_meta_len[val])
+			return -EINVAL;
+		insn->u.key = val;
+		insn->len = nft_meta_len[val];
+		break;
+	case NFT_EXPR_CMP:
+		if (insn->len == 0 ||
+		    nft_get_sreg(ctx, tb[NFTA_EXPR_SREG], insn) < 0 ||
+		    nft_get_data(tb[NFTA_EXPR_DATA], insn->data, insn->len) < 0)
+			return -EINVAL;
+		if (nft_get_u32(tb[NFTA_EXPR_CMP_OP], &val) < 0 ||
+		    val > NFT_CMP_GTE)
+			return -EINVAL;
+		insn->cmp_op = val;
+		break;
+	case NFT_EXPR_BITWISE:
+		if (insn->len == 0 ||
+		    nft_get_sreg(ctx, tb[NFTA_EXPR_SREG], insn) < 0 ||
+		    nft_get_reg(tb[NFTA_EXPR_DREG], &insn->dreg) < 0 ||
+		    nft_get_data(tb[NFTA_EXPR_MASK], insn->data, insn->len) < 0 ||
+		    nft_get_data(tb[NFTA_EXPR_XOR], insn->xor, insn->len) < 0)
+			return -EINVAL;
+		break;
+	case NFT_EXPR_LOOKUP:
+		if (nft_get_u32(tb[NFTA_EXPR_SET], &set) < 0 ||
+		    set >= ctx->rs->nsets)
+			return -EINVAL;
+		insn->u.set = &ctx->rs->sets[set];
+		if (tb[NFTA_EXPR_LEN] != NULL && insn->len != insn->u.set->klen)
+			return -EINVAL;
+		insn->len = insn->u.set->klen;
+		if (nft_get_sreg(ctx, tb[NFTA_EXPR_SREG], insn) < 0)
+			return -EINVAL;
+		val = NFT_CMP_EQ;
+		if (tb[NFTA_EXPR_CMP_OP] != NULL)
+			val = ntohl(nla_get_be32(tb[NFTA_EXPR_CMP_OP]));
+		if (val != NFT_CMP_EQ && val != NFT_CMP_NEQ)
+			return -EINVAL;
+		insn->cmp_op = val;
+		break;
+	case NFT_EXPR_VERDICT:
+		err = nft_verdict_init(ctx, insn, tb);
+		if (err < 0)
+			return err;
+		break;
+	}
+
+	switch (insn->op) {
+	case NFT_EXPR_IMMEDIATE:
+	case NFT_EXPR_PAYLOAD:
+	case NFT_EXPR_META:
+	case NFT_EXPR_BITWISE:
+		ctx->reglen[insn->dreg] = insn->len;
+		break;
+	}
+	return 0;
+}
+
+/* Returns the number of instructions of the rule, NFT_OP_RULE included */
+static int nft_rule_size(const struct nlattr *attr)
+{
+	struct nlattr *tb[NFTA_RULE_MAX + 1];
+	int err, n;
+
+	err = nla_parse_nested(tb, NFTA_RULE_MAX, attr, nft_rule_policy);
+	if (err < 0)
+		return err;
+	n = nft_list_count(tb[NFTA_RULE_EXPRESSIONS]);
+	if (n < 0)
+		return n;
+	if (n > NFT_RULE_MAXEXPRS)
+		return -E2BIG;
+	return 1 + n;
+}
+
+static int nft_rule_init(struct nft_ruleset *rs, struct nft_insn *insns,
+			 unsigned int pc, const struct nlattr *attr)
+{
+	struct nlattr *tb[NFTA_RULE_MAX + 1];
+	const struct nlattr *expr;
+	struct nft_ctx ctx = { .rs = rs };
+	unsigned int start = pc;
+	int err, rem;
+
+	err = nla_parse_nested(tb, NFTA_RULE_MAX, attr, nft_rule_policy);
+	if (err < 0)
+		return err;
+
+	insns[pc++].op = NFT_OP_RULE;
+	if (tb[NFTA_RULE_EXPRESSIONS] != NULL) {
+		nla_for_each_nested(expr, tb[NFTA_RULE_EXPRESSIONS], rem) {
+			/* Anything after a verdict could never run */
+			if (pc > start + 1 &&
+			    insns[pc - 1].op == NFT_EXPR_VERDICT)
+				return -EINVAL;
+			err = nft_expr_init(&ctx, &insns[pc], expr);
+			if (err < 0)
+				return err;
+			pc++;
+		}
+	}
+	insns[start].u.next = pc;
+	rs->nrules++;
+	return pc;
+}
+
+static int nft_chain_init(struct nft_ruleset *rs, struct nft_chain *chain,
+			  const struct nlattr *attr)
+{
+	struct nlattr *tb[NFTA_CHAIN_MAX + 1];
+	const struct nlattr *rule;
+	unsigned int n = 0;
+	u32 val;
+	int err, rem;
+
+	err = nla_parse_nested(tb, NFTA_CHAIN_MAX, attr, nft_chain_policy);
+	if (err < 0)
+		return err;
+
+	chain->hook = -1;
+	chain->policy = NF_ACCEPT;
+	if (tb[NFTA_CHAIN_HOOK] != NULL) {
+		val = ntohl(nla_get_be32(tb[NFTA_CHAIN_HOOK]));
+		if (val >= NF_INET_NUMHOOKS || !(rs->afi->hooks & (1 << val)))
+			return -EOPNOTSUPP;
+		if (rs->base[val] != NULL)
+			return -EEXIST;
+		rs->base[val] = chain;
+		chain->hook = val;
+	}
+	if (tb[NFTA_CHAIN_POLICY] != NULL) {
+		if (chain->hook < 0)
+			return -EINVAL;
+		val = ntohl(nla_get_be32(tb[NFTA_CHAIN_POLICY]));
+		if (val != NF_ACCEPT && val != NF_DROP)
+			return -EINVAL;
+		chain->policy = val;
+	}
+
+	if (tb[NFTA_CHAIN_RULES] == NULL)
+		return 0;
+	err = nft_list_count(tb[NFTA_CHAIN_RULES]);
+	if (err < 0)
+		return err;
+	nla_for_each_nested(rule, tb[NFTA_CHAIN_RULES], rem) {
+		err = nft_rule_size(rule);
+		if (err < 0)
+			return err;
+		n += err;
+	}
+	if (n == 0)
+		return 0;
+
+	chain->insns = nft_alloc(n * sizeof(struct nft_insn));
+	if (chain->insns == NULL)
+		return -ENOMEM;
+
+	n = 0;
+	nla_for_each_nested(rule, tb[NFTA_CHAIN_RULES], rem) {
+		err = nft_rule_init(rs, chain->insns, n, rule);
+		if (err < 0)
+			return err;
+		n = err;
+	}
+	chain->ninsns = n;
+	return 0;
+}
+
+static int nft_set_init(struct nft_set *set, const struct nlattr *attr)
+{
+	struct nlattr *tb[NFTA_SET_MAX + 1];
+	const struct nlattr *elem;
+	u8 *key;
+	u32 klen;
+	int err, n, rem;
+
+	err = nla_parse_nested(tb, NFTA_SET_MAX, attr, nft_set_policy);
+	if (err < 0)
+		return err;
+	if (nft_get_u32(tb[NFTA_SET_KEY_LEN], &klen) < 0 ||
+	    klen == 0 || klen > NFT_REG_SIZE)
+		return -EINVAL;
+	set->klen = klen;
+
+	n = nft_list_count(tb[NFTA_SET_ELEMENTS]);
+	if (n <= 0)
+		return n;
+
+	set->elems = nft_alloc(n * klen);
+	if (set->elems == NULL)
+		return -ENOMEM;
+
+	/* Userspace sends the keys sorted, so lookups can bisect */
+	key = set->elems;
+	nla_for_each_nested(elem, tb[NFTA_SET_ELEMENTS], rem) {
+		if (nla_len(elem) != klen)
+			return -EINVAL;
+		memcpy(key, nla_data(elem), klen);
+		if (key != set->elems && memcmp(key - klen, key, klen) >= 0)
+			return -EINVAL;
+		key += klen;
+	}
+	set->nelems = n;
+	return 0;
+}
+
+enum {
+	NFT_CHAIN_UNSEEN,
+	NFT_CHAIN_ACTIVE,
+	NFT_CHAIN_DONE,
+};
+
+/* Reject loops, jumps to base chains and chains nested deeper than the
+ * interpreter's jump stack.  Returns the depth of the chain.  Gotos are
+ * counted as well, which bounds the recursion here.
+ */
+static int nft_chain_validate(const struct nft_ruleset *rs, unsigned int i,
+			      unsigned int level, u8 *state, u8 *depth)
+{
+	const struct nft_chain *chain = &rs->chains[i];
+	const struct nft_insn *insn;
+	unsigned int pc;
+	int d = 0, err;
+
+	if (state[i] == NFT_CHAIN_DONE)
+		return depth[i];
+	if (state[i] == NFT_CHAIN_ACTIVE)
+		return -ELOOP;
+	if (level > NFT_JUMP_STACK_SIZE)
+		return -EMLINK;
+	state[i] = NFT_CHAIN_ACTIVE;
+
+	for (pc = 0; pc < chain->ninsns; pc++) {
+		insn = &chain->insns[pc];
+		if (insn->op != NFT_EXPR_VERDICT ||
+		    (insn->u.verdict.code != NFT_JUMP &&
+		     insn->u.verdict.code != NFT_GOTO))
+			continue;
+
+		if (rs->chains[insn->u.verdict.chain].hook >= 0)
+			return -EINVAL;
+		err = nft_chain_validate(rs, insn->u.verdict.chain,
+					 level + 1, state, depth);
+		if (err < 0)
+			return err;
+		if (++err > NFT_JUMP_STACK_SIZE)
+			return -EMLINK;
+		d = max(d, err);
+	}
+
+	state[i] = NFT_CHAIN_DONE;
+	depth[i] = d;
+	return d;
+}
+
+static int nft_ruleset_validate(const struct nft_ruleset *rs)
+{
+	unsigned int h;
+	u8 *state;
+	int err = 0;
+
+	state = kzalloc(rs->nchains * 2, GFP_KERNEL);
+	if (state == NULL)
+		return -ENOMEM;
+
+	for (h = 0; h < NF_INET_NUMHOOKS; h++) {
+		if (rs->base[h] == NULL)
+			continue;
+		err = nft_chain_validate(rs, rs->base[h] - rs->chains, 0,
+					 state, state + rs->nchains);
+		if (err < 0)
+			break;
+	}
+	kfree(state);
+	return err < 0 ? err : 0;
+}
+
+static struct nft_ruleset *nft_ruleset_init(struct nft_af_info *afi,
+					    const struct nlattr * const cda[])
+{
+	struct nft_ruleset *rs;
+	const struct nlattr *attr;
+	unsigned int i;
+	int err, n, rem;
+
+	rs = kzalloc(sizeof(*rs), GFP_KERNEL);
+	if (rs == NULL) {
+		module_put(afi->owner);
+		return ERR_PTR(-ENOMEM);
+	}
+	rs->afi = afi;
+
+	n = nft_list_count(cda[NFTA_RULESET_SETS]);
+	if (n < 0) {
+		err = n;
+		goto err;
+	}
+	if (n > 0) {
+		err = -ENOMEM;
+		rs->sets = kcalloc(n, sizeof(struct nft_set), GFP_KERNEL);
+		if (rs->sets == NULL)
+			goto err;
+		rs->nsets = n;
+
+		i = 0;
+		nla_for_each_nested(attr, cda[NFTA_RULESET_SETS], rem) {
+			err = nft_set_init(&rs->sets[i++], attr);
+			if (err < 0)
+				goto err;
+		}
+	}
+
+	n = nft_list_count(cda[NFTA_RULESET_CHAINS]);
+	if (n < 0) {
+		err = n;
+		goto err;
+	}
+	if (n > 0) {
+		err = -ENOMEM;
+		rs->chains = kcalloc(n, sizeof(struct nft_chain), GFP_KERNEL);
+		if (rs->chains == NULL)
+			goto err;
+		rs->nchains = n;
+
+		i = 0;
+		nla_for_each_nested(attr, cda[NFTA_RULESET_CHAINS], rem) {
+			err = nft_chain_init(rs, &rs->chains[i++], attr);
+			if (err < 0)
+				goto err;
+		}
+	}
+
+	err = nft_ruleset_validate(rs);
+	if (err < 0)
+		goto err;
+	return rs;
+
+err:
+	nft_ruleset_destroy(rs);
+	return ERR_PTR(err);
+}
+
+/*
+ * Netlink interface
+ */
+
+static int nf_tables_newruleset(struct sock *nl, struct sk_buff *skb,
+				const struct nlmsghdr *nlh,
+				const struct nlattr * const cda[])
+{
+	const struct nfgenmsg *nfmsg = nlmsg_data(nlh);
+	struct net *net = sock_net(skb->sk);
+	struct nft_af_info *afi;
+	struct nft_ruleset *rs;
+	int err;
+
+	afi = nft_afinfo_get(nfmsg->nfgen_family);
+	if (IS_ERR(afi))
+		return PTR_ERR(afi);
+
+	rs = nft_ruleset_init(afi, cda);
+	if (IS_ERR(rs))
+		return PTR_ERR(rs);
+
+	err = nft_replace_ruleset(net, afi->family, rs);
+	if (err < 0)
+		nft_ruleset_destroy(rs);
+	return err;
+}
+
+static int nf_tables_delruleset(struct sock *nl, struct sk_buff *skb,
+				const struct nlmsghdr *nlh,
+				const struct nlattr * const cda[])
+{
+	const struct nfgenmsg *nfmsg = nlmsg_data(nlh);
+	struct nft_net *nn = net_generic(sock_net(skb->sk), nft_net_id);
+	u8 family = nfmsg->nfgen_family;
+
+	if (family >= NFPROTO_NUMPROTO ||
+	    rcu_dereference_protected(nn->ruleset[family], 1) == NULL)
+		return -ENOENT;
+	return nft_replace_ruleset(sock_net(skb->sk), family, NULL);
+}
+
+static int nf_tables_getruleset(struct sock *nl, struct sk_buff *skb,
+				const struct nlmsghdr *nlh,
+				const struct nlattr * const cda[])
+{
+	const struct nfgenmsg *nfmsg = nlmsg_data(nlh);
+	struct nft_net *nn = net_generic(sock_net(skb->sk), nft_net_id);
+	const struct nft_ruleset *rs;
+	struct nlmsghdr *nlh2;
+	struct nfgenmsg *nfmsg2;
+	struct sk_buff *skb2;
+	u8 family = nfmsg->nfgen_family;
+	int err;
+
+	if (family >= NFPROTO_NUMPROTO)
+		return -ENOENT;
+	rs = rcu_dereference_protected(nn->ruleset[family], 1);
+	if (rs == NULL)
+		return -ENOENT;
+
+	skb2 = nlmsg_new(NLMSG_DEFAULT_SIZE, GFP_KERNEL);
+	if (skb2 == NULL)
+		return -ENOMEM;
+
+	nlh2 = nlmsg_put(skb2, NETLINK_CB(skb).pid, nlh->nlmsg_seq,
+			 (NFNL_SUBSYS_NFTABLES << 8) | NFT_MSG_NEWRULESET,
+			 sizeof(*nfmsg2), 0);
+	if (nlh2 == NULL)
+		goto nlmsg_failure;
+	nfmsg2 = nlmsg_data(nlh2);
+	nfmsg2->nfgen_family = family;
+	nfmsg2->version = NFNETLINK_V0;
+	nfmsg2->res_id = 0;
+
+	NLA_PUT_BE32(skb2, NFTA_RULESET_GENERATION, htonl(rs->generation));
+	NLA_PUT_BE32(skb2, NFTA_RULESET_NCHAINS, htonl(rs->nchains));
+	NLA_PUT_BE32(skb2, NFTA_RULESET_NRULES, htonl(rs->nrules));
+	nlmsg_end(skb2, nlh2);
+
+	err = netlink_unicast(nl, skb2, NETLINK_CB(skb).pid, MSG_DONTWAIT);
+	return err < 0 ? err : 0;
+
+nla_put_failure:
+	nlmsg_cancel(skb2, nlh2);
+nlmsg_failure:
+	kfree_skb(skb2);
+	return -EMSGSIZE;
+}
+
+static const struct nfnl_callback nf_tables_cb[NFT_MSG_MAX] = {
+	[NFT_MSG_NEWRULESET]	= {
+		.call		= nf_tables_newruleset,
+		.attr_count	= NFTA_RULESET_MAX,
+		.policy		= nft_ruleset_policy,
+	},
+	[NFT_MSG_GETRULESET]	= {
+		.call		= nf_tables_getruleset,
+		.attr_count	= NFTA_RULESET_MAX,
+		.policy		= nft_ruleset_policy,
+	},
+	[NFT_MSG_DELRULESET]	= {
+		.call		= nf_tables_delruleset,
+		.attr_count	= NFTA_RULESET_MAX,
+		.policy		= nft_ruleset_policy,
+	},
+};
+
+static struct nfnetlink_subsystem nf_tables_subsys __read_mostly = {
+	.name		= "nf_tables",
+	.subsys_id	= NFNL_SUBSYS_NFTABLES,
+	.cb_count	= NFT_MSG_MAX,
+	.cb		= nf_tables_cb,
+};
+
+static void __net_exit nf_tables_net_exit(struct net *net)
+{
+	struct nft_net *nn = net_generic(net, nft_net_id);
+	unsigned int family;
+
+	nfnl_lock();
+	for (family = 0; family < NFPROTO_NUMPROTO; family++) {
+		if (rcu_dereference_protected(nn->ruleset[family], 1) != NULL)
+			nft_replace_ruleset(net, family, NULL);
+	}
+	nfnl_unlock();
+}
+
+static struct pernet_operations nf_tables_net_ops = {
+	.exit	= nf_tables_net_exit,
+	.id	= &nft_net_id,
+	.size	= sizeof(struct nft_net),
+};
+
+static int __init nf_tables_module_init(void)
+{
+	int err;
+
+	err = register_pernet_subsys(&nf_tables_net_ops);
+	if (err < 0)
+		return err;
+
+	err = nfnetlink_subsys_register(&nf_tables_subsys);
+	if (err < 0) {
+		unregister_pernet_subsys(&nf_tables_net_ops);
+		return err;
+	}
+	return 0;
+}
+
+static void __exit nf_tables_module_exit(void)
+{
+	nfnetlink_subsys_unregister(&nf_tables_subsys);
+	unregister_pernet_subsys(&nf_tables_net_ops);
+}
+
+module_init(nf_tables_module_init);
+module_exit(nf_tables_module_exit);
@@ -0,0 +1,227 @@
+/*
+ * nf_tables interpreter
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * A chain is a flat array of instructions.  Every rule starts with an
+ * NFT_OP_RULE instruction holding the index of the next rule, so a rule
+ * that does not match is left with a single jump.  The ruleset was fully
+ * validated when it was loaded: register numbers, lengths, set and chain
+ * references and the jump depth need no checking here.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/skbuff.h>
+#include <linux/netdevice.h>
+#include <linux/string.h>
+#include <linux/netfilter.h>
+#include <net/netfilter/nf_tables.h>
+
+static bool nft_payload_eval(const struct nft_insn *insn, u32 *dest,
+			     const struct nft_pktinfo *pkt)
+{
+	const struct sk_buff *skb = pkt->skb;
+	const void *ptr;
+	int offset;
+
+	switch (insn->u.payload.base) {
+	case NFT_PAYLOAD_LL_HEADER:
+		if (!skb_mac_header_was_set(skb))
+			return false;
+		offset = skb_mac_header(skb) - skb->data;
+		break;
+	case NFT_PAYLOAD_NETWORK_HEADER:
+		offset = skb_network_offset(skb);
+		break;
+	default:
+		if (pkt->thoff < 0)
+			return false;
+		offset = pkt->thoff;
+		break;
+	}
+	offset += insn->u.payload.offset;
+
+	ptr = skb_header_pointer(skb, offset, insn->len, dest);
+	if (ptr == NULL)
+		return false;
+	if (ptr != dest)
+		memcpy(dest, ptr, insn->len);
+	return true;
+}
+
+static bool nft_meta_eval(const struct nft_insn *insn, u32 *dest,
+			  const struct nft_pktinfo *pkt)
+{
+	const struct sk_buff *skb = pkt->skb;
+
+	switch (insn->u.key) {
+	case NFT_META_LEN:
+		*dest = htonl(skb->len);
+		break;
+	case NFT_META_PROTOCOL:
+		*(__be16 *)dest = skb->protocol;
+		break;
+	case NFT_META_L4PROTO:
+		*(u8 *)dest = pkt->l4proto;
+		break;
+	case NFT_META_PRIORITY:
+		*dest = htonl(skb->priority);
+		break;
+	case NFT_META_MARK:
+		*dest = htonl(skb->mark);
+		break;
+	case NFT_META_IIF:
+		if (pkt->in == NULL)
+			return false;
+		*dest = htonl(pkt->in->ifindex);
+		break;
+	case NFT_META_OIF:
+		if (pkt->out == NULL)
+			return false;
+		*dest = htonl(pkt->out->ifindex);
+		break;
+	case NFT_META_IIFNAME:
+		if (pkt->in == NULL)
+			return false;
+		strncpy((char *)dest, pkt->in->name, IFNAMSIZ);
+		break;
+	case NFT_META_OIFNAME:
+		if (pkt->out == NULL)
+			return false;
+		strncpy((char *)dest, pkt->out->name, IFNAMSIZ);
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+static bool nft_cmp_eval(const struct nft_insn *insn, const u32 *src)
+{
+	int d = memcmp(src, insn->data, insn->len);
+
+	switch (insn->cmp_op) {
+	case NFT_CMP_EQ:
+		return d == 0;
+	case NFT_CMP_NEQ:
+		return d != 0;
+	case NFT_CMP_LT:
+		return d < 0;
+	case NFT_CMP_LTE:
+		return d <= 0;
+	case NFT_CMP_GT:
+		return d > 0;
+	default:
+		return d >= 0;
+	}
+}
+
+static void nft_bitwise_eval(const struct nft_insn *insn, u32 *dest,
+			     const u32 *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < DIV_ROUND_UP(insn->len, sizeof(u32)); i++)
+		dest[i] = (src[i] & insn->data[i]) ^ insn->xor[i];
+}
+
+static bool nft_set_lookup(const struct nft_set *set, const u32 *key)
+{
+	unsigned int lo = 0, hi = set->nelems;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		int d = memcmp(key, set->elems + mid * set->klen, set->klen);
+
+		if (d == 0)
+			return true;
+		if (d < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return false;
+}
+
+unsigned int nft_do_chain(const struct nft_ruleset *rs,
+			  const struct nft_chain *chain,
+			  const struct nft_pktinfo *pkt)
+{
+	const struct nft_chain *basechain = chain;
+	const struct nft_insn *insn;
+	u32 regs[NFT_REG_MAX + 1][NFT_REG_WORDS];
+	struct {
+		const struct nft_chain	*chain;
+		unsigned int		pc;
+	} stack[NFT_JUMP_STACK_SIZE];
+	unsigned int pc = 0, next, sp = 0;
+
+do_chain:
+	while (pc < chain->ninsns) {
+		/* NFT_OP_RULE */
+		next = chain->insns[pc].u.next;
+
+		for (pc++; pc < next; pc++) {
+			insn = &chain->insns[pc];
+
+			switch (insn->op) {
+			case NFT_EXPR_IMMEDIATE:
+				memcpy(regs[insn->dreg], insn->data, insn->len);
+				break;
+			case NFT_EXPR_PAYLOAD:
+				if (!nft_payload_eval(insn, regs[insn->dreg], pkt))
+					goto next_rule;
+				break;
+			case NFT_EXPR_META:
+				if (!nft_meta_eval(insn, regs[insn->dreg], pkt))
+					goto next_rule;
+				break;
+			case NFT_EXPR_CMP:
+				if (!nft_cmp_eval(insn, regs[insn->sreg]))
+					goto next_rule;
+				break;
+			case NFT_EXPR_BITWISE:
+				nft_bitwise_eval(insn, regs[insn->dreg],
+						 regs[insn->sreg]);
+				break;
+			case NFT_EXPR_LOOKUP:
+				if (nft_set_lookup(insn->u.set, regs[insn->sreg]) !=
+				    (insn->cmp_op == NFT_CMP_EQ))
+					goto next_rule;
+				break;
+			case NFT_EXPR_VERDICT:
+				switch (insn->u.verdict.code) {
+				case NFT_CONTINUE:
+					goto next_rule;
+				case NFT_RETURN:
+					goto do_return;
+				case NFT_JUMP:
+					stack[sp].chain = chain;
+					stack[sp].pc = next;
+					sp++;
+					/* fall through */
+				case NFT_GOTO:
+					chain = &rs->chains[insn->u.verdict.chain];
+					pc = 0;
+					goto do_chain;
+				default:
+					return insn->u.verdict.code;
+				}
+			}
+		}
+next_rule:
+		pc = next;
+	}
+
+do_return:
+	if (sp > 0) {
+		sp--;
+		chain = stack[sp].chain;
+		pc = stack[sp].pc;
+		goto do_chain;
+	}
+	return basechain->policy;
+}
@@ -0,0 +1,186 @@
+/* Kernel module to match an IP set and to add/delete packets to/from it
+ *
+ * The sets are referenced by index: the rules take a reference at
+ * checkentry time so that the sets can't be destroyed while in use.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/skbuff.h>
+
+#include <linux/netfilter/x_tables.h>
+#include <linux/netfilter/xt_set.h>
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Xtables: IP set match and target module");
+MODULE_ALIAS("xt_SET");
+MODULE_ALIAS("ipt_set");
+MODULE_ALIAS("ip6t_set");
+MODULE_ALIAS("ipt_SET");
+MODULE_ALIAS("ip6t_SET");
+
+static inline int
+match_set(ip_set_id_t index, const struct sk_buff *skb,
+	  u8 family, u8 dim, u8 flags, bool inv)
+{
+	if (ip_set_test(index, skb, family, dim, flags))
+		inv = !inv;
+	return inv;
+}
+
+static bool
+set_match(const struct sk_buff *skb, struct xt_action_param *par)
+{
+	const struct xt_set_info_match *info = par->matchinfo;
+
+	return match_set(info->match_set.index, skb, par->family,
+			 info->match_set.dim,
+			 info->match_set.flags,
+			 info->match_set.flags & IPSET_INV_MATCH);
+}
+
+/* Take a reference to the set of a rule and check the dimension */
+static int
+set_info_get(const struct xt_set_info *info, const char *what)
+{
+	ip_set_id_t index;
+
+	index = ip_set_nfnl_get_byindex(info->index);
+	if (index == IPSET_INVALID_ID) {
+		pr_warning("Cannot find %s set with id %u\n",
+			   what, info->index);
+		return -ENOENT;
+	}
+	if (info->dim == IPSET_DIM_ZERO || info->dim > IPSET_DIM_MAX) {
+		pr_warning("Protocol error: set %s dimension is over "
+			   "the limit!\n", what);
+		ip_set_nfnl_put(info->index);
+		return -ERANGE;
+	}
+	return 0;
+}
+
+static bool
+set_family_ok(u8 family)
+{
+	return family == NFPROTO_IPV4 || family == NFPROTO_IPV6;
+}
+
+static int
+set_match_checkentry(const struct xt_mtchk_param *par)
+{
+	const struct xt_set_info_match *info = par->matchinfo;
+
+	if (!set_family_ok(par->family))
+		return -EINVAL;
+
+	return set_info_get(&info->match_set, "match");
+}
+
+static void
+set_match_destroy(const struct xt_mtdtor_param *par)
+{
+	const struct xt_set_info_match *info = par->matchinfo;
+
+	ip_set_nfnl_put(info->match_set.index);
+}
+
+static unsigned int
+set_target(struct sk_buff *skb, const struct xt_action_param *par)
+{
+	const struct xt_set_info_target *info = par->targinfo;
+
+	if (info->add_set.index != IPSET_INVALID_ID)
+		ip_set_add(info->add_set.index, skb, par->family,
+			   info->add_set.dim,
+			   info->add_set.flags);
+	if (info->del_set.index != IPSET_INVALID_ID)
+		ip_set_del(info->del_set.index, skb, par->family,
+			   info->del_set.dim,
+			   info->del_set.flags);
+
+	return XT_CONTINUE;
+}
+
+static int
+set_target_checkentry(const struct xt_tgchk_param *par)
+{
+	const struct xt_set_info_target *info = par->targinfo;
+	int ret;
+
+	if (!set_family_ok(par->family))
+		return -EINVAL;
+
+	if (info->add_set.index != IPSET_INVALID_ID) {
+		ret = set_info_get(&info->add_set, "add");
+		if (ret)
+			return ret;
+	}
+
+	if (info->del_set.index != IPSET_INVALID_ID) {
+		ret = set_info_get(&info->del_set, "del");
+		if (ret) {
+			if (info->add_set.index != IPSET_INVALID_ID)
+				ip_set_nfnl_put(info->add_set.index);
+			return ret;
+		}
+	}
+	return 0;
+}
+
+static void
+set_target_destroy(const struct xt_tgdtor_param *par)
+{
+	const struct xt_set_info_target *info = par->targinfo;
+
+	if (info->add_set.index != IPSET_INVALID_ID)
+		ip_set_nfnl_put(info->add_set.index);
+	if (info->del_set.index != IPSET_INVALID_ID)
+		ip_set_nfnl_put(info->del_set.index);
+}
+
+static struct xt_match set_match_reg __read_mostly = {
+	.name		= "set",
+	.family		= NFPROTO_UNSPEC,
+	.revision	= 0,
+	.match		= set_match,
+	.matchsize	= sizeof(struct xt_set_info_match),
+	.checkentry	= set_match_checkentry,
+	.destroy	= set_match_destroy,
+	.me		= THIS_MODULE,
+};
+
+static struct xt_target set_target_reg __read_mostly = {
+	.name		= "SET",
+	.revision	= 0,
+	.family		= NFPROTO_UNSPEC,
+	.target		= set_target,
+	.targetsize	= sizeof(struct xt_set_info_target),
+	.checkentry	= set_target_checkentry,
+	.destroy	= set_target_destroy,
+	.me		= THIS_MODULE,
+};
+
+static int __init xt_set_init(void)
+{
+	int ret = xt_register_match(&set_match_reg);
+
+	if (!ret) {
+		ret = xt_register_target(&set_target_reg);
+		if (ret)
+			xt_unregister_match(&set_match_reg);
+	}
+	return ret;
+}
+
+static void __exit xt_set_fini(void)
+{
+	xt_unregister_match(&set_match_reg);
+	xt_unregister_target(&set_target_reg);
+}
+
+module_init(xt_set_init);
+module_exit(xt_set_fini);
@@ -160,9 +160,54 @@ struct packet_mreq_max {
 	unsigned char	mr_address[MAX_ADDR_LEN];
 };
 
-static int packet_set_ring(struct sock *sk, struct tpacket_req *req,
+static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		int closing, int tx_ring);
 
+#define V3_ALIGNMENT	(8)
+
+#define BLK_HDR_LEN	(ALIGN(sizeof(struct tpacket_block_desc), V3_ALIGNMENT))
+
+#define BLK_PLUS_PRIV(sz_of_priv) \
+	(BLK_HDR_LEN + ALIGN((sz_of_priv), V3_ALIGNMENT))
+
+/* Retire timeout used when the user did not ask for one, in msecs */
+#define DEFAULT_PRB_RETIRE_TOV	(8)
+
+/* kbdq - kernel block descriptor queue, the TPACKET_V3 receive state */
+struct tpacket_kbdq_core {
+	char		**pkbdq;
+	unsigned int	feature_req_word;
+	unsigned int	knum_blocks;
+	unsigned int	kactive_blk_num;
+
+	/*
+	 * kactive_blk_num as of the last timer refresh: if it has not moved
+	 * when the timer fires, the active block is retired.
+	 */
+	unsigned int	last_kactive_blk_num;
+
+	unsigned int	blk_sizeof_priv;
+	unsigned char	reset_pending_on_curr_blk;
+	unsigned char	delete_blk_timer;
+
+	char		*pkblk_start;
+	char		*pkblk_end;
+	unsigned int	kblk_size;
+	unsigned int	max_frame_len;
+	u64		knxt_seq_num;
+	char		*prev;
+	char		*nxt_offset;
+
+	/* packets reserved in the active block but still being copied */
+	atomic_t	blk_fill_in_prog;
+
+	unsigned int	retire_blk_tov;
+	unsigned long	tov_in_jiffies;
+
+	/* timer to retire an outstanding block */
+	struct timer_list retire_blk_timer;
+};
+
 struct packet_ring_buffer {
 	char			**pg_vec;
 	unsigned int		head;
@@ -174,6 +219,7 @@ struct packet_ring_buffer {
 	unsigned int		pg_vec_pages;
 	unsigned int		pg_vec_len;
 
+	struct tpacket_kbdq_core	prb_bdqc;
 	atomic_t		pending;
 };
 
@@ -186,11 +232,13 @@ struct packet_sock {
 	/* struct sock has to be the first member of packet_sock */
 	struct sock		sk;
 	struct tpacket_stats	stats;
+	unsigned int		tp_freeze_q_cnt;
 	struct packet_ring_buffer	rx_ring;
 	struct packet_ring_buffer	tx_ring;
 	int			copy_thresh;
 	spinlock_t		bind_lock;
 	struct mutex		pg_vec_lock;
+	struct packet_fanout	*fanout;
 	unsigned int		running:1,	/* prot_hook is attached*/
 				auxdata:1,
 				origdev:1,
@@ -207,6 +255,29 @@ struct packet_sock {
 	struct packet_type	prot_hook ____cacheline_aligned_in_smp;
 };
 
+#define PACKET_FANOUT_MAX	256
+
+/*
+ * A fanout group owns a single prot_hook on behalf of all its members
+ * and hands every packet to exactly one of them.  Members stay on the
+ * group for their whole lifetime; arr[] only holds the running ones.
+ */
+struct packet_fanout {
+#ifdef CONFIG_NET_NS
+	struct net		*net;
+#endif
+	unsigned int		num_members;
+	u16			id;
+	u8			type;
+	u8			defrag;
+	atomic_t		rr_cur;
+	struct list_head	list;
+	struct sock		*arr[PACKET_FANOUT_MAX];
+	spinlock_t		lock;
+	atomic_t		sk_ref;
+	struct packet_type	prot_hook ____cacheline_aligned_in_smp;
+};
+
 struct packet_skb_cb {
 	unsigned int origlen;
 	union {
@@ -316,6 +387,330 @@ static inline struct packet_sock *pkt_sk(struct sock *sk)
 	return (struct packet_sock *)sk;
 }
 
+/*
+ * TPACKET_V3: the receive ring is a list of blocks, each one filled with
+ * variable sized packets and handed to user space as a whole, either
+ * when it is full or when the retire timer finds it has not moved on
+ * for retire_blk_tov msecs.  All block state is protected by the receive
+ * queue lock; packet data is copied outside of it, tracked by
+ * blk_fill_in_prog so that a block is never closed under a copy.
+ *
+ * If user space still owns the next block, the queue is frozen and
+ * packets are dropped until that block is given back.
+ */
+static inline struct tpacket_block_desc *prb_curr_block(
+		struct tpacket_kbdq_core *pkc)
+{
+	return (struct tpacket_block_desc *)pkc->pkbdq[pkc->kactive_blk_num];
+}
+
+static inline unsigned int prb_next_blk_num(struct tpacket_kbdq_core *pkc)
+{
+	return pkc->kactive_blk_num < pkc->knum_blocks - 1 ?
+		pkc->kactive_blk_num + 1 : 0;
+}
+
+static inline unsigned int prb_prev_blk_num(struct tpacket_kbdq_core *pkc)
+{
+	return pkc->kactive_blk_num ?
+		pkc->kactive_blk_num - 1 : pkc->knum_blocks - 1;
+}
+
+static inline int prb_queue_frozen(struct tpacket_kbdq_core *pkc)
+{
+	return pkc->reset_pending_on_curr_blk;
+}
+
+static inline int prb_blk_in_use(struct tpacket_block_desc *pbd)
+{
+	smp_rmb();
+	flush_dcache_page(virt_to_page(&pbd->hdr.bh1.block_status));
+	return pbd->hdr.bh1.block_status & TP_STATUS_USER;
+}
+
+static void prb_refresh_retire_blk_timer(struct tpacket_kbdq_core *pkc)
+{
+	mod_timer(&pkc->retire_blk_timer, jiffies + pkc->tov_in_jiffies);
+	pkc->last_kactive_blk_num = pkc->kactive_blk_num;
+}
+
+/* Called with the receive queue lock held, for a block we own. */
+static void prb_open_block(struct tpacket_kbdq_core *pkc,
+			   struct tpacket_block_desc *pbd)
+{
+	struct tpacket_hdr_v1 *h1 = &pbd->hdr.bh1;
+	struct timespec ts;
+
+	smp_rmb();
+
+	pbd->version = TPACKET_V3;
+	pbd->offset_to_priv = BLK_HDR_LEN;
+	h1->num_pkts = 0;
+	h1->offset_to_first_pkt = BLK_PLUS_PRIV(pkc->blk_sizeof_priv);
+	h1->blk_len = BLK_PLUS_PRIV(pkc->blk_sizeof_priv);
+	h1->seq_num = pkc->knxt_seq_num++;
+	getnstimeofday(&ts);
+	h1->ts_first_pkt.ts_sec = ts.tv_sec;
+	h1->ts_first_pkt.ts_nsec = ts.tv_nsec;
+
+	pkc->pkblk_start = (char *)pbd;
+	pkc->pkblk_end = pkc->pkblk_start + pkc->kblk_size;
+	pkc->nxt_offset = pkc->pkblk_start + BLK_PLUS_PRIV(pkc->blk_sizeof_priv);
+	pkc->prev = pkc->nxt_offset;
+
+	pkc->reset_pending_on_curr_blk = 0;
+	prb_refresh_retire_blk_timer(pkc);
+
+	smp_wmb();
+}
+
+/* Hand the whole block to user space: data first, status word last. */
+static void prb_flush_block(struct tpacket_kbdq_core *pkc,
+			    struct tpacket_block_desc *pbd, u32 status)
+{
+	char *start = pkc->pkblk_start + PAGE_SIZE;
+
+	for (; start < pkc->pkblk_end; start += PAGE_SIZE)
+		flush_dcache_page(virt_to_page(start));
+
+	smp_wmb();
+
+	pbd->hdr.bh1.block_status = status;
+	flush_dcache_page(virt_to_page(pbd));
+
+	smp_wmb();
+}
+
+static void prb_close_block(struct tpacket_kbdq_core *pkc,
+			    struct tpacket_block_desc *pbd,
+			    struct packet_sock *po, unsigned int stat)
+{
+	struct tpacket_hdr_v1 *h1 = &pbd->hdr.bh1;
+	struct tpacket3_hdr *last_pkt = (struct tpacket3_hdr *)pkc->prev;
+	u32 status = TP_STATUS_USER | stat;
+
+	if (po->stats.tp_drops)
+		status |= TP_STATUS_LOSING;
+
+	last_pkt->tp_next_offset = 0;
+	h1->ts_last_pkt.ts_sec = last_pkt->tp_sec;
+	h1->ts_last_pkt.ts_nsec = last_pkt->tp_nsec;
+
+	prb_flush_block(pkc, pbd, status);
+
+	pkc->kactive_blk_num = prb_next_blk_num(pkc);
+
+	/* the only wakeup user space gets: one per block */
+	po->sk.sk_data_ready(&po->sk, 0);
+}
+
+static void prb_retire_current_block(struct tpacket_kbdq_core *pkc,
+				     struct packet_sock *po, unsigned int status)
+{
+	struct tpacket_block_desc *pbd = prb_curr_block(pkc);
+
+	/* an earlier packet may still be copied into this block */
+	while (atomic_read(&pkc->blk_fill_in_prog))
+		cpu_relax();
+
+	prb_close_block(pkc, pbd, po, status);
+}
+
+/*
+ * Open the block following the one just retired, or freeze the queue if
+ * user space has not given it back yet.
+ */
+static char *prb_dispatch_next_block(struct tpacket_kbdq_core *pkc,
+				     struct packet_sock *po)
+{
+	struct tpacket_block_desc *pbd = prb_curr_block(pkc);
+
+	if (prb_blk_in_use(pbd)) {
+		pkc->reset_pending_on_curr_blk = 1;
+		po->tp_freeze_q_cnt++;
+		return NULL;
+	}
+
+	prb_open_block(pkc, pbd);
+	return pkc->nxt_offset;
+}
+
+static void prb_retire_rx_blk_timer_expired(unsigned long data)
+{
+	struct packet_sock *po = (struct packet_sock *)data;
+	struct tpacket_kbdq_core *pkc = &po->rx_ring.prb_bdqc;
+	struct tpacket_block_desc *pbd;
+
+	spin_lock(&po->sk.sk_receive_queue.lock);
+
+	if (unlikely(pkc->delete_blk_timer))
+		goto out;
+
+	pbd = prb_curr_block(pkc);
+
+	if (prb_queue_frozen(pkc)) {
+		/* opening the block thaws the queue and restarts the timer */
+		if (!prb_blk_in_use(pbd))
+			prb_open_block(pkc, pbd);
+		else
+			prb_refresh_retire_blk_timer(pkc);
+		goto out;
+	}
+
+	/*
+	 * Only retire a block that has packets and has been active for a
+	 * whole period; empty blocks are not worth a wakeup.
+	 */
+	if (pkc->last_kactive_blk_num == pkc->kactive_blk_num &&
+	    pbd->hdr.bh1.num_pkts) {
+		prb_retire_current_block(pkc, po, TP_STATUS_BLK_TMO);
+		if (prb_dispatch_next_block(pkc, po))
+			goto out;
+	}
+
+	prb_refresh_retire_blk_timer(pkc);
+out:
+	spin_unlock(&po->sk.sk_receive_queue.lock);
+}
+
+static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
+					  struct sk_buff_head *rb_queue)
+{
+	struct tpacket_kbdq_core *pkc = &po->rx_ring.prb_bdqc;
+
+	spin_lock_bh(&rb_queue->lock);
+	pkc->delete_blk_timer = 1;
+	spin_unlock_bh(&rb_queue->lock);
+
+	del_timer_sync(&pkc->retire_blk_timer);
+}
+
+/* Called with the receive queue lock held, once pg_vec is installed. */
+static void init_prb_bdqc(struct packet_sock *po,
+			  struct packet_ring_buffer *rb,
+			  struct tpacket_req3 *req3)
+{
+	struct tpacket_kbdq_core *pkc = &rb->prb_bdqc;
+
+	memset(pkc, 0, sizeof(*pkc));
+
+	pkc->pkbdq = rb->pg_vec;
+	pkc->knum_blocks = req3->tp_block_nr;
+	pkc->kblk_size = req3->tp_block_size;
+	pkc->blk_sizeof_priv = req3->tp_sizeof_priv;
+	pkc->max_frame_len = pkc->kblk_size - BLK_PLUS_PRIV(pkc->blk_sizeof_priv);
+	pkc->feature_req_word = req3->tp_feature_req_word;
+	pkc->knxt_seq_num = 1;
+	pkc->retire_blk_tov = req3->tp_retire_blk_tov ? :
+			      DEFAULT_PRB_RETIRE_TOV;
+	pkc->tov_in_jiffies = msecs_to_jiffies(pkc->retire_blk_tov);
+	if (!pkc->tov_in_jiffies)
+		pkc->tov_in_jiffies = 1;
+	po->tp_freeze_q_cnt = 0;
+
+	setup_timer(&pkc->retire_blk_timer, prb_retire_rx_blk_timer_expired,
+		    (unsigned long)po);
+	prb_open_block(pkc, prb_curr_block(pkc));
+}
+
+/*
+ * Reserve len bytes for a packet in the active block, moving on to the
+ * next block when it does not fit.  Called with the receive queue lock
+ * held; the caller drops blk_fill_in_prog once the packet is written.
+ */
+static void *prb_lookup_frame_in_block(struct packet_sock *po,
+				       unsigned int len)
+{
+	struct tpacket_kbdq_core *pkc = &po->rx_ring.prb_bdqc;
+	struct tpacket_block_desc *pbd = prb_curr_block(pkc);
+	struct tpacket3_hdr *ppd;
+	char *curr;
+
+	len = ALIGN(len, V3_ALIGNMENT);
+	if (unlikely(len > pkc->max_frame_len))
+		return NULL;
+
+	if (prb_queue_frozen(pkc)) {
+		/* is the block that froze the queue still owned by the user? */
+		if (prb_blk_in_use(pbd))
+			return NULL;
+		prb_open_block(pkc, pbd);
+	}
+
+	curr = pkc->nxt_offset;
+	if (curr + len > pkc->pkblk_end) {
+		prb_retire_current_block(pkc, po, 0);
+		curr = prb_dispatch_next_block(pkc, po);
+		if (!curr)
+			return NULL;
+		pbd = prb_curr_block(pkc);
+	}
+
+	ppd = (struct tpacket3_hdr *)curr;
+	ppd->tp_next_offset = len;
+	pkc->prev = curr;
+	pkc->nxt_offset += len;
+	pbd->hdr.bh1.blk_len += len;
+	pbd->hdr.bh1.num_pkts++;
+	atomic_inc(&pkc->blk_fill_in_prog);
+
+	return curr;
+}
+
+static void __fanout_link(struct sock *sk, struct packet_sock *po);
+static void __fanout_unlink(struct sock *sk, struct packet_sock *po);
+
+/*
+ * register_prot_hook() must be invoked with po->bind_lock held, or from
+ * a context in which nothing else can reach the socket yet
+ * (packet_create()).
+ */
+static void register_prot_hook(struct sock *sk)
+{
+	struct packet_sock *po = pkt_sk(sk);
+
+	if (!po->running) {
+		if (po->fanout)
+			__fanout_link(sk, po);
+		else
+			dev_add_pack(&po->prot_hook);
+		sock_hold(sk);
+		po->running = 1;
+	}
+}
+
+/*
+ * {,__}unregister_prot_hook() must be invoked with po->bind_lock held.
+ * With sync set the lock is dropped around synchronize_net() so that no
+ * receive path still refers to po->prot_hook on return; otherwise that
+ * is up to the caller.
+ */
+static void __unregister_prot_hook(struct sock *sk, bool sync)
+{
+	struct packet_sock *po = pkt_sk(sk);
+
+	po->running = 0;
+	if (po->fanout)
+		__fanout_unlink(sk, po);
+	else
+		__dev_remove_pack(&po->prot_hook);
+	__sock_put(sk);
+
+	if (sync) {
+		spin_unlock(&po->bind_lock);
+		synchronize_net();
+		spin_lock(&po->bind_lock);
+	}
+}
+
+static void unregister_prot_hook(struct sock *sk, bool sync)
+{
+	struct packet_sock *po = pkt_sk(sk);
+
+	if (po->running)
+		__unregister_prot_hook(sk, sync);
+}
+
 static void packet_sock_destruct(struct sock *sk)
 {
 	skb_queue_purge(&sk->sk_error_queue);
@@ -331,6 +726,259 @@ static void packet_sock_destruct(struct sock *sk)
 	sk_refcnt_debug_dec(sk);
 }
 
+static int fanout_rr_next(struct packet_fanout *f, unsigned int num)
+{
+	int x = atomic_read(&f->rr_cur) + 1;
+
+	if (x >= num)
+		x = 0;
+
+	return x;
+}
+
+static struct sock *fanout_demux_hash(struct packet_fanout *f,
+				      struct sk_buff *skb, unsigned int num)
+{
+	u32 idx, hash = skb->rxhash;
+
+	idx = ((u64)hash * num) >> 32;
+
+	return f->arr[idx];
+}
+
+static struct sock *fanout_demux_lb(struct packet_fanout *f,
+				    struct sk_buff *skb, unsigned int num)
+{
+	int cur, old;
+
+	cur = atomic_read(&f->rr_cur);
+	while ((old = atomic_cmpxchg(&f->rr_cur, cur,
+				     fanout_rr_next(f, num))) != cur)
+		cur = old;
+	return f->arr[cur];
+}
+
+static struct sock *fanout_demux_cpu(struct packet_fanout *f,
+				     struct sk_buff *skb, unsigned int num)
+{
+	unsigned int cpu = smp_processor_id();
+
+	return f->arr[cpu % num];
+}
+
+/*
+ * Reassemble IPv4 fragments before hashing, so that all fragments of a
+ * datagram end up on the same member as the rest of its flow.
+ */
+static struct sk_buff *fanout_check_defrag(struct sk_buff *skb)
+{
+#ifdef CONFIG_INET
+	const struct iphdr *iph;
+	u32 len;
+
+	if (skb->protocol != htons(ETH_P_IP))
+		return skb;
+
+	if (!pskb_may_pull(skb, sizeof(struct iphdr)))
+		return skb;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl < 5 || iph->version != 4)
+		return skb;
+	if (!pskb_may_pull(skb, iph->ihl * 4))
+		return skb;
+	iph = ip_hdr(skb);
+	len = ntohs(iph->tot_len);
+	if (skb->len < len || len < (iph->ihl * 4))
+		return skb;
+
+	if (iph->frag_off & htons(IP_MF | IP_OFFSET)) {
+		skb = skb_share_check(skb, GFP_ATOMIC);
+		if (skb) {
+			if (pskb_trim_rcsum(skb, len))
+				return skb;
+			memset(IPCB(skb), 0, sizeof(struct inet_skb_parm));
+			if (ip_defrag(skb, IP_DEFRAG_AF_PACKET))
+				return NULL;
+			skb->rxhash = 0;
+		}
+	}
+#endif
+	return skb;
+}
+
+static int packet_rcv_fanout(struct sk_buff *skb, struct net_device *dev,
+			     struct packet_type *pt, struct net_device *orig_dev)
+{
+	struct packet_fanout *f = pt->af_packet_priv;
+	unsigned int num = f->num_members;
+	struct packet_sock *po;
+	struct sock *sk;
+
+	if (!net_eq(dev_net(dev), read_pnet(&f->net)) || !num) {
+		kfree_skb(skb);
+		return 0;
+	}
+
+	switch (f->type) {
+	case PACKET_FANOUT_HASH:
+	default:
+		if (f->defrag) {
+			skb = fanout_check_defrag(skb);
+			if (!skb)
+				return 0;
+		}
+		skb_get_rxhash(skb);
+		sk = fanout_demux_hash(f, skb, num);
+		break;
+	case PACKET_FANOUT_LB:
+		sk = fanout_demux_lb(f, skb, num);
+		break;
+	case PACKET_FANOUT_CPU:
+		sk = fanout_demux_cpu(f, skb, num);
+		break;
+	}
+
+	po = pkt_sk(sk);
+
+	return po->prot_hook.func(skb, dev, &po->prot_hook, orig_dev);
+}
+
+static DEFINE_MUTEX(fanout_mutex);
+static LIST_HEAD(fanout_list);
+
+static void __fanout_link(struct sock *sk, struct packet_sock *po)
+{
+	struct packet_fanout *f = po->fanout;
+
+	spin_lock(&f->lock);
+	f->arr[f->num_members] = sk;
+	smp_wmb();
+	f->num_members++;
+	spin_unlock(&f->lock);
+}
+
+static void __fanout_unlink(struct sock *sk, struct packet_sock *po)
+{
+	struct packet_fanout *f = po->fanout;
+	int i;
+
+	spin_lock(&f->lock);
+	for (i = 0; i < f->num_members; i++) {
+		if (f->arr[i] == sk)
+			break;
+	}
+	BUG_ON(i >= f->num_members);
+	f->arr[i] = f->arr[f->num_members - 1];
+	f->num_members--;
+	spin_unlock(&f->lock);
+}
+
+static int fanout_add(struct sock *sk, u16 id, u16 type_flags)
+{
+	struct packet_sock *po = pkt_sk(sk);
+	struct packet_fanout *f, *match;
+	u8 type = type_flags & 0xff;
+	u8 defrag = (type_flags & PACKET_FANOUT_FLAG_DEFRAG) ? 1 : 0;
+	int err;
+
+	switch (type) {
+	case PACKET_FANOUT_HASH:
+	case PACKET_FANOUT_LB:
+	case PACKET_FANOUT_CPU:
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (!po->running)
+		return -EINVAL;
+
+	if (po->fanout)
+		return -EALREADY;
+
+	mutex_lock(&fanout_mutex);
+	match = NULL;
+	list_for_each_entry(f, &fanout_list, list) {
+		if (f->id == id &&
+		    read_pnet(&f->net) == sock_net(sk)) {
+			match = f;
+			break;
+		}
+	}
+	err = -EINVAL;
+	if (match && match->defrag != defrag)
+		goto out;
+	if (!match) {
+		err = -ENOMEM;
+		match = kzalloc(sizeof(*match), GFP_KERNEL);
+		if (!match)
+			goto out;
+		write_pnet(&match->net, sock_net(sk));
+		match->id = id;
+		match->type = type;
+		match->defrag = defrag;
+		atomic_set(&match->rr_cur, 0);
+		INIT_LIST_HEAD(&match->list);
+		spin_lock_init(&match->lock);
+		atomic_set(&match->sk_ref, 0);
+		match->prot_hook.type = po->prot_hook.type;
+		match->prot_hook.dev = po->prot_hook.dev;
+		match->prot_hook.func = packet_rcv_fanout;
+		match->prot_hook.af_packet_priv = match;
+		dev_add_pack(&match->prot_hook);
+		list_add(&match->list, &fanout_list);
+	}
+
+	spin_lock(&po->bind_lock);
+	err = -EINVAL;
+	if (po->running && !po->fanout &&
+	    match->type == type &&
+	    match->prot_hook.type == po->prot_hook.type &&
+	    match->prot_hook.dev == po->prot_hook.dev) {
+		err = -ENOSPC;
+		if (atomic_read(&match->sk_ref) < PACKET_FANOUT_MAX) {
+			__dev_remove_pack(&po->prot_hook);
+			po->fanout = match;
+			atomic_inc(&match->sk_ref);
+			__fanout_link(sk, po);
+			err = 0;
+		}
+	}
+	spin_unlock(&po->bind_lock);
+
+	/* drop a group we just created but could not join */
+	if (err && !atomic_read(&match->sk_ref)) {
+		list_del(&match->list);
+		dev_remove_pack(&match->prot_hook);
+		kfree(match);
+	}
+out:
+	mutex_unlock(&fanout_mutex);
+	return err;
+}
+
+/* called once the socket has been unlinked from the group's arr[] */
+static void fanout_release(struct sock *sk)
+{
+	struct packet_sock *po = pkt_sk(sk);
+	struct packet_fanout *f;
+
+	f = po->fanout;
+	if (!f)
+		return;
+
+	po->fanout = NULL;
+
+	mutex_lock(&fanout_mutex);
+	if (atomic_dec_and_test(&f->sk_ref)) {
+		list_del(&f->list);
+		dev_remove_pack(&f->prot_hook);
+		kfree(f);
+	}
+	mutex_unlock(&fanout_mutex);
+}
+
 
 static const struct proto_ops packet_ops;
 
@@ -648,11 +1296,12 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	union {
 		struct tpacket_hdr *h1;
 		struct tpacket2_hdr *h2;
+		struct tpacket3_hdr *h3;
 		void *raw;
 	} h;
 	u8 *skb_head = skb->data;
 	int skb_len = skb->len;
-	unsigned int snaplen, res;
+	unsigned int snaplen, res, max_frame_len;
 	unsigned long status = TP_STATUS_LOSING|TP_STATUS_USER;
 	unsigned short macoff, netoff, hdrlen;
 	struct sk_buff *copy_skb = NULL;
@@ -700,7 +1349,12 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		macoff = netoff - maclen;
 	}
 
-	if (macoff + snaplen > po->rx_ring.frame_size) {
+	if (po->tp_version == TPACKET_V3)
+		max_frame_len = po->rx_ring.prb_bdqc.max_frame_len;
+	else
+		max_frame_len = po->rx_ring.frame_size;
+
+	if (macoff + snaplen > max_frame_len) {
 		if (po->copy_thresh &&
 		    atomic_read(&sk->sk_rmem_alloc) + skb->truesize <
 		    (unsigned)sk->sk_rcvbuf) {
@@ -713,16 +1367,23 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			if (copy_skb)
 				skb_set_owner_r(copy_skb, sk);
 		}
-		snaplen = po->rx_ring.frame_size - macoff;
+		snaplen = max_frame_len - macoff;
 		if ((int)snaplen < 0)
 			snaplen = 0;
 	}
 
 	spin_lock(&sk->sk_receive_queue.lock);
-	h.raw = packet_current_frame(po, &po->rx_ring, TP_STATUS_KERNEL);
-	if (!h.raw)
-		goto ring_is_full;
-	packet_increment_head(&po->rx_ring);
+	if (po->tp_version == TPACKET_V3) {
+		h.raw = prb_lookup_frame_in_block(po, macoff + snaplen);
+		if (!h.raw)
+			goto ring_is_full;
+	} else {
+		h.raw = packet_current_frame(po, &po->rx_ring,
+					     TP_STATUS_KERNEL);
+		if (!h.raw)
+			goto ring_is_full;
+		packet_increment_head(&po->rx_ring);
+	}
 	po->stats.tp_packets++;
 	if (copy_skb) {
 		status |= TP_STATUS_COPY;
@@ -774,6 +1435,33 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		h.h2->tp_vlan_tci = vlan_tx_tag_get(skb);
 		hdrlen = sizeof(*h.h2);
 		break;
+	case TPACKET_V3:
+		/* tp_next_offset is set up by prb_lookup_frame_in_block() */
+		h.h3->tp_status = status;
+		h.h3->tp_len = skb->len;
+		h.h3->tp_snaplen = snaplen;
+		h.h3->tp_mac = macoff;
+		h.h3->tp_net = netoff;
+		if ((po->tp_tstamp & SOF_TIMESTAMPING_SYS_HARDWARE)
+				&& shhwtstamps->syststamp.tv64)
+			ts = ktime_to_timespec(shhwtstamps->syststamp);
+		else if ((po->tp_tstamp & SOF_TIMESTAMPING_RAW_HARDWARE)
+				&& shhwtstamps->hwtstamp.tv64)
+			ts = ktime_to_timespec(shhwtstamps->hwtstamp);
+		else if (skb->tstamp.tv64)
+			ts = ktime_to_timespec(skb->tstamp);
+		else
+			getnstimeofday(&ts);
+		h.h3->tp_sec = ts.tv_sec;
+		h.h3->tp_nsec = ts.tv_nsec;
+		if (po->rx_ring.prb_bdqc.feature_req_word &
+		    TP_FT_REQ_FILL_RXHASH)
+			h.h3->hv1.tp_rxhash = skb_get_rxhash(skb);
+		else
+			h.h3->hv1.tp_rxhash = 0;
+		h.h3->hv1.tp_vlan_tci = vlan_tx_tag_get(skb);
+		hdrlen = sizeof(*h.h3);
+		break;
 	default:
 		BUG();
 	}
@@ -789,7 +1477,8 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	else
 		sll->sll_ifindex = dev->ifindex;
 
-	__packet_set_status(po, h.raw, status);
+	if (po->tp_version != TPACKET_V3)
+		__packet_set_status(po, h.raw, status);
 	smp_mb();
 	{
 		struct page *p_start, *p_end;
@@ -803,7 +1492,11 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		}
 	}
 
-	sk->sk_data_ready(sk, 0);
+	/* TPACKET_V3 wakes user space when the block is retired */
+	if (po->tp_version == TPACKET_V3)
+		atomic_dec(&po->rx_ring.prb_bdqc.blk_fill_in_prog);
+	else
+		sk->sk_data_ready(sk, 0);
 
 drop_n_restore:
 	if (skb_head != skb->data && skb_shared(skb)) {
@@ -1279,7 +1972,7 @@ static int packet_release(struct socket *sock)
 	struct sock *sk = sock->sk;
 	struct packet_sock *po;
 	struct net *net;
-	struct tpacket_req req;
+	union tpacket_req_u req_u;
 
 	if (!sk)
 		return 0;
@@ -1293,26 +1986,21 @@ static int packet_release(struct socket *sock)
 	spin_unlock_bh(&net->packet.sklist_lock);
 
 	spin_lock(&po->bind_lock);
-	if (po->running) {
-		/*
-		 * Remove from protocol table
-		 */
-		po->running = 0;
-		po->num = 0;
-		__dev_remove_pack(&po->prot_hook);
-		__sock_put(sk);
-	}
+	unregister_prot_hook(sk, false);
+	po->num = 0;
 	spin_unlock(&po->bind_lock);
 
 	packet_flush_mclist(sk);
 
-	memset(&req, 0, sizeof(req));
+	memset(&req_u, 0, sizeof(req_u));
 
 	if (po->rx_ring.pg_vec)
-		packet_set_ring(sk, &req, 1, 0);
+		packet_set_ring(sk, &req_u, 1, 0);
 
 	if (po->tx_ring.pg_vec)
-		packet_set_ring(sk, &req, 1, 1);
+		packet_set_ring(sk, &req_u, 1, 1);
+
+	fanout_release(sk);
 
 	synchronize_net();
 	/*
@@ -1337,6 +2025,11 @@ static int packet_release(struct socket *sock)
 static int packet_do_bind(struct sock *sk, struct net_device *dev, __be16 protocol)
 {
 	struct packet_sock *po = pkt_sk(sk);
+
+	/* a fanout member is tied to the group's device and protocol */
+	if (po->fanout)
+		return -EINVAL;
+
 	/*
 	 *	Detach an existing hook if present.
 	 */
@@ -1344,14 +2037,7 @@ static int packet_do_bind(struct sock *sk, struct net_device *dev, __be16 protoc
 	lock_sock(sk);
 
 	spin_lock(&po->bind_lock);
-	if (po->running) {
-		__sock_put(sk);
-		po->running = 0;
-		po->num = 0;
-		spin_unlock(&po->bind_lock);
-		dev_remove_pack(&po->prot_hook);
-		spin_lock(&po->bind_lock);
-	}
+	unregister_prot_hook(sk, true);
 
 	po->num = protocol;
 	po->prot_hook.type = protocol;
@@ -1363,9 +2049,7 @@ static int packet_do_bind(struct sock *sk, struct net_device *dev, __be16 protoc
 		goto out_unlock;
 
 	if (!dev || (dev->flags & IFF_UP)) {
-		dev_add_pack(&po->prot_hook);
-		sock_hold(sk);
-		po->running = 1;
+		register_prot_hook(sk);
 	} else {
 		sk->sk_err = ENETDOWN;
 		if (!sock_flag(sk, SOCK_DEAD))
@@ -1496,9 +2180,7 @@ static int packet_create(struct net *net, struct socket *sock, int protocol,
 
 	if (proto) {
 		po->prot_hook.type = proto;
-		dev_add_pack(&po->prot_hook);
-		sock_hold(sk);
-		po->running = 1;
+		register_prot_hook(sk);
 	}
 
 	spin_lock_bh(&net->packet.sklist_lock);
@@ -1935,15 +2617,27 @@ packet_setsockopt(struct socket *sock, int level, int optname, char __user *optv
 	case PACKET_RX_RING:
 	case PACKET_TX_RING:
 	{
-		struct tpacket_req req;
+		union tpacket_req_u req_u;
+		int len;
 
-		if (optlen < sizeof(req))
+		switch (po->tp_version) {
+		case TPACKET_V1:
+		case TPACKET_V2:
+			len = sizeof(req_u.req);
+			break;
+		case TPACKET_V3:
+		default:
+			len = sizeof(req_u.req3);
+			break;
+		}
+		if (optlen < len)
 			return -EINVAL;
 		if (pkt_sk(sk)->has_vnet_hdr)
 			return -EINVAL;
-		if (copy_from_user(&req, optval, sizeof(req)))
+		if (copy_from_user(&req_u.req, optval, len))
 			return -EFAULT;
-		return packet_set_ring(sk, &req, 0, optname == PACKET_TX_RING);
+		return packet_set_ring(sk, &req_u, 0,
+				       optname == PACKET_TX_RING);
 	}
 	case PACKET_COPY_THRESH:
 	{
@@ -1970,6 +2664,7 @@ packet_setsockopt(struct socket *sock, int level, int optname, char __user *optv
 		switch (val) {
 		case TPACKET_V1:
 		case TPACKET_V2:
+		case TPACKET_V3:
 			po->tp_version = val;
 			return 0;
 		default:
@@ -2054,6 +2749,17 @@ packet_setsockopt(struct socket *sock, int level, int optname, char __user *optv
 		po->tp_tstamp = val;
 		return 0;
 	}
+	case PACKET_FANOUT:
+	{
+		int val;
+
+		if (optlen != sizeof(val))
+			return -EINVAL;
+		if (copy_from_user(&val, optval, sizeof(val)))
+			return -EFAULT;
+
+		return fanout_add(sk, val & 0xffff, val >> 16);
+	}
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -2068,6 +2774,7 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 	struct packet_sock *po = pkt_sk(sk);
 	void *data;
 	struct tpacket_stats st;
+	struct tpacket_stats_v3 st3;
 
 	if (level != SOL_PACKET)
 		return -ENOPROTOOPT;
@@ -2080,15 +2787,25 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 
 	switch (optname) {
 	case PACKET_STATISTICS:
-		if (len > sizeof(struct tpacket_stats))
-			len = sizeof(struct tpacket_stats);
 		spin_lock_bh(&sk->sk_receive_queue.lock);
 		st = po->stats;
 		memset(&po->stats, 0, sizeof(st));
+		st3.tp_freeze_q_cnt = po->tp_freeze_q_cnt;
+		po->tp_freeze_q_cnt = 0;
 		spin_unlock_bh(&sk->sk_receive_queue.lock);
 		st.tp_packets += st.tp_drops;
 
-		data = &st;
+		if (po->tp_version == TPACKET_V3) {
+			if (len > sizeof(struct tpacket_stats_v3))
+				len = sizeof(struct tpacket_stats_v3);
+			st3.tp_packets = st.tp_packets;
+			st3.tp_drops = st.tp_drops;
+			data = &st3;
+		} else {
+			if (len > sizeof(struct tpacket_stats))
+				len = sizeof(struct tpacket_stats);
+			data = &st;
+		}
 		break;
 	case PACKET_AUXDATA:
 		if (len > sizeof(int))
@@ -2129,6 +2846,9 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 		case TPACKET_V2:
 			val = sizeof(struct tpacket2_hdr);
 			break;
+		case TPACKET_V3:
+			val = sizeof(struct tpacket3_hdr);
+			break;
 		default:
 			return -EINVAL;
 		}
@@ -2152,6 +2872,17 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 		val = po->tp_tstamp;
 		data = &val;
 		break;
+	case PACKET_FANOUT:
+		if (len > sizeof(int))
+			len = sizeof(int);
+		val = (po->fanout ?
+		       ((u32)po->fanout->id |
+			((u32)po->fanout->type << 16) |
+			(po->fanout->defrag ?
+			 PACKET_FANOUT_FLAG_DEFRAG << 16 : 0)) :
+		       0);
+		data = &val;
+		break;
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -2185,9 +2916,7 @@ static int packet_notifier(struct notifier_block *this, unsigned long msg, void
 			if (dev->ifindex == po->ifindex) {
 				spin_lock(&po->bind_lock);
 				if (po->running) {
-					__dev_remove_pack(&po->prot_hook);
-					__sock_put(sk);
-					po->running = 0;
+					__unregister_prot_hook(sk, false);
 					sk->sk_err = ENETDOWN;
 					if (!sock_flag(sk, SOCK_DEAD))
 						sk->sk_error_report(sk);
@@ -2202,11 +2931,8 @@ static int packet_notifier(struct notifier_block *this, unsigned long msg, void
 		case NETDEV_UP:
 			if (dev->ifindex == po->ifindex) {
 				spin_lock(&po->bind_lock);
-				if (po->num && !po->running) {
-					dev_add_pack(&po->prot_hook);
-					sock_hold(sk);
-					po->running = 1;
-				}
+				if (po->num)
+					register_prot_hook(sk);
 				spin_unlock(&po->bind_lock);
 			}
 			break;
@@ -2279,7 +3005,15 @@ static unsigned int packet_poll(struct file *file, struct socket *sock,
 
 	spin_lock_bh(&sk->sk_receive_queue.lock);
 	if (po->rx_ring.pg_vec) {
-		if (!packet_previous_frame(po, &po->rx_ring, TP_STATUS_KERNEL))
+		if (po->tp_version == TPACKET_V3) {
+			struct tpacket_kbdq_core *pkc = &po->rx_ring.prb_bdqc;
+			struct tpacket_block_desc *pbd = (void *)
+				pkc->pkbdq[prb_prev_blk_num(pkc)];
+
+			if (prb_queue_frozen(pkc) || prb_blk_in_use(pbd))
+				mask |= POLLIN | POLLRDNORM;
+		} else if (!packet_previous_frame(po, &po->rx_ring,
+						  TP_STATUS_KERNEL))
 			mask |= POLLIN | POLLRDNORM;
 	}
 	spin_unlock_bh(&sk->sk_receive_queue.lock);
@@ -2365,9 +3099,10 @@ out_free_pgvec:
 	goto out;
 }
 
-static int packet_set_ring(struct sock *sk, struct tpacket_req *req,
+static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		int closing, int tx_ring)
 {
+	struct tpacket_req *req = &req_u->req;
 	char **pg_vec = NULL;
 	struct packet_sock *po = pkt_sk(sk);
 	int was_running, order = 0;
@@ -2400,11 +3135,23 @@ static int packet_set_ring(struct sock *sk, struct tpacket_req *req,
 		case TPACKET_V2:
 			po->tp_hdrlen = TPACKET2_HDRLEN;
 			break;
+		case TPACKET_V3:
+			po->tp_hdrlen = TPACKET3_HDRLEN;
+			break;
 		}
 
 		err = -EINVAL;
 		if (unlikely((int)req->tp_block_size <= 0))
 			goto out;
+		if (po->tp_version == TPACKET_V3) {
+			/* only the receive ring has a block layout */
+			if (unlikely(tx_ring))
+				goto out;
+			if (unlikely(BLK_PLUS_PRIV((u64)req_u->req3.tp_sizeof_priv) +
+				     po->tp_hdrlen + po->tp_reserve >
+				     req->tp_block_size))
+				goto out;
+		}
 		if (unlikely(req->tp_block_size & (PAGE_SIZE - 1)))
 			goto out;
 		if (unlikely(req->tp_frame_size < po->tp_hdrlen +
@@ -2440,10 +3187,8 @@ static int packet_set_ring(struct sock *sk, struct tpacket_req *req,
 	was_running = po->running;
 	num = po->num;
 	if (was_running) {
-		__dev_remove_pack(&po->prot_hook);
 		po->num = 0;
-		po->running = 0;
-		__sock_put(sk);
+		__unregister_prot_hook(sk, false);
 	}
 	spin_unlock(&po->bind_lock);
 
@@ -2454,11 +3199,16 @@ static int packet_set_ring(struct sock *sk, struct tpacket_req *req,
 	if (closing || atomic_read(&po->mapped) == 0) {
 		err = 0;
 #define XC(a, b) ({ __typeof__ ((a)) __t; __t = (a); (a) = (b); __t; })
+		if (po->tp_version == TPACKET_V3 && !tx_ring && rb->pg_vec)
+			prb_shutdown_retire_blk_timer(po, rb_queue);
+
 		spin_lock_bh(&rb_queue->lock);
 		pg_vec = XC(rb->pg_vec, pg_vec);
 		rb->frame_max = (req->tp_frame_nr - 1);
 		rb->head = 0;
 		rb->frame_size = req->tp_frame_size;
+		if (po->tp_version == TPACKET_V3 && !tx_ring && rb->pg_vec)
+			init_prb_bdqc(po, rb, &req_u->req3);
 		spin_unlock_bh(&rb_queue->lock);
 
 		order = XC(rb->pg_vec_order, order);
@@ -2476,11 +3226,9 @@ static int packet_set_ring(struct sock *sk, struct tpacket_req *req,
 	mutex_unlock(&po->pg_vec_lock);
 
 	spin_lock(&po->bind_lock);
-	if (was_running && !po->running) {
-		sock_hold(sk);
-		po->running = 1;
+	if (was_running) {
 		po->num = num;
-		dev_add_pack(&po->prot_hook);
+		register_prot_hook(sk);
 	}
 	spin_unlock(&po->bind_lock);
 
@@ -193,6 +193,8 @@ static struct rpc_clnt * rpc_new_client(const struct rpc_create_args *args, stru
 	strlcpy(clnt->cl_server, args->servername, len);
 
 	clnt->cl_xprt     = xprt;
+	clnt->cl_xprts[0] = xprt;
+	clnt->cl_nr_xprts = 1;
 	clnt->cl_procinfo = version->procs;
 	clnt->cl_maxproc  = version->nrprocs;
 	clnt->cl_protname = program->name;
@@ -269,6 +271,31 @@ out_no_rpciod:
 	return ERR_PTR(err);
 }
 
+/*
+ * Open the additional transports requested through args->nconnect.
+ * They share the peer address and settings of the client's primary
+ * transport; rpc_task_set_client() then hands them out round-robin.
+ */
+static int rpc_clnt_add_xprts(struct rpc_clnt *clnt,
+			      struct xprt_create *xprtargs,
+			      const struct rpc_create_args *args)
+{
+	unsigned int nconnect = min_t(unsigned int, args->nconnect,
+				      RPC_MAX_XPRTS);
+	struct rpc_xprt *xprt;
+
+	while (clnt->cl_nr_xprts < nconnect) {
+		xprt = xprt_create_transport(xprtargs);
+		if (IS_ERR(xprt))
+			return PTR_ERR(xprt);
+		xprt->resvport = clnt->cl_xprt->resvport;
+		clnt->cl_xprts[clnt->cl_nr_xprts++] = xprt;
+	}
+	dprintk("RPC:       %s client for %s using %u transports\n",
+			clnt->cl_protname, clnt->cl_server, clnt->cl_nr_xprts);
+	return 0;
+}
+
 /*
  * rpc_create - create an RPC client and transport with one call
  * @args: rpc_clnt create argument structure
@@ -340,6 +367,14 @@ struct rpc_clnt *rpc_create(struct rpc_create_args *args)
 	if (IS_ERR(clnt))
 		return clnt;
 
+	if (args->nconnect > 1) {
+		int err = rpc_clnt_add_xprts(clnt, &xprtargs, args);
+		if (err != 0) {
+			rpc_shutdown_client(clnt);
+			return ERR_PTR(err);
+		}
+	}
+
 	if (!(args->flags & RPC_CLNT_CREATE_NOPING)) {
 		int err = rpc_ping(clnt);
 		if (err != 0) {
@@ -372,6 +407,7 @@ struct rpc_clnt *
 rpc_clone_client(struct rpc_clnt *clnt)
 {
 	struct rpc_clnt *new;
+	unsigned int i;
 	int err = -ENOMEM;
 
 	new = kmemdup(clnt, sizeof(*new), GFP_KERNEL);
@@ -397,7 +433,8 @@ rpc_clone_client(struct rpc_clnt *clnt)
 		goto out_no_path;
 	if (new->cl_auth)
 		atomic_inc(&new->cl_auth->au_count);
-	xprt_get(clnt->cl_xprt);
+	for (i = 0; i < clnt->cl_nr_xprts; i++)
+		xprt_get(clnt->cl_xprts[i]);
 	atomic_inc(&clnt->cl_count);
 	rpc_register_client(new);
 	rpciod_up();
@@ -468,6 +505,8 @@ EXPORT_SYMBOL_GPL(rpc_shutdown_client);
 static void
 rpc_free_client(struct rpc_clnt *clnt)
 {
+	unsigned int i;
+
 	dprintk("RPC:       destroying %s client for %s\n",
 			clnt->cl_protname, clnt->cl_server);
 	if (!IS_ERR(clnt->cl_path.dentry)) {
@@ -485,7 +524,8 @@ out_free:
 	rpc_free_iostats(clnt->cl_metrics);
 	kfree(clnt->cl_principal);
 	clnt->cl_metrics = NULL;
-	xprt_put(clnt->cl_xprt);
+	for (i = 0; i < clnt->cl_nr_xprts; i++)
+		xprt_put(clnt->cl_xprts[i]);
 	rpciod_down();
 	kfree(clnt);
 }
@@ -576,17 +616,34 @@ void rpc_task_release_client(struct rpc_task *task)
 		list_del(&task->tk_task);
 		spin_unlock(&clnt->cl_lock);
 		task->tk_client = NULL;
+		task->tk_xprt = NULL;
 
 		rpc_release_client(clnt);
 	}
 }
 
+/*
+ * Pick the transport a new task will be sent on.  The client holds
+ * a reference on each of its transports, and the task holds one on
+ * the client, so no extra transport reference is needed here.
+ */
+static struct rpc_xprt *rpc_task_get_xprt(struct rpc_clnt *clnt)
+{
+	unsigned int idx;
+
+	if (clnt->cl_nr_xprts <= 1)
+		return clnt->cl_xprt;
+	idx = (unsigned int)atomic_inc_return(&clnt->cl_xprt_rr);
+	return clnt->cl_xprts[idx % clnt->cl_nr_xprts];
+}
+
 static
 void rpc_task_set_client(struct rpc_task *task, struct rpc_clnt *clnt)
 {
 	if (clnt != NULL) {
 		rpc_task_release_client(task);
 		task->tk_client = clnt;
+		task->tk_xprt = rpc_task_get_xprt(clnt);
 		atomic_inc(&clnt->cl_count);
 		if (clnt->cl_softrtry)
 			task->tk_flags |= RPC_TASK_SOFT;
@@ -803,9 +860,13 @@ EXPORT_SYMBOL_GPL(rpc_peeraddr2str);
 void
 rpc_setbufsize(struct rpc_clnt *clnt, unsigned int sndsize, unsigned int rcvsize)
 {
-	struct rpc_xprt *xprt = clnt->cl_xprt;
-	if (xprt->ops->set_buffer_size)
-		xprt->ops->set_buffer_size(xprt, sndsize, rcvsize);
+	unsigned int i;
+
+	for (i = 0; i < clnt->cl_nr_xprts; i++) {
+		struct rpc_xprt *xprt = clnt->cl_xprts[i];
+		if (xprt->ops->set_buffer_size)
+			xprt->ops->set_buffer_size(xprt, sndsize, rcvsize);
+	}
 }
 EXPORT_SYMBOL_GPL(rpc_setbufsize);
 
@@ -830,8 +891,11 @@ EXPORT_SYMBOL_GPL(rpc_max_payload);
  */
 void rpc_force_rebind(struct rpc_clnt *clnt)
 {
+	unsigned int i;
+
 	if (clnt->cl_autobind)
-		xprt_clear_bound(clnt->cl_xprt);
+		for (i = 0; i < clnt->cl_nr_xprts; i++)
+			xprt_clear_bound(clnt->cl_xprts[i]);
 }
 EXPORT_SYMBOL_GPL(rpc_force_rebind);
 
@@ -181,8 +181,8 @@ static void _print_name(struct seq_file *seq, unsigned int op,
 void rpc_print_iostats(struct seq_file *seq, struct rpc_clnt *clnt)
 {
 	struct rpc_iostats *stats = clnt->cl_metrics;
-	struct rpc_xprt *xprt = clnt->cl_xprt;
 	unsigned int op, maxproc = clnt->cl_maxproc;
+	unsigned int i;
 
 	if (!stats)
 		return;
@@ -191,8 +191,12 @@ void rpc_print_iostats(struct seq_file *seq, struct rpc_clnt *clnt)
 	seq_printf(seq, "p/v: %u/%u (%s)\n",
 			clnt->cl_prog, clnt->cl_vers, clnt->cl_protname);
 
-	if (xprt)
+	/* One "xprt:" line per transport when nconnect is in use */
+	for (i = 0; i < clnt->cl_nr_xprts; i++) {
+		struct rpc_xprt *xprt = clnt->cl_xprts[i];
+
 		xprt->ops->print_stats(xprt, seq);
+	}
 
 	seq_printf(seq, "\tper-op statistics\n");
 	for (op = 0; op < maxproc; op++) {
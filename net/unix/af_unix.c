@@ -112,14 +112,24 @@
 #include <linux/poll.h>
 #include <linux/rtnetlink.h>
 #include <linux/mount.h>
+#include <linux/hash.h>
 #include <net/checksum.h>
 #include <linux/security.h>
 
-static struct hlist_head unix_socket_table[UNIX_HASH_SIZE + 1];
-static DEFINE_SPINLOCK(unix_table_lock);
-static atomic_long_t unix_nr_socks;
+struct unix_hslot {
+	struct hlist_nulls_head	head;
+	spinlock_t		lock;
+};
+
+/*
+ * Slots below UNIX_HASH_SIZE hold bound sockets, hashed by name or by
+ * inode.  Unbound sockets are spread over the upper half by address, so
+ * that socket creation and release do not all hit the same lock.
+ */
+#define UNIX_HASH_SLOTS		(2 * UNIX_HASH_SIZE)
 
-#define unix_sockets_unbound	(&unix_socket_table[UNIX_HASH_SIZE])
+static struct unix_hslot unix_socket_table[UNIX_HASH_SLOTS];
+static atomic_long_t unix_nr_socks;
 
 #define UNIX_ABSTRACT(sk)	(unix_sk(sk)->addr->hash != UNIX_HASH_SIZE)
 
@@ -143,7 +153,11 @@ static inline void unix_set_secdata(struct scm_cookie *scm, struct sk_buff *skb)
 
 /*
  *  SMP locking strategy:
- *    hash table is protected with spinlock unix_table_lock
+ *    each hash slot is protected by its own spin lock, lookups walk the
+ *    chains under RCU.  unix_sock is SLAB_DESTROY_BY_RCU, so a socket
+ *    found this way may be reused under us: take a reference first,
+ *    then check that it is still the one we want, and restart when the
+ *    walk ends on the nulls marker of another slot.
  *    each socket state is protected by separate spin lock.
  */
 
@@ -220,86 +234,138 @@ static int unix_mkname(struct sockaddr_un *sunaddr, int len, unsigned *hashp)
 	return len;
 }
 
-static void __unix_remove_socket(struct sock *sk)
+static inline unsigned int unix_unbound_hash(struct sock *sk)
 {
-	sk_del_node_init(sk);
+	return UNIX_HASH_SIZE + hash_ptr(sk, ilog2(UNIX_HASH_SIZE));
 }
 
-static void __unix_insert_socket(struct hlist_head *list, struct sock *sk)
+static inline unsigned int unix_inode_hash(struct inode *i)
+{
+	return i->i_ino & (UNIX_HASH_SIZE - 1);
+}
+
+/* The slot lock of @hash is held */
+static void __unix_insert_socket(unsigned int hash, struct sock *sk)
 {
 	WARN_ON(!sk_unhashed(sk));
-	sk_add_node(sk, list);
+	sk->sk_hash = hash;
+	sk_nulls_add_node_rcu(sk, &unix_socket_table[hash].head);
+}
+
+static void unix_insert_socket(unsigned int hash, struct sock *sk)
+{
+	struct unix_hslot *slot = &unix_socket_table[hash];
+
+	spin_lock(&slot->lock);
+	__unix_insert_socket(hash, sk);
+	spin_unlock(&slot->lock);
+}
+
+static void unix_remove_socket(struct sock *sk)
+{
+	struct unix_hslot *slot = &unix_socket_table[sk->sk_hash];
+
+	spin_lock(&slot->lock);
+	sk_nulls_del_node_init_rcu(sk);
+	spin_unlock(&slot->lock);
 }
 
-static inline void unix_remove_socket(struct sock *sk)
+/*
+ * Move a freshly bound socket from its unbound slot to the slot @hash,
+ * whose lock is held.  Bound slots sort before unbound ones, which
+ * gives the lock order.
+ */
+static void __unix_rehash_socket(unsigned int hash, struct sock *sk)
 {
-	spin_lock(&unix_table_lock);
-	__unix_remove_socket(sk);
-	spin_unlock(&unix_table_lock);
+	struct unix_hslot *old = &unix_socket_table[sk->sk_hash];
+
+	spin_lock_nested(&old->lock, SINGLE_DEPTH_NESTING);
+	sk_nulls_del_node_init_rcu(sk);
+	spin_unlock(&old->lock);
+	__unix_insert_socket(hash, sk);
 }
 
-static inline void unix_insert_socket(struct hlist_head *list, struct sock *sk)
+static bool unix_match_name(struct net *net, struct sock *s,
+			    struct sockaddr_un *sunname, int len, int type)
 {
-	spin_lock(&unix_table_lock);
-	__unix_insert_socket(list, sk);
-	spin_unlock(&unix_table_lock);
+	struct unix_address *addr = unix_sk(s)->addr;
+
+	return net_eq(sock_net(s), net) && s->sk_type == type &&
+	       addr && addr->len == len && !memcmp(addr->name, sunname, len);
 }
 
+/* The slot lock of hash ^ type is held */
 static struct sock *__unix_find_socket_byname(struct net *net,
 					      struct sockaddr_un *sunname,
 					      int len, int type, unsigned hash)
 {
 	struct sock *s;
-	struct hlist_node *node;
+	struct hlist_nulls_node *node;
 
-	sk_for_each(s, node, &unix_socket_table[hash ^ type]) {
-		struct unix_sock *u = unix_sk(s);
+	sk_nulls_for_each(s, node, &unix_socket_table[hash ^ type].head) {
+		if (unix_match_name(net, s, sunname, len, type))
+			return s;
+	}
+	return NULL;
+}
 
-		if (!net_eq(sock_net(s), net))
-			continue;
+static struct sock *unix_find_socket_byname(struct net *net,
+					    struct sockaddr_un *sunname,
+					    int len, int type, unsigned hash)
+{
+	unsigned int slot = hash ^ type;
+	struct hlist_nulls_node *node;
+	struct sock *s;
 
-		if (u->addr->len == len &&
-		    !memcmp(u->addr->name, sunname, len))
+	rcu_read_lock();
+begin:
+	sk_nulls_for_each_rcu(s, node, &unix_socket_table[slot].head) {
+		if (!net_eq(sock_net(s), net) || s->sk_type != type)
+			continue;
+		if (unlikely(!atomic_inc_not_zero(&s->sk_refcnt)))
+			continue;
+		if (likely(unix_match_name(net, s, sunname, len, type)))
 			goto found;
+		sock_put(s);
 	}
+	if (get_nulls_value(node) != slot)
+		goto begin;
 	s = NULL;
 found:
+	rcu_read_unlock();
 	return s;
 }
 
-static inline struct sock *unix_find_socket_byname(struct net *net,
-						   struct sockaddr_un *sunname,
-						   int len, int type,
-						   unsigned hash)
+/*
+ * Compares the inode pointer only: s may be a socket that unix_create1()
+ * is still initialising, so neither its dentry nor its state lock may be
+ * used here.
+ */
+static bool unix_match_inode(struct sock *s, struct inode *i)
 {
-	struct sock *s;
-
-	spin_lock(&unix_table_lock);
-	s = __unix_find_socket_byname(net, sunname, len, type, hash);
-	if (s)
-		sock_hold(s);
-	spin_unlock(&unix_table_lock);
-	return s;
+	return ACCESS_ONCE(unix_sk(s)->inode) == i;
 }
 
 static struct sock *unix_find_socket_byinode(struct inode *i)
 {
+	unsigned int slot = unix_inode_hash(i);
+	struct hlist_nulls_node *node;
 	struct sock *s;
-	struct hlist_node *node;
 
-	spin_lock(&unix_table_lock);
-	sk_for_each(s, node,
-		    &unix_socket_table[i->i_ino & (UNIX_HASH_SIZE - 1)]) {
-		struct dentry *dentry = unix_sk(s)->dentry;
-
-		if (dentry && dentry->d_inode == i) {
-			sock_hold(s);
+	rcu_read_lock();
+begin:
+	sk_nulls_for_each_rcu(s, node, &unix_socket_table[slot].head) {
+		if (unlikely(!atomic_inc_not_zero(&s->sk_refcnt)))
+			continue;
+		if (likely(unix_match_inode(s, i)))
 			goto found;
-		}
+		sock_put(s);
 	}
+	if (get_nulls_value(node) != slot)
+		goto begin;
 	s = NULL;
 found:
-	spin_unlock(&unix_table_lock);
+	rcu_read_unlock();
 	return s;
 }
 
@@ -389,6 +455,7 @@ static int unix_release_sock(struct sock *sk, int embrion)
 	u->dentry    = NULL;
 	mnt	     = u->mnt;
 	u->mnt	     = NULL;
+	u->inode     = NULL;
 	state = sk->sk_state;
 	sk->sk_state = TCP_CLOSE;
 	unix_state_unlock(sk);
@@ -591,6 +658,7 @@ static struct proto unix_proto = {
 	.name			= "UNIX",
 	.owner			= THIS_MODULE,
 	.obj_size		= sizeof(struct unix_sock),
+	.slab_flags		= SLAB_DESTROY_BY_RCU,
 };
 
 /*
@@ -624,12 +692,13 @@ static struct sock *unix_create1(struct net *net, struct socket *sock)
 	u	  = unix_sk(sk);
 	u->dentry = NULL;
 	u->mnt	  = NULL;
+	u->inode  = NULL;
 	spin_lock_init(&u->lock);
 	atomic_long_set(&u->inflight, 0);
 	INIT_LIST_HEAD(&u->link);
 	mutex_init(&u->readlock); /* single task reading lock */
 	init_waitqueue_head(&u->peer_wait);
-	unix_insert_socket(unix_sockets_unbound, sk);
+	unix_insert_socket(unix_unbound_hash(sk), sk);
 out:
 	if (sk == NULL)
 		atomic_long_dec(&unix_nr_socks);
@@ -689,7 +758,8 @@ static int unix_autobind(struct socket *sock)
 	struct sock *sk = sock->sk;
 	struct net *net = sock_net(sk);
 	struct unix_sock *u = unix_sk(sk);
-	static u32 ordernum = 1;
+	static atomic_t ordernum = ATOMIC_INIT(0);
+	struct unix_hslot *slot;
 	struct unix_address *addr;
 	int err;
 	unsigned int retries = 0;
@@ -709,15 +779,17 @@ static int unix_autobind(struct socket *sock)
 	atomic_set(&addr->refcnt, 1);
 
 retry:
-	addr->len = sprintf(addr->name->sun_path+1, "%05x", ordernum) + 1 + sizeof(short);
+	addr->len = sprintf(addr->name->sun_path+1, "%05x",
+			    atomic_inc_return(&ordernum) & 0xFFFFF) +
+		    1 + sizeof(short);
 	addr->hash = unix_hash_fold(csum_partial(addr->name, addr->len, 0));
 
-	spin_lock(&unix_table_lock);
-	ordernum = (ordernum+1)&0xFFFFF;
+	slot = &unix_socket_table[addr->hash ^ sk->sk_type];
+	spin_lock(&slot->lock);
 
 	if (__unix_find_socket_byname(net, addr->name, addr->len, sock->type,
 				      addr->hash)) {
-		spin_unlock(&unix_table_lock);
+		spin_unlock(&slot->lock);
 		/*
 		 * __unix_find_socket_byname() may take long time if many names
 		 * are already in use.
@@ -733,10 +805,9 @@ retry:
 	}
 	addr->hash ^= sk->sk_type;
 
-	__unix_remove_socket(sk);
 	u->addr = addr;
-	__unix_insert_socket(&unix_socket_table[addr->hash], sk);
-	spin_unlock(&unix_table_lock);
+	__unix_rehash_socket(addr->hash, sk);
+	spin_unlock(&slot->lock);
 	err = 0;
 
 out:	mutex_unlock(&u->readlock);
@@ -810,7 +881,8 @@ static int unix_bind(struct socket *sock, struct sockaddr *uaddr, int addr_len)
 	int err;
 	unsigned hash;
 	struct unix_address *addr;
-	struct hlist_head *list;
+	struct unix_hslot *slot;
+	unsigned int slot_hash;
 
 	err = -EINVAL;
 	if (sunaddr->sun_family != AF_UNIX)
@@ -881,7 +953,13 @@ out_mknod_drop_write:
 		addr->hash = UNIX_HASH_SIZE;
 	}
 
-	spin_lock(&unix_table_lock);
+	if (!sunaddr->sun_path[0])
+		slot_hash = addr->hash;
+	else
+		slot_hash = unix_inode_hash(dentry->d_inode);
+	slot = &unix_socket_table[slot_hash];
+
+	spin_lock(&slot->lock);
 
 	if (!sunaddr->sun_path[0]) {
 		err = -EADDRINUSE;
@@ -890,21 +968,18 @@ out_mknod_drop_write:
 			unix_release_addr(addr);
 			goto out_unlock;
 		}
-
-		list = &unix_socket_table[addr->hash];
 	} else {
-		list = &unix_socket_table[dentry->d_inode->i_ino & (UNIX_HASH_SIZE-1)];
 		u->dentry = nd.path.dentry;
 		u->mnt    = nd.path.mnt;
+		u->inode  = nd.path.dentry->d_inode;
 	}
 
 	err = 0;
-	__unix_remove_socket(sk);
 	u->addr = addr;
-	__unix_insert_socket(list, sk);
+	__unix_rehash_socket(slot_hash, sk);
 
 out_unlock:
-	spin_unlock(&unix_table_lock);
+	spin_unlock(&slot->lock);
 out_up:
 	mutex_unlock(&u->readlock);
 out:
@@ -2115,76 +2190,85 @@ static unsigned int unix_dgram_poll(struct file *file, struct socket *sock,
 }
 
 #ifdef CONFIG_PROC_FS
-static struct sock *first_unix_socket(int *i)
+struct unix_iter_state {
+	struct seq_net_private p;
+	int bucket;
+};
+
+/* Returns with the slot lock of iter->bucket held if a socket is found */
+static struct sock *unix_get_first(struct seq_file *seq, int start)
 {
-	for (*i = 0; *i <= UNIX_HASH_SIZE; (*i)++) {
-		if (!hlist_empty(&unix_socket_table[*i]))
-			return __sk_head(&unix_socket_table[*i]);
+	struct unix_iter_state *iter = seq->private;
+	struct net *net = seq_file_net(seq);
+	struct hlist_nulls_node *node;
+	struct sock *sk;
+
+	for (iter->bucket = start; iter->bucket < UNIX_HASH_SLOTS;
+	     iter->bucket++) {
+		struct unix_hslot *slot = &unix_socket_table[iter->bucket];
+
+		if (hlist_nulls_empty(&slot->head))
+			continue;
+
+		spin_lock(&slot->lock);
+		sk_nulls_for_each(sk, node, &slot->head) {
+			if (net_eq(sock_net(sk), net))
+				return sk;
+		}
+		spin_unlock(&slot->lock);
 	}
 	return NULL;
 }
 
-static struct sock *next_unix_socket(int *i, struct sock *s)
+static struct sock *unix_get_next(struct seq_file *seq, struct sock *sk)
 {
-	struct sock *next = sk_next(s);
-	/* More in this chain? */
-	if (next)
-		return next;
-	/* Look for next non-empty chain. */
-	for ((*i)++; *i <= UNIX_HASH_SIZE; (*i)++) {
-		if (!hlist_empty(&unix_socket_table[*i]))
-			return __sk_head(&unix_socket_table[*i]);
+	struct unix_iter_state *iter = seq->private;
+	struct net *net = seq_file_net(seq);
+
+	do {
+		sk = sk_nulls_next(sk);
+	} while (sk && !net_eq(sock_net(sk), net));
+
+	if (!sk) {
+		spin_unlock(&unix_socket_table[iter->bucket].lock);
+		return unix_get_first(seq, iter->bucket + 1);
 	}
-	return NULL;
+	return sk;
 }
 
-struct unix_iter_state {
-	struct seq_net_private p;
-	int i;
-};
-
-static struct sock *unix_seq_idx(struct seq_file *seq, loff_t pos)
+static struct sock *unix_get_idx(struct seq_file *seq, loff_t pos)
 {
-	struct unix_iter_state *iter = seq->private;
-	loff_t off = 0;
-	struct sock *s;
+	struct sock *sk = unix_get_first(seq, 0);
 
-	for (s = first_unix_socket(&iter->i); s; s = next_unix_socket(&iter->i, s)) {
-		if (sock_net(s) != seq_file_net(seq))
-			continue;
-		if (off == pos)
-			return s;
-		++off;
-	}
-	return NULL;
+	if (sk)
+		while (pos && (sk = unix_get_next(seq, sk)) != NULL)
+			--pos;
+	return pos ? NULL : sk;
 }
 
 static void *unix_seq_start(struct seq_file *seq, loff_t *pos)
-	__acquires(unix_table_lock)
 {
-	spin_lock(&unix_table_lock);
-	return *pos ? unix_seq_idx(seq, *pos - 1) : SEQ_START_TOKEN;
+	return *pos ? unix_get_idx(seq, *pos - 1) : SEQ_START_TOKEN;
 }
 
 static void *unix_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 {
-	struct unix_iter_state *iter = seq->private;
-	struct sock *sk = v;
-	++*pos;
+	struct sock *sk;
 
 	if (v == SEQ_START_TOKEN)
-		sk = first_unix_socket(&iter->i);
+		sk = unix_get_first(seq, 0);
 	else
-		sk = next_unix_socket(&iter->i, sk);
-	while (sk && (sock_net(sk) != seq_file_net(seq)))
-		sk = next_unix_socket(&iter->i, sk);
+		sk = unix_get_next(seq, v);
+	++*pos;
 	return sk;
 }
 
 static void unix_seq_stop(struct seq_file *seq, void *v)
-	__releases(unix_table_lock)
 {
-	spin_unlock(&unix_table_lock);
+	struct unix_iter_state *iter = seq->private;
+
+	if (v && v != SEQ_START_TOKEN)
+		spin_unlock(&unix_socket_table[iter->bucket].lock);
 }
 
 static int unix_seq_show(struct seq_file *seq, void *v)
@@ -2294,10 +2378,16 @@ static struct pernet_operations unix_net_ops = {
 static int __init af_unix_init(void)
 {
 	int rc = -1;
+	unsigned int i;
 	struct sk_buff *dummy_skb;
 
 	BUILD_BUG_ON(sizeof(struct unix_skb_parms) > sizeof(dummy_skb->cb));
 
+	for (i = 0; i < UNIX_HASH_SLOTS; i++) {
+		INIT_HLIST_NULLS_HEAD(&unix_socket_table[i].head, i);
+		spin_lock_init(&unix_socket_table[i].lock);
+	}
+
 	rc = proto_register(&unix_proto, 1);
 	if (rc != 0) {
 		printk(KERN_CRIT "%s: Cannot create unix_sock SLAB cache!\n",
@@ -2314,6 +2404,8 @@ out:
 static void __exit af_unix_exit(void)
 {
 	sock_unregister(PF_UNIX);
+	/* the last unix_release_sock() may have queued the collector */
+	unix_gc_flush();
 	proto_unregister(&unix_proto);
 	unregister_pernet_subsys(&unix_net_ops);
 }
@@ -79,7 +79,7 @@
 #include <linux/file.h>
 #include <linux/proc_fs.h>
 #include <linux/mutex.h>
-#include <linux/wait.h>
+#include <linux/workqueue.h>
 
 #include <net/sock.h>
 #include <net/af_unix.h>
@@ -91,7 +91,6 @@
 static LIST_HEAD(gc_inflight_list);
 static LIST_HEAD(gc_candidates);
 static DEFINE_SPINLOCK(unix_gc_lock);
-static DECLARE_WAIT_QUEUE_HEAD(unix_gc_wait);
 
 unsigned int unix_tot_inflight;
 
@@ -260,13 +259,37 @@ static void inc_inflight_move_tail(struct unix_sock *u)
 
 static bool gc_in_progress = false;
 
+static void unix_gc_work_fn(struct work_struct *work);
+static DECLARE_WORK(unix_gc_work, unix_gc_work_fn);
+
+#define UNIX_INFLIGHT_TRIGGER_GC 16000
+
+/*
+ * The collector runs in the background.  Senders only wait for it when
+ * the number of sockets in flight gets out of hand, so that nobody can
+ * pin an unbounded amount of memory with descriptor cycles.
+ */
 void wait_for_unix_gc(void)
 {
-	wait_event(unix_gc_wait, gc_in_progress == false);
+	if (ACCESS_ONCE(unix_tot_inflight) > UNIX_INFLIGHT_TRIGGER_GC) {
+		unix_gc();
+		flush_work(&unix_gc_work);
+	}
 }
 
 /* The external entry point: unix_gc() */
 void unix_gc(void)
+{
+	queue_work(system_unbound_wq, &unix_gc_work);
+}
+
+/* Wait for a queued collection, before the module goes away */
+void unix_gc_flush(void)
+{
+	flush_work(&unix_gc_work);
+}
+
+static void unix_gc_work_fn(struct work_struct *work)
 {
 	struct unix_sock *u;
 	struct unix_sock *next;
@@ -372,7 +395,6 @@ void unix_gc(void)
 	/* All candidates should have been detached by now. */
 	BUG_ON(!list_empty(&gc_candidates));
 	gc_in_progress = false;
-	wake_up(&unix_gc_wait);
 
  out:
 	spin_unlock(&unix_gc_lock);